@@ -267,11 +267,47 @@
 //  <i>Enable thread information.
 //#define ULOG_OUTPUT_THREAD_NAME
 // </c>
+// <o>The header cache num, caches the level and tag part of log header. Must be power of 2.
+//  <i>Default: 8
+#define ULOG_HDR_CACHE_NUM      8
 // </h>
 // <c1>Enable console backend.
 //  <i>Enable console backend.
 #define ULOG_BACKEND_USING_CONSOLE
 // </c>
+// <e>Enable crash log backend.
+//  <i>Save log in no init RAM and internal flash for post-mortem analysis.
+#define ULOG_BACKEND_USING_CRASH    1
+#if ULOG_BACKEND_USING_CRASH == 0
+    #undef ULOG_BACKEND_USING_CRASH
+#endif
+// <o>Max level saved to crash log
+//  <i>Default: Information
+//  <0=> Assert
+//  <3=> Error
+//  <4=> Warning
+//  <6=> Information
+//  <7=> Debug
+#define ULOG_CRASH_LVL              6
+// <o>No init RAM address. Must match the IRAM2 (NoInit) of the target
+//  <i>Default: 0x2000BC00
+#define ULOG_CRASH_RAM_ADDR         0x2000BC00
+// <o>No init RAM size
+//  <i>Default: 1024
+#define ULOG_CRASH_RAM_SIZE         1024
+// <o>Flash address. The pages must be excluded from IROM of the target
+//  <i>Default: 0x0803E000
+#define ULOG_CRASH_FLASH_ADDR       0x0803E000
+// <o>Flash page num
+//  <i>Default: 4
+#define ULOG_CRASH_FLASH_PAGE_NUM   4
+// <o>Flush to flash when pending bytes reach
+//  <i>Default: 512
+#define ULOG_CRASH_FLUSH_THRESHOLD  512
+// <o>Max flush interval (ms)
+//  <i>Default: 60000
+#define ULOG_CRASH_FLUSH_INTERVAL   60000
+// </e>
 // <c1>Enable runtime log filter.
 //  <i>Enable runtime log filter.
 #define ULOG_USING_FILTER
@@ -279,6 +315,68 @@
 // <o>The filter's max num
 //  <i>Default: 10
 #define ULOG_FILTER_NUM          10
+// <o>The max num of interned tags for runtime filter
+//  <i>Default: 16
+#define ULOG_TAG_NUM             16
+// <e>Enable deferred format log.
+//  <i>Only store the format pointer, tag and raw arguments, format and output in main hook.
+#define ULOG_USING_DEFERRED      1
+#if ULOG_USING_DEFERRED == 0
+    #undef ULOG_USING_DEFERRED
+#endif
+// <o>The deferred log's ring buffer size
+//  <i>Must be power of 2. Default: 2048
+#define ULOG_DEFERRED_BUFSZ      2048
+// <o>The string arguments buffer size of every deferred log
+//  <i>Default: 64
+#define ULOG_DEFERRED_STR_MAX    64
+// <o>The batch output buffer size
+//  <i>Must more than the log's max width. Default: 1024
+#define ULOG_BATCH_BUFSZ         1024
+// <o>The max log num of a batch output
+//  <i>Default: 16
+#define ULOG_BATCH_NUM           16
+// </e>
+// <e>Enable async output thread. Depends on deferred format log.
+//  <i>The deferred log is formatted and output by a low priority thread instead of main hook.
+#define ULOG_USING_ASYNC_OUTPUT  1
+#if ULOG_USING_ASYNC_OUTPUT == 0
+    #undef ULOG_USING_ASYNC_OUTPUT
+#endif
+// <o>The async output thread stack size
+//  <i>Default: 1024
+#define ULOG_ASYNC_OUTPUT_THREAD_STACK      1024
+// <o>The async output thread priority
+//  <i>Default: 6
+#define ULOG_ASYNC_OUTPUT_THREAD_PRIORITY   6
+// <o>The max block time (ms) of block policy
+//  <i>Default: 100
+#define ULOG_ASYNC_BLOCK_TIMEOUT            100
+// <o>Error level policy when queue is full
+//  <i>Default: Block
+//  <0=> Drop
+//  <1=> Overwrite oldest
+//  <2=> Block
+#define ULOG_ASYNC_POLICY_ERROR             2
+// <o>Warning level policy when queue is full
+//  <i>Default: Overwrite oldest
+//  <0=> Drop
+//  <1=> Overwrite oldest
+//  <2=> Block
+#define ULOG_ASYNC_POLICY_WARNING           1
+// <o>Information level policy when queue is full
+//  <i>Default: Drop
+//  <0=> Drop
+//  <1=> Overwrite oldest
+//  <2=> Block
+#define ULOG_ASYNC_POLICY_INFO              0
+// <o>Debug level policy when queue is full
+//  <i>Default: Drop
+//  <0=> Drop
+//  <1=> Overwrite oldest
+//  <2=> Block
+#define ULOG_ASYNC_POLICY_DEBUG             0
+// </e>
 
 #ifdef ULOG_USING_COLOR
 #ifdef ULOG_USING_SYSLOG
@@ -301,6 +399,15 @@
 #endif
 // </e>
 
+// <h>Reactor Configuration
+// <o>the thread stack size of reactor
+//  <i>Default: 1536
+#define REACTOR_THREAD_STACK_SIZE   1536
+// <o>the thread priority of reactor
+//  <i>Default: 1
+#define REACTOR_THREAD_PRIORITY     1
+// </h>
+
 // <h>WIFI Configuration
 // <s>the client device name for wifi
 //  <i>the client device name for wifi
@@ -320,8 +427,86 @@
 // <o>the client timeout(/s) of wifi
 //  <i>the client timeout(/s) of wifi
 #define WIFI_CLIENT_TIMEOUT         10
+// <o>the max number of sessions of wifi
+//  <i>Default: 5
+#define WIFI_SERVER_MAX_CONN        5
+// <o>the small block size of wifi queues
+//  <i>Default: 64
+#define WIFI_QUEUE_SMALL_SIZE       64
+// <o>the large block size of wifi queues
+//  <i>Large enough for the longest modbus tcp frame
+//  <i>Default: 260
+#define WIFI_QUEUE_LARGE_SIZE       260
+// <o>the shared recv small block number of wifi
+//  <i>Default: 16
+#define WIFI_RECV_SMALL_NUM         16
+// <o>the shared recv large block number of wifi
+//  <i>Default: 4
+#define WIFI_RECV_LARGE_NUM         4
+// <o>the recv bytes quota of each session
+//  <i>Counted by the block size taken from the shared pool
+//  <i>Data beyond the quota or the shared pool is dropped
+//  <i>Default: 512
+#define WIFI_RECV_SESSION_QUOTA     512
+// <o>the send queue small block number of wifi
+//  <i>Default: 8
+#define WIFI_SEND_SMALL_NUM         8
+// <o>the send queue large block number of wifi
+//  <i>Default: 2
+#define WIFI_SEND_LARGE_NUM         2
+// <o>the send quantum(bytes) of each session per round
+//  <i>Deficit round robin quantum across sessions
+//  <i>Default: 256
+#define WIFI_SEND_QUANTUM           256
+// <o>the max in-flight responses of each session
+//  <i>Requests of a session are deferred while it has this many unsent responses
+//  <i>Default: 2
+#define WIFI_SESSION_INFLIGHT_MAX   2
+// <o>the send bytes budget of each session
+//  <i>Counted by the block size taken from the send pool
+//  <i>Default: 512
+#define WIFI_SESSION_SEND_BUDGET    512
+// <e>enable modbus rtu gateway
+//  <i>Requests for other unit ids are forwarded to the RS485 bus through rtu_master
+#define WIFI_GATEWAY_USING          1
+#if WIFI_GATEWAY_USING == 0
+    #undef WIFI_GATEWAY_USING
+#endif
+// <o>the max pending requests of gateway
+//  <i>Default: 4
+#define WIFI_GATEWAY_REQUEST_NUM    4
+// <o>the read cache number of gateway
+//  <i>Default: 4
+#define WIFI_GATEWAY_CACHE_NUM      4
+// <o>the read cache ttl(ms) of gateway, 0 to disable
+//  <i>Default: 200
+#define WIFI_GATEWAY_CACHE_TTL      200
+// </e>
+// <o>the send window of wifi
+//  <i>The number of AT+CIPSEND waiting for SEND OK, keep 1 unless the firmware accepts commands before SEND OK
+//  <i>Default: 1
+#define WIFI_SEND_WINDOW            1
 // </h>
 
+// <e>ESP8266 Simulator Configuration
+// <i> Replaces the wifi usart with an in-process ESP8266 AT simulator driving Modbus TCP clients
+#define ESP_SIM_USING               0
+#if ESP_SIM_USING == 0
+    #undef ESP_SIM_USING
+#endif
+#ifdef ESP_SIM_USING
+// <o>the number of simulated modbus tcp clients
+//  <i>Default: 4
+#define ESP_SIM_CLIENT_NUM          4
+// <o>the request interval(ms) after each response, 0 for closed loop
+//  <i>Default: 0
+#define ESP_SIM_REQUEST_INTERVAL    0
+// <o>the request timeout(ms)
+//  <i>Default: 1000
+#define ESP_SIM_REQUEST_TIMEOUT     1000
+#endif
+// </e>
+
 // <<< end of configuration section >>>
 
 #endif
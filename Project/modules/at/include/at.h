@@ -45,6 +45,21 @@ extern "C" {
 #define AT_SERVER_DEVICE               "uart2"
 #endif
 
+/* the size of AT client receive staging buffer, it is filled by one device read */
+#ifndef AT_CLIENT_RX_BUFSZ
+#define AT_CLIENT_RX_BUFSZ             128
+#endif
+
+/* the maximum number of URC table entries */
+#ifndef AT_URC_TABLE_MAX
+#define AT_URC_TABLE_MAX               16
+#endif
+
+/* the number of URC end byte hash buckets, must be power of 2 */
+#ifndef AT_URC_HASH_SIZE
+#define AT_URC_HASH_SIZE               8
+#endif
+
 /* the maximum number of supported AT clients */
 #ifndef AT_CLIENT_NUM_MAX
 #define AT_CLIENT_NUM_MAX              1
@@ -152,10 +167,26 @@ struct at_urc
 };
 typedef struct at_urc *at_urc_t;
 
+/* URC object information precompiled when the table is set */
+struct at_urc_index
+{
+    rt_uint8_t prefix_len;
+    rt_uint8_t suffix_len;
+    /* the last byte of URC data, it is the last byte of prefix when suffix is empty */
+    char end_ch;
+    /* next URC object index in the same hash bucket, 0xFF is the end */
+    rt_uint8_t next;
+};
+
 struct at_urc_table
 {
     rt_size_t urc_size;
     const struct at_urc *urc;
+
+    struct at_urc_index index[AT_URC_TABLE_MAX];
+    /* bitmap of all URC end bytes, used to skip the non-end bytes quickly */
+    rt_uint8_t end_map[32];
+    rt_uint8_t hash_head[AT_URC_HASH_SIZE];
 };
 typedef struct at_urc *at_urc_table_t;
 
@@ -172,7 +203,28 @@ struct at_client
     rt_size_t recv_line_len;
     /* The maximum supported receive data length */
     rt_size_t recv_bufsz;
+    /* the state of the line being received, kept between non-blocking parse calls */
+    char recv_last_ch;
+    rt_bool_t recv_line_full;
+    /* the URC object matched by the current line */
+    const struct at_urc *recv_urc;
+    /* the bytes which stop the line scan: '\n', end sign and URC end bytes */
+    rt_uint8_t stop_map[32];
+    /* receive staging buffer */
+    char rx_buf[AT_CLIENT_RX_BUFSZ];
+    rt_size_t rx_pos;
+    rt_size_t rx_len;
     struct rt_semaphore rx_notice;
+    /* notify the hosting event loop that new data is available, optional */
+    void (*rx_notify)(struct at_client *client);
+
+    /* binary payload received after URC, it is set by `at_obj_set_payload()` function */
+    char *payload_buf;
+    rt_size_t payload_size;
+    rt_size_t payload_len;
+    rt_tick_t payload_timeout;
+    void (*payload_done)(struct at_client *client, char *buf, rt_size_t len, void *user_data);
+    void *payload_user_data;
 
     at_response_t resp;
     struct rt_semaphore resp_notice;
@@ -203,6 +255,8 @@ int at_req_parse_args(const char *req_args, const char *req_expr, ...);
 /* AT client initialize and start*/
 at_client_t at_client_init(usr_device_t dev, char *recv_line_buf, rt_size_t recv_bufsz);
 void client_parser(at_client_t client);
+int at_client_obj_parse(at_client_t client);
+rt_int32_t at_client_obj_payload_left(at_client_t client);
 
 /* ========================== multiple AT client function ============================ */
 
@@ -217,9 +271,16 @@ int at_client_obj_wait_connect(at_client_t client, at_response_t resp, rt_uint32
 rt_size_t at_client_obj_send(at_client_t client, const char *buf, rt_size_t size);
 rt_size_t at_client_obj_recv(at_client_t client, char *buf, rt_size_t size, rt_int32_t timeout);
 
+/* AT client receive binary payload after URC, it can only be used in execution function of URC data */
+int at_obj_set_payload(at_client_t client, char *buf, rt_size_t size, rt_int32_t timeout,
+                       void (*done)(at_client_t client, char *buf, rt_size_t len, void *user_data), void *user_data);
+
 /* set AT client a line end sign */
 void at_obj_set_end_sign(at_client_t client, char ch);
 
+/* set AT client receive notify, used when the client is parsed by an event loop */
+void at_obj_set_rx_notify(at_client_t client, void (*rx_notify)(at_client_t client));
+
 /* Set URC(Unsolicited Result Code) table */
 int at_obj_set_urc_table(at_client_t client, const struct at_urc * table, rt_size_t size);
 
@@ -340,12 +340,20 @@ rt_size_t at_client_obj_send(at_client_t client, const char *buf, rt_size_t size
     return usr_device_write(client->dev, 0, buf, size);
 }
 
-static rt_err_t at_client_getchar(at_client_t client, char *ch, rt_int32_t timeout)
+/* fill the receive staging buffer when it is empty */
+static rt_err_t at_client_rx_fill(at_client_t client, rt_int32_t timeout)
 {
     rt_err_t result = RT_EOK;
 
-    while (usr_device_read(client->dev, 0, ch, 1) == 0)
+    while (client->rx_pos >= client->rx_len)
     {
+        client->rx_pos = 0;
+        client->rx_len = usr_device_read(client->dev, 0, client->rx_buf, sizeof(client->rx_buf));
+        if (client->rx_len > 0)
+        {
+            break;
+        }
+
         result = rt_sem_take(&(client->rx_notice), rt_tick_from_millisecond(timeout));
         if (result != RT_EOK)
         {
@@ -373,9 +381,8 @@ static rt_err_t at_client_getchar(at_client_t client, char *ch, rt_int32_t timeo
  */
 rt_size_t at_client_obj_recv(at_client_t client, char *buf, rt_size_t size, rt_int32_t timeout)
 {
-    rt_size_t read_idx = 0;
+    rt_size_t read_idx = 0, len;
     rt_err_t result = RT_EOK;
-    char ch;
 
     RT_ASSERT(buf);
 
@@ -385,23 +392,38 @@ rt_size_t at_client_obj_recv(at_client_t client, char *buf, rt_size_t size, rt_i
         return 0;
     }
 
-    while (1)
+    while (read_idx < size)
     {
-        if (read_idx < size)
+        /* the data already in staging buffer first, then read the device directly */
+        if (client->rx_pos < client->rx_len)
         {
-            result = at_client_getchar(client, &ch, timeout);
-            if (result != RT_EOK)
+            len = client->rx_len - client->rx_pos;
+            if (len > size - read_idx)
             {
-                LOG_E("AT Client receive failed, uart device get data error(%d)", result);
-                return 0;
+                len = size - read_idx;
             }
-
-            buf[read_idx++] = ch;
+            rt_memcpy(buf + read_idx, client->rx_buf + client->rx_pos, len);
+            client->rx_pos += len;
         }
         else
         {
-            break;
+            len = usr_device_read(client->dev, 0, buf + read_idx, size - read_idx);
+        }
+
+        if (len > 0)
+        {
+            read_idx += len;
+            continue;
+        }
+
+        result = rt_sem_take(&(client->rx_notice), rt_tick_from_millisecond(timeout));
+        if (result != RT_EOK)
+        {
+            LOG_E("AT Client receive failed, uart device get data error(%d)", result);
+            return 0;
         }
+
+        rt_sem_control(&(client->rx_notice), RT_IPC_CMD_RESET, RT_NULL);
     }
 
 #ifdef AT_PRINT_RAW_CMD
@@ -411,6 +433,190 @@ rt_size_t at_client_obj_recv(at_client_t client, char *buf, rt_size_t size, rt_i
     return read_idx;
 }
 
+/**
+ * AT client receive binary payload after URC.
+ * The payload is copied from the device straight into the buffer in bulk when the URC execution
+ * function returns, the line parsing is resumed after the payload is complete or timeout.
+ *
+ * @param client current AT client object
+ * @param buf   receive payload buffer, RT_NULL to discard the payload
+ * @param size  receive payload size
+ * @param timeout  receive payload timeout (ms)
+ * @param done  called in the parser when the payload is complete or timeout, can be RT_NULL
+ * @param user_data  the argument of done function
+ *
+ * @note this function can only be used in execution function of URC data
+ *
+ * @return RT_EOK: set success
+ *        -RT_ERROR: set failed
+ */
+int at_obj_set_payload(at_client_t client, char *buf, rt_size_t size, rt_int32_t timeout,
+                       void (*done)(at_client_t client, char *buf, rt_size_t len, void *user_data), void *user_data)
+{
+    if (client == RT_NULL)
+    {
+        LOG_E("input AT Client object is NULL, please create or get AT Client object!");
+        return -RT_ERROR;
+    }
+
+    if (size == 0 || client->payload_size > 0)
+    {
+        return -RT_ERROR;
+    }
+
+    client->payload_buf = buf;
+    client->payload_len = 0;
+    client->payload_timeout = rt_tick_get() + rt_tick_from_millisecond(timeout);
+    client->payload_done = done;
+    client->payload_user_data = user_data;
+    client->payload_size = size;
+
+    return RT_EOK;
+}
+
+/**
+ * AT client receive the payload set by `at_obj_set_payload()`.
+ *
+ * @param client current AT client object
+ * @param timeout wait data timeout (ms), 0 means return when no data
+ *
+ * @return 1: payload is complete or timeout
+ *         0: payload is not complete
+ */
+static int at_recv_payload(at_client_t client, rt_int32_t timeout)
+{
+    rt_size_t remain, len;
+    rt_tick_t now;
+
+    while (1)
+    {
+        /* the expired payload is ended before reading, the data after it belongs to the next line */
+        now = rt_tick_get();
+        if ((now - client->payload_timeout) < (RT_TICK_MAX / 2))
+        {
+            LOG_E("AT Client receive payload timeout, received(%d) size(%d).", client->payload_len, client->payload_size);
+            break;
+        }
+
+        remain = client->payload_size - client->payload_len;
+
+        /* the data already in staging buffer first */
+        len = client->rx_len - client->rx_pos;
+        if (len > remain)
+        {
+            len = remain;
+        }
+        if (len > 0)
+        {
+            if (client->payload_buf)
+            {
+                rt_memcpy(client->payload_buf + client->payload_len, client->rx_buf + client->rx_pos, len);
+            }
+            client->rx_pos += len;
+            client->payload_len += len;
+            remain -= len;
+        }
+
+        /* then read the device ring straight into the payload buffer */
+        while (remain > 0)
+        {
+            if (client->payload_buf)
+            {
+                len = usr_device_read(client->dev, 0, client->payload_buf + client->payload_len, remain);
+            }
+            else
+            {
+                len = usr_device_read(client->dev, 0, client->rx_buf, remain > sizeof(client->rx_buf) ? sizeof(client->rx_buf) : remain);
+            }
+
+            if (len == 0)
+            {
+                break;
+            }
+            client->payload_len += len;
+            remain -= len;
+        }
+
+        if (remain == 0)
+        {
+            break;
+        }
+
+        if (timeout == 0)
+        {
+            return 0;
+        }
+
+        if (rt_sem_take(&(client->rx_notice), client->payload_timeout - now) == RT_EOK)
+        {
+            rt_sem_control(&(client->rx_notice), RT_IPC_CMD_RESET, RT_NULL);
+        }
+    }
+
+#ifdef AT_PRINT_RAW_CMD
+    if (client->payload_buf)
+    {
+        at_print_raw_cmd("urc_recv", client->payload_buf, client->payload_len);
+    }
+#endif
+
+    client->payload_size = 0;
+    if (client->payload_done)
+    {
+        client->payload_done(client, client->payload_buf, client->payload_len, client->payload_user_data);
+    }
+
+    return 1;
+}
+
+/**
+ * AT client get the time left before the pending payload timeout.
+ * The non-blocking parse does not wait, the hosting event loop calls `at_client_obj_parse()`
+ * again after this time to end the timeout payload.
+ *
+ * @param client current AT client object
+ *
+ * @return >= 0: the time left (ms)
+ *           -1: no pending payload
+ */
+rt_int32_t at_client_obj_payload_left(at_client_t client)
+{
+    rt_tick_t left;
+
+    RT_ASSERT(client);
+
+    if (client->payload_size == 0)
+    {
+        return -1;
+    }
+
+    left = client->payload_timeout - rt_tick_get();
+    if (left >= RT_TICK_MAX / 2)
+    {
+        return 0;
+    }
+
+    return (left * 1000 + RT_TICK_PER_SECOND - 1) / RT_TICK_PER_SECOND;
+}
+
+static void at_client_update_stop_map(at_client_t client)
+{
+    if (client->urc_table.urc)
+    {
+        rt_memcpy(client->stop_map, client->urc_table.end_map, sizeof(client->stop_map));
+    }
+    else
+    {
+        rt_memset(client->stop_map, 0x00, sizeof(client->stop_map));
+    }
+
+    client->stop_map['\n' >> 3] |= (1 << ('\n' & 0x07));
+    if (client->end_sign != 0)
+    {
+        client->stop_map[(rt_uint8_t)client->end_sign >> 3] |= (1 << ((rt_uint8_t)client->end_sign & 0x07));
+    }
+}
+
 /**
  *  AT client set end sign.
  *
@@ -426,6 +632,24 @@ void at_obj_set_end_sign(at_client_t client, char ch)
     }
 
     client->end_sign = ch;
+    at_client_update_stop_map(client);
+}
+
+/**
+ * AT client set receive notify, it is called in the device RX indicate.
+ *
+ * @param client current AT client object
+ * @param rx_notify notify function, RT_NULL to remove
+ */
+void at_obj_set_rx_notify(at_client_t client, void (*rx_notify)(at_client_t client))
+{
+    if (client == RT_NULL)
+    {
+        LOG_E("input AT Client object is NULL, please create or get AT Client object!");
+        return;
+    }
+
+    client->rx_notify = rx_notify;
 }
 
 /**
@@ -437,6 +661,7 @@ void at_obj_set_end_sign(at_client_t client, char ch)
  */
 int at_obj_set_urc_table(at_client_t client, const struct at_urc *urc_table, rt_size_t table_sz)
 {
+    struct at_urc_table *table;
     rt_size_t idx;
 
     if (client == RT_NULL)
@@ -445,14 +670,47 @@ int at_obj_set_urc_table(at_client_t client, const struct at_urc *urc_table, rt_
         return -RT_ERROR;
     }
 
-    for (idx = 0; idx < table_sz; idx++)
+    if (table_sz > AT_URC_TABLE_MAX)
     {
-        RT_ASSERT(urc_table[idx].cmd_prefix);
-        RT_ASSERT(urc_table[idx].cmd_suffix);
+        LOG_E("URC table size(%d) is out of the maximum number(%d)!", table_sz, AT_URC_TABLE_MAX);
+        return -RT_ERROR;
     }
-    
-    client->urc_table.urc = urc_table;
-    client->urc_table.urc_size = table_sz;
+
+    table = &(client->urc_table);
+    table->urc = RT_NULL;
+    table->urc_size = 0;
+    rt_memset(table->end_map, 0x00, sizeof(table->end_map));
+    rt_memset(table->hash_head, 0xFF, sizeof(table->hash_head));
+
+    /* precompile the table, link from the end so that each hash bucket keeps the table order */
+    for (idx = table_sz; idx > 0; idx--)
+    {
+        const struct at_urc *urc = urc_table + idx - 1;
+        struct at_urc_index *index = &(table->index[idx - 1]);
+        rt_size_t prefix_len, suffix_len;
+        rt_uint8_t bucket;
+
+        RT_ASSERT(urc->cmd_prefix);
+        RT_ASSERT(urc->cmd_suffix);
+
+        prefix_len = rt_strlen(urc->cmd_prefix);
+        suffix_len = rt_strlen(urc->cmd_suffix);
+        RT_ASSERT(prefix_len + suffix_len > 0);
+        RT_ASSERT(prefix_len <= 0xFF && suffix_len <= 0xFF);
+
+        index->prefix_len = prefix_len;
+        index->suffix_len = suffix_len;
+        index->end_ch = suffix_len ? urc->cmd_suffix[suffix_len - 1] : urc->cmd_prefix[prefix_len - 1];
+
+        bucket = (rt_uint8_t)index->end_ch & (AT_URC_HASH_SIZE - 1);
+        index->next = table->hash_head[bucket];
+        table->hash_head[bucket] = idx - 1;
+        table->end_map[(rt_uint8_t)index->end_ch >> 3] |= (1 << ((rt_uint8_t)index->end_ch & 0x07));
+    }
+
+    table->urc = urc_table;
+    table->urc_size = table_sz;
+    at_client_update_stop_map(client);
 
     return RT_EOK;
 }
@@ -472,7 +730,7 @@ at_client_t at_client_get(const char *dev_name)
 
     for (idx = 0; idx < AT_CLIENT_NUM_MAX; idx++)
     {
-        if (rt_strcmp(at_client_table[idx].dev->name, dev_name) == 0)
+        if (at_client_table[idx].dev && (rt_strcmp(at_client_table[idx].dev->name, dev_name) == 0))
         {
             return &at_client_table[idx];
         }
@@ -498,12 +756,14 @@ at_client_t at_client_get_first(void)
 
 static const struct at_urc *get_urc_obj(at_client_t client)
 {
-    rt_size_t i, prefix_len, suffix_len;
+    const struct at_urc_table *table = &(client->urc_table);
+    const struct at_urc_index *index;
+    const struct at_urc *urc;
     rt_size_t bufsz;
-    char *buffer = RT_NULL;
-    const struct at_urc *urc = RT_NULL;
+    char *buffer;
+    rt_uint8_t ch, i;
 
-    if ((client->urc_table.urc == RT_NULL) || (client->urc_table.urc_size <= 0))
+    if ((table->urc == RT_NULL) || (table->urc_size <= 0) || (client->recv_line_len == 0))
     {
         return RT_NULL;
     }
@@ -511,17 +771,29 @@ static const struct at_urc *get_urc_obj(at_client_t client)
     buffer = client->recv_line_buf;
     bufsz = client->recv_line_len;
 
-    for (i = 0; i < client->urc_table.urc_size; i++)
+    /* only the URC end bytes need to be checked */
+    ch = (rt_uint8_t)buffer[bufsz - 1];
+    if ((table->end_map[ch >> 3] & (1 << (ch & 0x07))) == 0)
     {
-        urc = client->urc_table.urc + i;
+        return RT_NULL;
+    }
 
-        prefix_len = rt_strlen(urc->cmd_prefix);
-        suffix_len = rt_strlen(urc->cmd_suffix);
-        if (bufsz < prefix_len + suffix_len)
+    for (i = table->hash_head[ch & (AT_URC_HASH_SIZE - 1)]; i != 0xFF; i = index->next)
+    {
+        index = &(table->index[i]);
+        urc = table->urc + i;
+
+        if (index->end_ch != (char)ch || bufsz < index->prefix_len + index->suffix_len)
+        {
+            continue;
+        }
+        /* the URC without suffix is matched as soon as the prefix is received */
+        if (index->suffix_len == 0 && bufsz != index->prefix_len)
         {
             continue;
         }
-        if ((prefix_len ? !rt_strncmp(buffer, urc->cmd_prefix, prefix_len) : 1) && (suffix_len ? !rt_strncmp(buffer + bufsz - suffix_len, urc->cmd_suffix, suffix_len) : 1))
+        if (rt_memcmp(buffer + bufsz - index->suffix_len, urc->cmd_suffix, index->suffix_len) == 0
+                && rt_memcmp(buffer, urc->cmd_prefix, index->prefix_len) == 0)
         {
             return urc;
         }
@@ -530,121 +802,231 @@ static const struct at_urc *get_urc_obj(at_client_t client)
     return RT_NULL;
 }
 
-static int at_recv_readline(at_client_t client)
+static void at_recv_line_reset(at_client_t client)
 {
-    rt_size_t read_len = 0;
-    char ch = 0, last_ch = 0;
-    rt_bool_t is_full = RT_FALSE;
-
-    rt_memset(client->recv_line_buf, 0x00, client->recv_bufsz);
+    client->recv_line_buf[0] = '\0';
     client->recv_line_len = 0;
+    client->recv_last_ch = 0;
+    client->recv_line_full = RT_FALSE;
+    client->recv_urc = RT_NULL;
+}
+
+/**
+ * AT client read one line data.
+ * The staging buffer is scanned for the stop bytes and the spans between them are copied in bulk,
+ * the line data is always terminated by '\0'.
+ *
+ * @param client current AT client object
+ * @param timeout wait data timeout (ms), 0 means return when no data
+ *
+ * @return >0: one line data length
+ *          0: line data is not complete, the received part is kept
+ *         <0: line data length is out of buffer size
+ */
+static int at_recv_readline(at_client_t client, rt_int32_t timeout)
+{
+    const rt_uint8_t *stop_map = client->stop_map;
+    const char *start, *end, *pos;
+    rt_size_t span, copy_len;
+    char ch, last_ch;
 
     while (1)
     {
-        at_client_getchar(client, &ch, RT_WAITING_FOREVER);
+        if (at_client_rx_fill(client, timeout) != RT_EOK)
+        {
+            return 0;
+        }
 
-        if (read_len < client->recv_bufsz)
+        start = client->rx_buf + client->rx_pos;
+        end = client->rx_buf + client->rx_len;
+        for (pos = start; pos < end; pos++)
         {
-            client->recv_line_buf[read_len++] = ch;
-            client->recv_line_len = read_len;
+            if (stop_map[(rt_uint8_t)*pos >> 3] & (1 << ((rt_uint8_t)*pos & 0x07)))
+            {
+                break;
+            }
         }
-        else
+
+        span = pos - start;
+        if (pos < end)
+        {
+            /* include the stop byte */
+            span++;
+        }
+        client->rx_pos += span;
+
+        /* keep one byte for '\0' */
+        copy_len = client->recv_bufsz - 1 - client->recv_line_len;
+        if (copy_len > span)
+        {
+            copy_len = span;
+        }
+        else if (copy_len < span)
+        {
+            client->recv_line_full = RT_TRUE;
+        }
+        rt_memcpy(client->recv_line_buf + client->recv_line_len, start, copy_len);
+        client->recv_line_len += copy_len;
+        client->recv_line_buf[client->recv_line_len] = '\0';
+
+        if (pos >= end)
         {
-            is_full = RT_TRUE;
+            client->recv_last_ch = *(end - 1);
+            continue;
         }
 
+        ch = *pos;
+        last_ch = (pos > start) ? *(pos - 1) : client->recv_last_ch;
+        client->recv_urc = get_urc_obj(client);
+
         /* is newline or URC data */
         if ((ch == '\n' && last_ch == '\r') || (client->end_sign != 0 && ch == client->end_sign)
-                || get_urc_obj(client))
+                || client->recv_urc)
         {
-            if (is_full)
+            if (client->recv_line_full)
             {
                 LOG_E("read line failed. The line data length is out of buffer size(%d)!", client->recv_bufsz);
-                rt_memset(client->recv_line_buf, 0x00, client->recv_bufsz);
-                client->recv_line_len = 0;
+                at_recv_line_reset(client);
                 return -RT_EFULL;
             }
             break;
         }
-        last_ch = ch;
+        client->recv_last_ch = ch;
     }
 
 #ifdef AT_PRINT_RAW_CMD
-    at_print_raw_cmd("recvline", client->recv_line_buf, read_len);
+    at_print_raw_cmd("recvline", client->recv_line_buf, client->recv_line_len);
 #endif
 
-    return read_len;
+    return client->recv_line_len;
 }
 
-void client_parser(at_client_t client)
+static void at_client_dispatch_line(at_client_t client)
 {
     const struct at_urc *urc;
 
+    if ((urc = client->recv_urc) != RT_NULL)
+    {
+        /* current receive is request, try to execute related operations */
+        if (urc->func != RT_NULL)
+        {
+            urc->func(client, client->recv_line_buf, client->recv_line_len);
+        }
+    }
+    else if (client->resp != RT_NULL)
+    {
+        at_response_t resp = client->resp;
+
+        /* current receive is response */
+        client->recv_line_buf[client->recv_line_len - 1] = '\0';
+        if (resp->buf_len + client->recv_line_len < resp->buf_size)
+        {
+            /* copy response lines, separated by '\0' */
+            rt_memcpy(resp->buf + resp->buf_len, client->recv_line_buf, client->recv_line_len);
+
+            /* update the current response information */
+            resp->buf_len += client->recv_line_len;
+            resp->line_counts++;
+        }
+        else
+        {
+            client->resp_status = AT_RESP_BUFF_FULL;
+            LOG_E("Read response buffer failed. The Response buffer size is out of buffer size(%d)!", resp->buf_size);
+        }
+        /* check response result */
+        if (rt_memcmp(client->recv_line_buf, AT_RESP_END_OK, rt_strlen(AT_RESP_END_OK)) == 0
+                && resp->line_num == 0)
+        {
+            /* get the end data by response result, return response state END_OK. */
+            client->resp_status = AT_RESP_OK;
+        }
+        else if (rt_strstr(client->recv_line_buf, AT_RESP_END_ERROR)
+                || (rt_memcmp(client->recv_line_buf, AT_RESP_END_FAIL, rt_strlen(AT_RESP_END_FAIL)) == 0))
+        {
+            client->resp_status = AT_RESP_ERROR;
+        }
+        else if (resp->line_counts == resp->line_num && resp->line_num)
+        {
+            /* get the end data by response line, return response state END_OK.*/
+            client->resp_status = AT_RESP_OK;
+        }
+        else
+        {
+            return;
+        }
+
+        client->resp = RT_NULL;
+        rt_sem_release(&(client->resp_notice));
+    }
+    else
+    {
+//        log_d("unrecognized line: %.*s", client->recv_line_len, client->recv_line_buf);
+    }
+}
+
+void client_parser(at_client_t client)
+{
     while(1)
     {
-        if (at_recv_readline(client) > 0)
+        if (client->payload_size > 0)
         {
-            if ((urc = get_urc_obj(client)) != RT_NULL)
-            {
-                /* current receive is request, try to execute related operations */
-                if (urc->func != RT_NULL)
-                {
-                    urc->func(client, client->recv_line_buf, client->recv_line_len);
-                }
-            }
-            else if (client->resp != RT_NULL)
-            {
-                at_response_t resp = client->resp;
-
-                /* current receive is response */
-                client->recv_line_buf[client->recv_line_len - 1] = '\0';
-                if (resp->buf_len + client->recv_line_len < resp->buf_size)
-                {
-                    /* copy response lines, separated by '\0' */
-                    rt_memcpy(resp->buf + resp->buf_len, client->recv_line_buf, client->recv_line_len);
-
-                    /* update the current response information */
-                    resp->buf_len += client->recv_line_len;
-                    resp->line_counts++;
-                }
-                else
-                {
-                    client->resp_status = AT_RESP_BUFF_FULL;
-                    LOG_E("Read response buffer failed. The Response buffer size is out of buffer size(%d)!", resp->buf_size);
-                }
-                /* check response result */
-                if (rt_memcmp(client->recv_line_buf, AT_RESP_END_OK, rt_strlen(AT_RESP_END_OK)) == 0
-                        && resp->line_num == 0)
-                {
-                    /* get the end data by response result, return response state END_OK. */
-                    client->resp_status = AT_RESP_OK;
-                }
-                else if (rt_strstr(client->recv_line_buf, AT_RESP_END_ERROR)
-                        || (rt_memcmp(client->recv_line_buf, AT_RESP_END_FAIL, rt_strlen(AT_RESP_END_FAIL)) == 0))
-                {
-                    client->resp_status = AT_RESP_ERROR;
-                }
-                else if (resp->line_counts == resp->line_num && resp->line_num)
-                {
-                    /* get the end data by response line, return response state END_OK.*/
-                    client->resp_status = AT_RESP_OK;
-                }
-                else
-                {
-                    continue;
-                }
-
-                client->resp = RT_NULL;
-                rt_sem_release(&(client->resp_notice));
-            }
-            else
-            {
-//                log_d("unrecognized line: %.*s", client->recv_line_len, client->recv_line_buf);
-            }
+            at_recv_payload(client, RT_WAITING_FOREVER);
+        }
+
+        if (at_recv_readline(client, RT_WAITING_FOREVER) > 0)
+        {
+            at_client_dispatch_line(client);
+            at_recv_line_reset(client);
         }
     }
 }
 
+/**
+ * AT client parse all received data without blocking.
+ * It is used instead of `client_parser()` when the client is hosted by an event loop,
+ * the partial line is kept until the next call.
+ *
+ * @param client current AT client object
+ *
+ * @return the number of parsed lines
+ */
+int at_client_obj_parse(at_client_t client)
+{
+    int line_num = 0;
+
+    RT_ASSERT(client);
+
+    if (client->status == AT_STATUS_CLI)
+    {
+        return 0;
+    }
+
+    rt_sem_control(&(client->rx_notice), RT_IPC_CMD_RESET, RT_NULL);
+
+    while (1)
+    {
+        if (client->payload_size > 0 && at_recv_payload(client, 0) == 0)
+        {
+            break;
+        }
+
+        int rc = at_recv_readline(client, 0);
+        if (rc == 0)
+        {
+            break;
+        }
+
+        if (rc > 0)
+        {
+            at_client_dispatch_line(client);
+            at_recv_line_reset(client);
+            line_num++;
+        }
+    }
+
+    return line_num;
+}
+
 static rt_err_t at_client_rx_ind(usr_device_t dev, rt_size_t size)
 {
     int idx = 0;
@@ -654,6 +1036,11 @@ static rt_err_t at_client_rx_ind(usr_device_t dev, rt_size_t size)
         if (at_client_table[idx].dev == dev && size > 0)
         {
             rt_sem_release(&(at_client_table[idx].rx_notice));
+
+            if (at_client_table[idx].rx_notify)
+            {
+                at_client_table[idx].rx_notify(&at_client_table[idx]);
+            }
         }
     }
 
@@ -672,8 +1059,11 @@ static int at_client_para_init(at_client_t client, usr_device_t dev, char *recv_
     client->dev = dev;
     client->status = AT_STATUS_UNINITIALIZED;
     client->recv_line_buf = recv_line_buf;
-    client->recv_line_len = 0;
     client->recv_bufsz = recv_bufsz;
+    client->rx_pos = 0;
+    client->rx_len = 0;
+    at_recv_line_reset(client);
+    at_client_update_stop_map(client);
 
     rt_snprintf(name, RT_NAME_MAX, "%s%d", AT_CLIENT_SEM_NAME, at_client_num);
     rt_sem_init(&(client->rx_notice), name, 0, RT_IPC_FLAG_FIFO);
@@ -1,3 +1,4 @@
+#include "console.h"
 #include "drv_usart.h"
 
 ALIGN(RT_ALIGN_SIZE)
@@ -7,6 +8,12 @@ static usr_device_t dev = RT_NULL;
 static rt_uint8_t usart_send_buf[2048];
 static rt_uint8_t usart_read_buf[16];
 static struct rt_semaphore rx_sem;
+/* 每次发送完成释放, 发送缓冲区满或直接发送时等待 */
+static struct rt_semaphore tx_sem;
+/* 等待发送的线程依次进行 */
+static struct rt_mutex tx_mtx;
+/* 最近一次直接发送完成的缓冲区 */
+static const void * volatile tx_done_buf = RT_NULL;
 
 static rt_err_t rx_indicate(usr_device_t dev, rt_size_t size)
 {
@@ -15,12 +22,120 @@ static rt_err_t rx_indicate(usr_device_t dev, rt_size_t size)
     return RT_EOK;
 }
 
+static rt_err_t tx_complete(usr_device_t dev, void *buffer)
+{
+    if(buffer)
+        tx_done_buf = buffer;
+
+    rt_sem_release(&tx_sem);
+
+    return RT_EOK;
+}
+
+/* 中断, 关中断, 锁调度器或调度器未启动时不能等待 */
+static rt_bool_t console_can_wait(void)
+{
+    if(rt_interrupt_get_nest())
+        return RT_FALSE;
+    if(rt_thread_self() == RT_NULL)
+        return RT_FALSE;
+    if(rt_critical_level())
+        return RT_FALSE;
+    if(__get_PRIMASK())
+        return RT_FALSE;
+
+    return RT_TRUE;
+}
+
+/**
+ * 写入发送缓冲区, 缓冲区满时在线程中等待发送完成腾出空间, 不能等待时丢弃剩余数据.
+ * 能等待时先取锁, 数据不会插入到正在等待的线程或直接发送的数据之间
+ */
+rt_size_t console_write(const void *buffer, rt_size_t size)
+{
+    if(!init_ok)
+        return 0;
+
+    const rt_uint8_t *ptr = buffer;
+    rt_size_t written = 0;
+
+    if(!console_can_wait())
+        return usr_device_write(dev, 0, ptr, size);
+
+    rt_mutex_take(&tx_mtx, RT_WAITING_FOREVER);
+    while(written < size)
+    {
+        rt_sem_control(&tx_sem, RT_IPC_CMD_RESET, RT_NULL);
+        rt_size_t len = usr_device_write(dev, 0, ptr + written, size - written);
+        written += len;
+        if((written == size) || dev->error)
+            break;
+
+        if(len > 0)
+            continue;
+
+        if(rt_sem_take(&tx_sem, rt_tick_from_millisecond(USR_DEVICE_USART_TX_ACTIVATED_TIMEOUT * 1000)) != RT_EOK)
+            break;
+    }
+    rt_mutex_release(&tx_mtx);
+
+    return written;
+}
+
+/**
+ * 大块数据不经过发送缓冲区, 直接用 DMA 发送调用者的缓冲区, 发送完成后返回.
+ * 不能等待时退回到 console_write.
+ *
+ * @param buffer 数据, 函数返回前不能修改
+ * @param size 数据长度
+ *
+ * @return 发送的字节数
+ */
+rt_size_t console_write_stream(const void *buffer, rt_size_t size)
+{
+    if(!init_ok)
+        return 0;
+    if(size == 0)
+        return 0;
+    if(!console_can_wait())
+        return console_write(buffer, size);
+
+    struct usr_device_usart_tx_direct direct;
+    direct.buf = buffer;
+    direct.len = size;
+
+    rt_mutex_take(&tx_mtx, RT_WAITING_FOREVER);
+
+    rt_sem_control(&tx_sem, RT_IPC_CMD_RESET, RT_NULL);
+    tx_done_buf = RT_NULL;
+    if(usr_device_control(dev, USR_DEVICE_USART_CMD_TX_DIRECT, &direct) != RT_EOK)
+    {
+        rt_mutex_release(&tx_mtx);
+        return console_write(buffer, size);
+    }
+
+    while(tx_done_buf != buffer)
+    {
+        if(dev->error || (rt_sem_take(&tx_sem, rt_tick_from_millisecond(USR_DEVICE_USART_TX_ACTIVATED_TIMEOUT * 1000)) != RT_EOK))
+        {
+            /* 发送失败, 丢弃未发送的数据, 不再引用调用者的缓冲区 */
+            usr_device_control(dev, USR_DEVICE_USART_CMD_FLUSH, RT_NULL);
+            size = 0;
+            break;
+        }
+    }
+
+    rt_mutex_release(&tx_mtx);
+
+    return size;
+}
+
 void rt_hw_console_output(const char *str)
 {
     if(!init_ok)
         return;
     
-    usr_device_write(dev, 0, str, rt_strlen(str));
+    console_write(str, rt_strlen(str));
 }
 
 char rt_hw_console_getchar(void)
@@ -60,6 +175,9 @@ int console_init(void)
     
     rt_sem_init(&rx_sem, "con_rx", 0, RT_IPC_FLAG_FIFO);
     usr_device_set_rx_indicate(dev, rx_indicate);
+    rt_sem_init(&tx_sem, "con_tx", 0, RT_IPC_FLAG_FIFO);
+    rt_mutex_init(&tx_mtx, "con_tx", RT_IPC_FLAG_FIFO);
+    usr_device_set_tx_complete(dev, tx_complete);
 
     struct usr_device_usart_buffer buffer;
     buffer.send_buf = usart_send_buf;
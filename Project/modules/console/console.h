@@ -0,0 +1,9 @@
+#ifndef __CONSOLE_H
+#define __CONSOLE_H
+#include <rtthread.h>
+
+int console_init(void);
+rt_size_t console_write(const void *buffer, rt_size_t size);
+rt_size_t console_write_stream(const void *buffer, rt_size_t size);
+
+#endif
@@ -0,0 +1,519 @@
+#include "esp_sim.h"
+#include "usr_device.h"
+#include "ringbuffer.h"
+#include "reactor.h"
+#include <rthw.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdarg.h>
+
+#ifdef ESP_SIM_USING
+
+#define DBG_ENABLE
+#define DBG_COLOR
+#define DBG_SECTION_NAME    "esp_sim"
+#define DBG_LEVEL           DBG_INFO
+#include <rtdbg.h>
+
+#define ESP_SIM_CMD_MAX_LEN             128
+#define ESP_SIM_RSP_BUFSZ               512
+#define ESP_SIM_CONNECT_DELAY           500
+
+typedef enum
+{
+    ESP_SIM_CLIENT_CLOSED = 0,
+    ESP_SIM_CLIENT_CONNECTED
+} esp_sim_client_state_t;
+
+/* 模拟的 Modbus TCP 主站, 收到响应后立即发送下一个请求 */
+struct esp_sim_client
+{
+    int link_id;
+    esp_sim_client_state_t state;
+    rt_uint16_t tid;
+    rt_uint8_t wait_rsp;
+    rt_tick_t send_tick;
+    rt_uint8_t rsp_buf[ESP_SIM_RSP_BUFSZ];
+    int rsp_len;
+    struct reactor_timer timer;
+};
+
+struct esp_sim_stat
+{
+    rt_tick_t start_tick;
+    rt_uint32_t trans_cnt;
+    rt_uint32_t timeout_cnt;
+    rt_uint32_t error_cnt;
+    rt_uint32_t hist[ESP_SIM_HIST_SIZE];
+};
+
+/* 客户端状态只在 reactor 线程中访问 */
+struct esp_sim_device
+{
+    struct usr_device parent;
+
+    struct rt_ringbuffer rx_rb;
+    struct rt_ringbuffer tx_rb;
+    struct reactor_work tx_work;
+    /* 设备初始化后由 tx_work 清除解析状态 */
+    rt_uint8_t tx_reset;
+    char cmd_buf[ESP_SIM_CMD_MAX_LEN];
+    int cmd_len;
+    /* AT+CIPSEND 之后的数据模式 */
+    int data_link;
+    int data_remain;
+    int data_len;
+    rt_uint8_t server_on;
+    rt_uint8_t smart_on;
+    struct reactor_timer smart_timer;
+
+    struct esp_sim_client clients[ESP_SIM_CLIENT_NUM];
+    struct esp_sim_stat stat;
+};
+
+ALIGN(RT_ALIGN_SIZE)
+static rt_uint8_t esp_sim_rx_buf[ESP_SIM_RX_BUFSZ];
+ALIGN(RT_ALIGN_SIZE)
+static rt_uint8_t esp_sim_tx_buf[ESP_SIM_TX_BUFSZ];
+static struct esp_sim_device esp_sim = {0};
+
+static void esp_sim_output(const void *buf, int len)
+{
+    rt_base_t level = rt_hw_interrupt_disable();
+    rt_size_t put_len = rt_ringbuffer_put(&(esp_sim.rx_rb), buf, len);
+    rt_hw_interrupt_enable(level);
+
+    if(put_len != len)
+        LOG_W("rx buffer is full, drop %d bytes.", len - put_len);
+
+    if((put_len > 0) && esp_sim.parent.rx_indicate)
+        esp_sim.parent.rx_indicate(&(esp_sim.parent), put_len);
+}
+
+static void esp_sim_printf(const char *fmt, ...)
+{
+    char buf[ESP_SIM_CMD_MAX_LEN];
+    va_list args;
+
+    va_start(args, fmt);
+    int len = vsnprintf(buf, sizeof(buf), fmt, args);
+    va_end(args);
+
+    if(len > (int)sizeof(buf) - 1)
+        len = sizeof(buf) - 1;
+    if(len > 0)
+        esp_sim_output(buf, len);
+}
+
+static struct esp_sim_client *esp_sim_client_get(int link_id)
+{
+    if((link_id < 0) || (link_id >= ESP_SIM_CLIENT_NUM))
+        return RT_NULL;
+
+    return &(esp_sim.clients[link_id]);
+}
+
+static void esp_sim_client_request(struct esp_sim_client *client)
+{
+    rt_uint8_t frame[12 + 10];
+    int len = 0;
+
+    client->tid++;
+    /* MBAP */
+    frame[len++] = client->tid >> 8;
+    frame[len++] = client->tid & 0xFF;
+    frame[len++] = 0x00;
+    frame[len++] = 0x00;
+    frame[len++] = 0x00;
+    frame[len++] = 0x06;
+    /* 从机 1, 读 0 开始的 10 个保持寄存器 */
+    frame[len++] = 0x01;
+    frame[len++] = 0x03;
+    frame[len++] = 0x00;
+    frame[len++] = 0x00;
+    frame[len++] = 0x00;
+    frame[len++] = 0x0A;
+
+    client->wait_rsp = 1;
+    client->send_tick = rt_tick_get();
+    reactor_timer_start(&(client->timer), ESP_SIM_REQUEST_TIMEOUT);
+
+    esp_sim_printf("\r\n+IPD,%d,%d:", client->link_id, len);
+    esp_sim_output(frame, len);
+}
+
+static void esp_sim_client_timer_handler(reactor_timer_t timer)
+{
+    struct esp_sim_client *client = (struct esp_sim_client *)timer->user_data;
+
+    if(!esp_sim.server_on)
+        return;
+
+    if(client->state == ESP_SIM_CLIENT_CLOSED)
+    {
+        client->state = ESP_SIM_CLIENT_CONNECTED;
+        client->wait_rsp = 0;
+        esp_sim_printf("%d,CONNECT\r\n", client->link_id);
+    }
+    else if(client->wait_rsp)
+    {
+        esp_sim.stat.timeout_cnt++;
+    }
+
+    esp_sim_client_request(client);
+}
+
+static void esp_sim_client_close(struct esp_sim_client *client, rt_int32_t reconnect_delay)
+{
+    client->state = ESP_SIM_CLIENT_CLOSED;
+    client->wait_rsp = 0;
+    client->rsp_len = 0;
+
+    if(reconnect_delay >= 0)
+        reactor_timer_start(&(client->timer), reconnect_delay);
+    else
+        reactor_timer_stop(&(client->timer));
+}
+
+/* 从 AT+CIPSEND 的数据中取出完整的 Modbus TCP 响应并统计延时 */
+static void esp_sim_client_response(struct esp_sim_client *client)
+{
+    while(client->rsp_len >= 7)
+    {
+        int frame_len = 6 + ((client->rsp_buf[4] << 8) | client->rsp_buf[5]);
+        if(frame_len > ESP_SIM_RSP_BUFSZ)
+        {
+            esp_sim.stat.error_cnt++;
+            client->rsp_len = 0;
+            break;
+        }
+
+        if(client->rsp_len < frame_len)
+            break;
+
+        rt_uint16_t tid = (client->rsp_buf[0] << 8) | client->rsp_buf[1];
+        if(client->wait_rsp && (tid == client->tid))
+        {
+            rt_tick_t latency = rt_tick_get() - client->send_tick;
+            if(latency >= ESP_SIM_HIST_SIZE)
+                latency = ESP_SIM_HIST_SIZE - 1;
+
+            esp_sim.stat.hist[latency]++;
+            esp_sim.stat.trans_cnt++;
+            client->wait_rsp = 0;
+
+            if(client->rsp_buf[7] & 0x80)
+                esp_sim.stat.error_cnt++;
+        }
+        else
+        {
+            esp_sim.stat.error_cnt++;
+        }
+
+        client->rsp_len -= frame_len;
+        if(client->rsp_len > 0)
+            rt_memmove(client->rsp_buf, client->rsp_buf + frame_len, client->rsp_len);
+    }
+
+    if(!client->wait_rsp && (client->state == ESP_SIM_CLIENT_CONNECTED))
+        reactor_timer_start(&(client->timer), ESP_SIM_REQUEST_INTERVAL);
+}
+
+static void esp_sim_smart_timer_handler(reactor_timer_t timer)
+{
+    if(esp_sim.smart_on)
+        esp_sim_printf("smartconfig connected wifi\r\n");
+}
+
+static void esp_sim_cmd_process(char *cmd)
+{
+    int link_id = 0, len = 0;
+
+    if(!strcmp(cmd, "AT") || !strcmp(cmd, "ATE0") || !strncmp(cmd, "AT+CWMODE_DEF=", 14) ||
+       !strncmp(cmd, "AT+CWAUTOCONN=", 14) || !strncmp(cmd, "AT+CIPMODE=", 11) ||
+       !strncmp(cmd, "AT+CIPDINFO=", 12) || !strncmp(cmd, "AT+CIPMUX=", 10) || !strncmp(cmd, "AT+CIPSTO=", 10))
+    {
+        esp_sim_printf("\r\nOK\r\n");
+    }
+    else if(!strcmp(cmd, "AT+GMR"))
+    {
+        esp_sim_printf("AT version:1.7.4.0(simulator)\r\nSDK version:3.0.4\r\n\r\nOK\r\n");
+    }
+    else if(!strncmp(cmd, "AT+CWSTARTSMART", 15))
+    {
+        esp_sim.smart_on = 1;
+        esp_sim_printf("\r\nOK\r\n");
+        reactor_timer_start(&(esp_sim.smart_timer), 1000);
+    }
+    else if(!strcmp(cmd, "AT+CWSTOPSMART"))
+    {
+        esp_sim.smart_on = 0;
+        esp_sim_printf("\r\nOK\r\n");
+    }
+    else if(!strcmp(cmd, "AT+CWJAP_CUR?"))
+    {
+        esp_sim_printf("+CWJAP_CUR:\"esp_sim\",\"aa:bb:cc:dd:ee:ff\",1,-40\r\n\r\nOK\r\n");
+    }
+    else if(!strcmp(cmd, "AT+CIPSTA_CUR?"))
+    {
+        esp_sim_printf("+CIPSTA_CUR:ip:\"192.168.1.100\"\r\n");
+        esp_sim_printf("+CIPSTA_CUR:gateway:\"192.168.1.1\"\r\n");
+        esp_sim_printf("+CIPSTA_CUR:netmask:\"255.255.255.0\"\r\n\r\nOK\r\n");
+    }
+    else if(!strcmp(cmd, "AT+CIPSTATUS"))
+    {
+        esp_sim_printf("STATUS:2\r\n");
+        for (int i = 0; i < ESP_SIM_CLIENT_NUM; i++)
+        {
+            if(esp_sim.clients[i].state == ESP_SIM_CLIENT_CONNECTED)
+                esp_sim_printf("+CIPSTATUS:%d,\"TCP\",\"192.168.1.%d\",%d,502,1\r\n", i, 10 + i, 50000 + i);
+        }
+        esp_sim_printf("\r\nOK\r\n");
+    }
+    else if(sscanf(cmd, "AT+CIPSERVER=%d,%d", &link_id, &len) == 2)
+    {
+        esp_sim.server_on = link_id;
+        esp_sim_printf("\r\nOK\r\n");
+        for (int i = 0; i < ESP_SIM_CLIENT_NUM; i++)
+            esp_sim_client_close(&(esp_sim.clients[i]), esp_sim.server_on ? ESP_SIM_CONNECT_DELAY + i * 10 : -1);
+    }
+    else if(sscanf(cmd, "AT+CIPCLOSE=%d", &link_id) == 1)
+    {
+        struct esp_sim_client *client = esp_sim_client_get(link_id);
+        if((client == RT_NULL) || (client->state != ESP_SIM_CLIENT_CONNECTED))
+        {
+            esp_sim_printf("\r\nERROR\r\n");
+            return;
+        }
+
+        /* 被服务端关闭后重新连接 */
+        esp_sim_client_close(client, 100);
+        esp_sim_printf("%d,CLOSED\r\n\r\nOK\r\n", link_id);
+    }
+    else if(sscanf(cmd, "AT+CIPSEND=%d,%d", &link_id, &len) == 2)
+    {
+        struct esp_sim_client *client = esp_sim_client_get(link_id);
+        if((client == RT_NULL) || (client->state != ESP_SIM_CLIENT_CONNECTED) || (len <= 0) || (len > 2048))
+        {
+            esp_sim_printf("link is not valid\r\n\r\nERROR\r\n");
+            return;
+        }
+
+        esp_sim.data_link = link_id;
+        esp_sim.data_remain = len;
+        esp_sim.data_len = len;
+        esp_sim_printf("\r\nOK\r\n> ");
+    }
+    else
+    {
+        esp_sim_printf("\r\nERROR\r\n");
+    }
+}
+
+static void esp_sim_data_process(const rt_uint8_t *buf, int len)
+{
+    struct esp_sim_client *client = esp_sim_client_get(esp_sim.data_link);
+
+    if(client->rsp_len + len <= ESP_SIM_RSP_BUFSZ)
+    {
+        rt_memcpy(client->rsp_buf + client->rsp_len, buf, len);
+        client->rsp_len += len;
+    }
+    else
+    {
+        esp_sim.stat.error_cnt++;
+        client->rsp_len = 0;
+    }
+
+    esp_sim.data_remain -= len;
+    if(esp_sim.data_remain > 0)
+        return;
+
+    esp_sim_printf("\r\nRecv %d bytes\r\n\r\nSEND OK\r\n", esp_sim.data_len);
+    esp_sim_client_response(client);
+}
+
+static void esp_sim_input(const rt_uint8_t *buf, rt_size_t size)
+{
+    rt_size_t index = 0;
+
+    while(index < size)
+    {
+        if(esp_sim.data_remain > 0)
+        {
+            int len = size - index;
+            if(len > esp_sim.data_remain)
+                len = esp_sim.data_remain;
+
+            esp_sim_data_process(buf + index, len);
+            index += len;
+            continue;
+        }
+
+        char ch = buf[index++];
+        if(ch == '\r')
+            continue;
+
+        if(ch != '\n')
+        {
+            if(esp_sim.cmd_len < ESP_SIM_CMD_MAX_LEN - 1)
+                esp_sim.cmd_buf[esp_sim.cmd_len++] = ch;
+            continue;
+        }
+
+        esp_sim.cmd_buf[esp_sim.cmd_len] = '\0';
+        if(esp_sim.cmd_len > 0)
+            esp_sim_cmd_process(esp_sim.cmd_buf);
+        esp_sim.cmd_len = 0;
+    }
+}
+
+/* 在 reactor 线程中解析写入的数据, 与客户端定时器不会同时访问客户端状态 */
+static void esp_sim_tx_work_handler(reactor_work_t work)
+{
+    rt_uint8_t buf[64];
+    rt_size_t len;
+
+    while(1)
+    {
+        rt_base_t level = rt_hw_interrupt_disable();
+        if(esp_sim.tx_reset)
+        {
+            esp_sim.tx_reset = 0;
+            esp_sim.cmd_len = 0;
+            esp_sim.data_remain = 0;
+        }
+        len = rt_ringbuffer_get(&(esp_sim.tx_rb), buf, sizeof(buf));
+        rt_hw_interrupt_enable(level);
+
+        if(len == 0)
+            break;
+
+        esp_sim_input(buf, len);
+    }
+}
+
+static rt_err_t _esp_sim_init(usr_device_t dev)
+{
+    rt_base_t level = rt_hw_interrupt_disable();
+    rt_ringbuffer_reset(&(esp_sim.rx_rb));
+    rt_ringbuffer_reset(&(esp_sim.tx_rb));
+    esp_sim.tx_reset = 1;
+    rt_hw_interrupt_enable(level);
+
+    reactor_work_submit(&(esp_sim.tx_work));
+
+    return RT_EOK;
+}
+
+static rt_size_t _esp_sim_read(usr_device_t dev, rt_off_t pos, void *buffer, rt_size_t size)
+{
+    rt_base_t level = rt_hw_interrupt_disable();
+    rt_size_t len = rt_ringbuffer_get(&(esp_sim.rx_rb), buffer, size);
+    rt_hw_interrupt_enable(level);
+
+    return len;
+}
+
+/* 与串口一样只写入发送缓冲区, 缓冲区满时返回实际写入的长度 */
+static rt_size_t _esp_sim_write(usr_device_t dev, rt_off_t pos, const void *buffer, rt_size_t size)
+{
+    rt_base_t level = rt_hw_interrupt_disable();
+    rt_size_t len = rt_ringbuffer_put(&(esp_sim.tx_rb), buffer, size);
+    rt_hw_interrupt_enable(level);
+
+    if(len > 0)
+        reactor_work_submit(&(esp_sim.tx_work));
+
+    return len;
+}
+
+static rt_err_t _esp_sim_control(usr_device_t dev, int cmd, void *args)
+{
+    /* 串口参数及缓冲区设置无意义, 直接返回成功 */
+    return RT_EOK;
+}
+
+static int _hw_esp_sim_init(void)
+{
+    rt_ringbuffer_init(&(esp_sim.rx_rb), esp_sim_rx_buf, sizeof(esp_sim_rx_buf));
+    rt_ringbuffer_init(&(esp_sim.tx_rb), esp_sim_tx_buf, sizeof(esp_sim_tx_buf));
+    reactor_work_init(&(esp_sim.tx_work), esp_sim_tx_work_handler, RT_NULL);
+    reactor_timer_init(&(esp_sim.smart_timer), esp_sim_smart_timer_handler, RT_NULL);
+    for (int i = 0; i < ESP_SIM_CLIENT_NUM; i++)
+    {
+        esp_sim.clients[i].link_id = i;
+        esp_sim.clients[i].state = ESP_SIM_CLIENT_CLOSED;
+        reactor_timer_init(&(esp_sim.clients[i].timer), esp_sim_client_timer_handler, &(esp_sim.clients[i]));
+    }
+    esp_sim.stat.start_tick = rt_tick_get();
+
+    esp_sim.parent.init = _esp_sim_init;
+    esp_sim.parent.read = _esp_sim_read;
+    esp_sim.parent.write = _esp_sim_write;
+    esp_sim.parent.control = _esp_sim_control;
+
+    usr_device_register(&(esp_sim.parent), ESP_SIM_DEVICE_NAME);
+
+    return RT_EOK;
+}
+INIT_BOARD_EXPORT(_hw_esp_sim_init);
+
+static rt_uint32_t esp_sim_percentile(rt_uint32_t total, int percent)
+{
+    rt_uint32_t target = (total * percent + 99) / 100;
+    rt_uint32_t sum = 0;
+
+    for (int i = 0; i < ESP_SIM_HIST_SIZE; i++)
+    {
+        sum += esp_sim.stat.hist[i];
+        if(sum >= target)
+            return i;
+    }
+
+    return ESP_SIM_HIST_SIZE - 1;
+}
+
+static void esp_sim_stat_print(void)
+{
+    struct esp_sim_stat stat = esp_sim.stat;
+    rt_tick_t elapsed = rt_tick_get() - stat.start_tick;
+    if(elapsed == 0)
+        elapsed = 1;
+
+    rt_uint32_t tps_x100 = (rt_uint64_t)stat.trans_cnt * RT_TICK_PER_SECOND * 100 / elapsed;
+
+    LOG_I("clients:%d, time:%ums, trans:%u, timeout:%u, error:%u", ESP_SIM_CLIENT_NUM,
+          elapsed * 1000 / RT_TICK_PER_SECOND, stat.trans_cnt, stat.timeout_cnt, stat.error_cnt);
+    LOG_I("tps:%u.%02u", tps_x100 / 100, tps_x100 % 100);
+    if(stat.trans_cnt > 0)
+    {
+        LOG_I("latency(ms) p50:%u, p90:%u, p99:%u (%u means >= %u)",
+              esp_sim_percentile(stat.trans_cnt, 50), esp_sim_percentile(stat.trans_cnt, 90),
+              esp_sim_percentile(stat.trans_cnt, 99), ESP_SIM_HIST_SIZE - 1, ESP_SIM_HIST_SIZE - 1);
+    }
+}
+
+static void esp_sim_stat_reset(void)
+{
+    rt_base_t level = rt_hw_interrupt_disable();
+    rt_memset(&(esp_sim.stat), 0, sizeof(esp_sim.stat));
+    esp_sim.stat.start_tick = rt_tick_get();
+    rt_hw_interrupt_enable(level);
+}
+
+static int esp_sim_stat(int argc, char **argv)
+{
+    if((argc > 1) && !strcmp(argv[1], "reset"))
+    {
+        esp_sim_stat_reset();
+        return RT_EOK;
+    }
+
+    esp_sim_stat_print();
+
+    return RT_EOK;
+}
+MSH_CMD_EXPORT(esp_sim_stat, esp_sim_stat [reset]: esp8266 simulator transactions and latency);
+
+#endif /* ESP_SIM_USING */
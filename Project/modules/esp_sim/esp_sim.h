@@ -0,0 +1,32 @@
+#ifndef __ESP_SIM_H
+#define __ESP_SIM_H
+#include <rtthread.h>
+
+#define ESP_SIM_DEVICE_NAME             "esp_sim"
+
+#ifndef ESP_SIM_CLIENT_NUM
+#define ESP_SIM_CLIENT_NUM              4
+#endif
+
+/* 收到响应后到下一次请求的间隔(ms), 0 为闭环连续请求 */
+#ifndef ESP_SIM_REQUEST_INTERVAL
+#define ESP_SIM_REQUEST_INTERVAL        0
+#endif
+
+#ifndef ESP_SIM_REQUEST_TIMEOUT
+#define ESP_SIM_REQUEST_TIMEOUT         1000
+#endif
+
+#ifndef ESP_SIM_RX_BUFSZ
+#define ESP_SIM_RX_BUFSZ                1024
+#endif
+
+/* 写入的数据先放入发送缓冲区, 在 reactor 线程中解析, 需能放下一条 AT 命令 */
+#ifndef ESP_SIM_TX_BUFSZ
+#define ESP_SIM_TX_BUFSZ                1024
+#endif
+
+/* 延时直方图, 每格 1ms, 最后一格为溢出 */
+#define ESP_SIM_HIST_SIZE               128
+
+#endif
@@ -13,13 +13,71 @@
 #define OLED_DC_PIN         8
 #define OLED_CS_PIN         9
 
+/* 一个窗口的寻址命令: 列范围 0x21 + 页范围 0x22 */
+#define OLED_WINDOW_CMD_SIZE    6
+/* 排队的命令一段, 最坏每页一个窗口, 每个窗口一段命令 + 一段数据 */
+#define OLED_SEG_MAX            (1 + OLED_PAGE_NUM * 2)
+
 SPI_HandleTypeDef hspi3;
 DMA_HandleTypeDef hdma_spi3_tx;
 
+/* DMA 链中的一段, dc 为发送时 D/C 引脚的电平 */
+struct oled_seg
+{
+    const rt_uint8_t *buf;
+    rt_uint16_t len;
+    rt_uint8_t dc;
+};
+
 ALIGN(RT_ALIGN_SIZE)
-static rt_uint8_t oled_gram[8][128] = {0};
+static rt_uint8_t oled_gram[OLED_PAGE_NUM][OLED_WIDTH] = {0};
+/* 每页需要刷新的列范围 [start, end], start > end 表示没有改变 */
+static rt_uint8_t oled_dirty_start[OLED_PAGE_NUM];
+static rt_uint8_t oled_dirty_end[OLED_PAGE_NUM];
+static rt_uint8_t oled_window_cmd[OLED_PAGE_NUM][OLED_WINDOW_CMD_SIZE];
+/* 等待发送的命令, 发送时拷贝到 oled_cmd_tx, 发送期间可继续排队 */
+static rt_uint8_t oled_cmd_queue[OLED_CMD_QUEUE_SIZE];
+static rt_uint8_t oled_cmd_tx[OLED_CMD_QUEUE_SIZE];
+static rt_uint16_t oled_cmd_len = 0;
+static struct oled_seg oled_seg_tab[OLED_SEG_MAX];
+static rt_uint8_t oled_seg_num = 0;
+static rt_uint8_t oled_seg_index = 0;
+/* DMA 链发送中 */
+static rt_uint8_t oled_busy = 0;
 static struct usr_device_oled oled_device = {0};
 
+static const rt_uint8_t oled_init_cmd[] =
+{
+    0xAE, //--turn off oled panel
+    0x00, //---set low column address
+    0x10, //---set high column address
+    0x40, //--set start line address  Set Mapping RAM Display Start Line (0x00~0x3F)
+    0x81, //--set contrast control register
+    0xCF, // Set SEG Output Current Brightness
+    0xA1, //--Set SEG/Column Mapping
+    0xC8, //Set COM/Row Scan Direction
+    0xA6, //--set normal display
+    0xA8, //--set multiplex ratio(1 to 64)
+    0x3f, //--1/64 duty
+    0xD3, //-set display offset	Shift Mapping RAM Counter (0x00~0x3F)
+    0x00, //-not offset
+    0xd5, //--set display clock divide ratio/oscillator frequency
+    0x80, //--set divide ratio, Set Clock as 100 Frames/Sec
+    0xD9, //--set pre-charge period
+    0xF1, //Set Pre-Charge as 15 Clocks & Discharge as 1 Clock
+    0xDA, //--set com pins hardware configuration
+    0x12,
+    0xDB, //--set vcomh
+    0x40, //Set VCOM Deselect Level
+    0x20, //-Set Horizontal addressing mode (0x00/0x01/0x02)
+    0x00, //
+    0x8D, //--set Charge Pump enable/disable
+    0x14, //--set(0x10) disable
+    0xA4, // Disable Entire Display On (0xa4/0xa5)
+    0xA6, // Disable Inverse Display On (0xa6/a7)
+    0xAF, //--turn on oled panel
+};
+
 static void _oled_hw_init(void)
 {
     static rt_uint8_t init_ok = 0;
@@ -58,36 +116,195 @@ static void _oled_hw_init(void)
     rt_hw_interrupt_enable(level);
 }
 
-static void _oled_write_cmd(rt_uint8_t cmd)
+/* 以下 dirty 及发送相关函数需关中断调用 */
+static void _oled_dirty_clear(int page)
 {
-    rt_sem_take(&(oled_device.sem_lock), RT_WAITING_FOREVER);
+    oled_dirty_start[page] = 0xFF;
+    oled_dirty_end[page] = 0;
+}
 
-    drv_pin_write(OLED_DC_PIN, PIN_LOW);
-    drv_pin_write(OLED_CS_PIN, PIN_LOW);
+static void _oled_dirty_mark(int page, int start, int end)
+{
+    if(start < oled_dirty_start[page])
+        oled_dirty_start[page] = start;
+    if(end > oled_dirty_end[page])
+        oled_dirty_end[page] = end;
+}
 
-    HAL_SPI_Abort(&hspi3);
-    HAL_SPI_Transmit(&hspi3, &cmd, 1, 1000);
+static int _oled_is_dirty(void)
+{
+    for (int page = 0; page < OLED_PAGE_NUM; page++)
+    {
+        if(oled_dirty_start[page] <= oled_dirty_end[page])
+            return 1;
+    }
 
-    drv_pin_write(OLED_CS_PIN, PIN_HIGH);
-    drv_pin_write(OLED_DC_PIN, PIN_HIGH);
+    return 0;
+}
+
+/**
+ * 把排队的命令和改变的区域组成 DMA 链, 命令在前.
+ * 相邻且列范围相同的页合并成一个窗口, 水平寻址模式下窗口内按页依次写入, 只需一次寻址.
+ *
+ * @param refresh 是否包含改变的区域
+ */
+static void _oled_build_chain(int refresh)
+{
+    int page = 0, last, window = 0;
+    rt_uint8_t start, end;
+    rt_uint8_t *cmd;
+
+    oled_seg_num = 0;
+    oled_seg_index = 0;
+
+    if(oled_cmd_len > 0)
+    {
+        rt_memcpy(oled_cmd_tx, oled_cmd_queue, oled_cmd_len);
+        oled_seg_tab[oled_seg_num].buf = oled_cmd_tx;
+        oled_seg_tab[oled_seg_num].len = oled_cmd_len;
+        oled_seg_tab[oled_seg_num].dc = PIN_LOW;
+        oled_seg_num++;
+        oled_cmd_len = 0;
+    }
+
+    if(!refresh)
+        return;
+
+    while(page < OLED_PAGE_NUM)
+    {
+        start = oled_dirty_start[page];
+        end = oled_dirty_end[page];
+        if(start > end)
+        {
+            page++;
+            continue;
+        }
 
-    rt_sem_release(&(oled_device.sem_lock));
+        last = page;
+        while((last + 1 < OLED_PAGE_NUM) && (oled_dirty_start[last + 1] == start) && (oled_dirty_end[last + 1] == end))
+            last++;
+
+        cmd = oled_window_cmd[window++];
+        cmd[0] = 0x21;
+        cmd[1] = start;
+        cmd[2] = end;
+        cmd[3] = 0x22;
+        cmd[4] = page;
+        cmd[5] = last;
+        oled_seg_tab[oled_seg_num].buf = cmd;
+        oled_seg_tab[oled_seg_num].len = OLED_WINDOW_CMD_SIZE;
+        oled_seg_tab[oled_seg_num].dc = PIN_LOW;
+        oled_seg_num++;
+
+        for (; page <= last; page++)
+        {
+            oled_seg_tab[oled_seg_num].buf = &oled_gram[page][start];
+            oled_seg_tab[oled_seg_num].len = end - start + 1;
+            oled_seg_tab[oled_seg_num].dc = PIN_HIGH;
+            oled_seg_num++;
+
+            _oled_dirty_clear(page);
+        }
+    }
 }
 
-static void _oled_refresh_gram(void)
+static void _oled_send_seg(void)
 {
-    rt_sem_take(&(oled_device.sem_lock), RT_WAITING_FOREVER);
+    struct oled_seg *seg = &oled_seg_tab[oled_seg_index];
+
+    drv_pin_write(OLED_DC_PIN, seg->dc);
+    HAL_SPI_Transmit_DMA(&hspi3, (uint8_t *)seg->buf, seg->len);
+}
+
+/**
+ * 总线空闲时启动下一条 DMA 链: 命令立即发送, 改变的区域距上次刷新不足 OLED_REFRESH_INTERVAL 时推迟.
+ * 总线忙时由 DMA 链结束后再次调用.
+ *
+ * @return 需要推迟刷新的时间 (ms), 0: 不需要
+ */
+static rt_int32_t _oled_kick(void)
+{
+    rt_tick_t interval = rt_tick_from_millisecond(OLED_REFRESH_INTERVAL);
+    rt_tick_t elapsed;
+    rt_int32_t delay = 0;
+    int refresh = 0;
+
+    if(oled_busy)
+        return 0;
+
+    if(_oled_is_dirty())
+    {
+        elapsed = rt_tick_get() - oled_device.refresh_tick;
+        if(elapsed >= interval)
+            refresh = 1;
+        else
+            delay = (interval - elapsed) * 1000 / RT_TICK_PER_SECOND + 1;
+    }
+
+    _oled_build_chain(refresh);
+    if(oled_seg_num == 0)
+        return delay;
+
+    oled_busy = 1;
+    if(refresh)
+        oled_device.refresh_tick = rt_tick_get();
 
-    drv_pin_write(OLED_DC_PIN, PIN_HIGH);
     drv_pin_write(OLED_CS_PIN, PIN_LOW);
+    _oled_send_seg();
 
-    HAL_SPI_Abort(&hspi3);
-    HAL_SPI_Transmit_DMA(&hspi3, oled_gram[0], sizeof(oled_gram));
+    return delay;
+}
+
+static void _oled_delay_refresh(rt_int32_t delay)
+{
+    /* 已在等待的不重新计时, 避免连续更新时一直推迟 */
+    if((delay > 0) && !oled_device.timer.active)
+        reactor_timer_start(&(oled_device.timer), delay);
+}
+
+static void _oled_refresh_gram(void)
+{
+    rt_base_t level = rt_hw_interrupt_disable();
+    rt_int32_t delay = _oled_kick();
+    rt_hw_interrupt_enable(level);
+
+    _oled_delay_refresh(delay);
+}
+
+/* 命令排队后立即返回, 可在中断中调用 */
+static rt_err_t _oled_write_cmd(const rt_uint8_t *cmd, rt_size_t len)
+{
+    rt_int32_t delay;
+    rt_base_t level = rt_hw_interrupt_disable();
+
+    if(len > OLED_CMD_QUEUE_SIZE - oled_cmd_len)
+    {
+        rt_hw_interrupt_enable(level);
+        return -RT_EFULL;
+    }
+
+    rt_memcpy(&oled_cmd_queue[oled_cmd_len], cmd, len);
+    oled_cmd_len += len;
+    delay = _oled_kick();
+
+    rt_hw_interrupt_enable(level);
+
+    _oled_delay_refresh(delay);
+
+    return RT_EOK;
+}
+
+static void _oled_timer_handler(reactor_timer_t timer)
+{
+    _oled_refresh_gram();
 }
 
 static rt_err_t _oled_init(usr_device_t dev)
 {
-    rt_sem_init(&(oled_device.sem_lock), "oled", 1, RT_IPC_FLAG_FIFO);
+    reactor_timer_init(&(oled_device.timer), _oled_timer_handler, RT_NULL);
+
+    for (int page = 0; page < OLED_PAGE_NUM; page++)
+        _oled_dirty_clear(page);
 
     _oled_hw_init();
 
@@ -98,40 +315,67 @@ static rt_err_t _oled_init(usr_device_t dev)
     drv_pin_write(OLED_RES_PIN, PIN_HIGH);
     rt_thread_mdelay(100);
 
-    _oled_write_cmd(0xAE);//--turn off oled panel
-	_oled_write_cmd(0x00);//---set low column address
-	_oled_write_cmd(0x10);//---set high column address
-	_oled_write_cmd(0x40);//--set start line address  Set Mapping RAM Display Start Line (0x00~0x3F)
-	_oled_write_cmd(0x81);//--set contrast control register
-	_oled_write_cmd(0xCF); // Set SEG Output Current Brightness
-	_oled_write_cmd(0xA1);//--Set SEG/Column Mapping
-	_oled_write_cmd(0xC8);//Set COM/Row Scan Direction
-	_oled_write_cmd(0xA6);//--set normal display
-	_oled_write_cmd(0xA8);//--set multiplex ratio(1 to 64)
-	_oled_write_cmd(0x3f);//--1/64 duty
-	_oled_write_cmd(0xD3);//-set display offset	Shift Mapping RAM Counter (0x00~0x3F)
-	_oled_write_cmd(0x00);//-not offset
-	_oled_write_cmd(0xd5);//--set display clock divide ratio/oscillator frequency
-	_oled_write_cmd(0x80);//--set divide ratio, Set Clock as 100 Frames/Sec
-	_oled_write_cmd(0xD9);//--set pre-charge period
-	_oled_write_cmd(0xF1);//Set Pre-Charge as 15 Clocks & Discharge as 1 Clock
-	_oled_write_cmd(0xDA);//--set com pins hardware configuration
-	_oled_write_cmd(0x12);
-	_oled_write_cmd(0xDB);//--set vcomh
-	_oled_write_cmd(0x40);//Set VCOM Deselect Level
-	_oled_write_cmd(0x20);//-Set Horizontal addressing mode (0x00/0x01/0x02)
-	_oled_write_cmd(0x00);//
-	_oled_write_cmd(0x8D);//--set Charge Pump enable/disable
-	_oled_write_cmd(0x14);//--set(0x10) disable
-	_oled_write_cmd(0xA4);// Disable Entire Display On (0xa4/0xa5)
-	_oled_write_cmd(0xA6);// Disable Inverse Display On (0xa6/a7) 
-	_oled_write_cmd(0xAF);//--turn on oled panel
+    _oled_write_cmd(oled_init_cmd, sizeof(oled_init_cmd));
+
+    rt_base_t level = rt_hw_interrupt_disable();
+    for (int page = 0; page < OLED_PAGE_NUM; page++)
+        _oled_dirty_mark(page, 0, OLED_WIDTH - 1);
+    oled_device.refresh_tick = rt_tick_get() - rt_tick_from_millisecond(OLED_REFRESH_INTERVAL);
+    rt_hw_interrupt_enable(level);
 
     _oled_refresh_gram();
 
     return RT_EOK;
 }
 
+/* pos 为显存中的字节偏移 (页 * 128 + 列), 只有内容改变的列需要刷新 */
+static rt_size_t _oled_write(usr_device_t dev, rt_off_t pos, const void *buffer, rt_size_t size)
+{
+    const rt_uint8_t *src = buffer;
+    rt_size_t written = 0;
+
+    if((pos < 0) || (pos >= sizeof(oled_gram)))
+        return 0;
+
+    if(size > sizeof(oled_gram) - pos)
+        size = sizeof(oled_gram) - pos;
+
+    while(written < size)
+    {
+        int page = (pos + written) / OLED_WIDTH;
+        int col = (pos + written) % OLED_WIDTH;
+        int len = OLED_WIDTH - col;
+        int first = -1, last = -1;
+        rt_uint8_t *dst = &oled_gram[page][col];
+
+        if(len > size - written)
+            len = size - written;
+
+        for (int i = 0; i < len; i++)
+        {
+            if(dst[i] == src[i])
+                continue;
+
+            dst[i] = src[i];
+            if(first < 0)
+                first = i;
+            last = i;
+        }
+
+        if(first >= 0)
+        {
+            rt_base_t level = rt_hw_interrupt_disable();
+            _oled_dirty_mark(page, col + first, col + last);
+            rt_hw_interrupt_enable(level);
+        }
+
+        src += len;
+        written += len;
+    }
+
+    return size;
+}
+
 static rt_err_t _oled_control(usr_device_t dev, int cmd, void *args)
 {
     rt_err_t result = -RT_ERROR;
@@ -140,11 +384,39 @@ static rt_err_t _oled_control(usr_device_t dev, int cmd, void *args)
     {
         case USR_DEVICE_OLED_CMD_RECT_UPDATE:
         {
+            struct usr_device_oled_rect *rect = args;
+
+            if(rect && (rect->width > 0) && (rect->height > 0) &&
+               (rect->x < OLED_WIDTH) && (rect->y < OLED_PAGE_NUM * 8))
+            {
+                int end = rect->x + rect->width - 1;
+                int last = (rect->y + rect->height - 1) / 8;
+
+                if(end >= OLED_WIDTH)
+                    end = OLED_WIDTH - 1;
+                if(last >= OLED_PAGE_NUM)
+                    last = OLED_PAGE_NUM - 1;
+
+                rt_base_t level = rt_hw_interrupt_disable();
+                for (int page = rect->y / 8; page <= last; page++)
+                    _oled_dirty_mark(page, rect->x, end);
+                rt_hw_interrupt_enable(level);
+            }
+
             _oled_refresh_gram();
             result = RT_EOK;
         }
         break;
 
+        case USR_DEVICE_OLED_CMD_WRITE_CMD:
+        {
+            struct usr_device_oled_cmd *oled_cmd = args;
+
+            if(oled_cmd && oled_cmd->buf && (oled_cmd->len > 0))
+                result = _oled_write_cmd(oled_cmd->buf, oled_cmd->len);
+        }
+        break;
+
         default:
         break;
     }
@@ -159,7 +431,7 @@ static int _hw_oled_init(void)
 
     oled_device.parent.init = _oled_init;
     oled_device.parent.read = RT_NULL;
-    oled_device.parent.write = RT_NULL;
+    oled_device.parent.write = _oled_write;
     oled_device.parent.control = _oled_control;
 
     usr_device_register(&(oled_device.parent), "oled");
@@ -170,12 +442,24 @@ INIT_BOARD_EXPORT(_hw_oled_init);
 
 void HAL_SPI_TxCpltCallback(SPI_HandleTypeDef *hspi)
 {
+    /* HAL 已等待 BSY 清除, 可以直接切换 D/C */
+    if(++oled_seg_index < oled_seg_num)
+    {
+        _oled_send_seg();
+        return;
+    }
+
     drv_pin_write(OLED_CS_PIN, PIN_HIGH);
+    drv_pin_write(OLED_DC_PIN, PIN_HIGH);
 
-    rt_sem_release(&(oled_device.sem_lock));
+    oled_busy = 0;
+    oled_seg_num = 0;
 
     if(oled_device.parent.tx_complete)
         oled_device.parent.tx_complete(&(oled_device.parent), RT_NULL);
+
+    /* 发送期间排队的命令或又有改变的区域 */
+    _oled_delay_refresh(_oled_kick());
 }
 
 void DMA2_Channel2_IRQHandler(void)
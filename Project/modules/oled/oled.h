@@ -2,13 +2,44 @@
 #define __OLED_H
 #include <rtthread.h>
 #include "usr_device.h"
+#include "reactor.h"
 
+#define OLED_WIDTH                          128
+#define OLED_PAGE_NUM                       8
+
+/* 命令队列大小, 需能放下初始化命令 */
+#define OLED_CMD_QUEUE_SIZE                 64
+
+/* 两次刷新的最小间隔 (ms), 期间的更新合并到下一次刷新 */
+#define OLED_REFRESH_INTERVAL               20
+
+/**
+ * args: RT_NULL 只刷新写入时改变的区域
+ *       struct usr_device_oled_rect * 先将该区域标记为需要刷新
+ */
 #define USR_DEVICE_OLED_CMD_RECT_UPDATE     0x01
+/* args: struct usr_device_oled_cmd *, 排队后立即返回 */
+#define USR_DEVICE_OLED_CMD_WRITE_CMD       0x02
+
+struct usr_device_oled_rect
+{
+    rt_uint8_t x;
+    rt_uint8_t y;
+    rt_uint8_t width;
+    rt_uint8_t height;
+};
+
+struct usr_device_oled_cmd
+{
+    const rt_uint8_t *buf;
+    rt_size_t len;
+};
 
 struct usr_device_oled
 {
     struct usr_device parent;
-    struct rt_semaphore sem_lock;
+    struct reactor_timer timer;
+    rt_tick_t refresh_tick;
 };
 
 #endif
@@ -0,0 +1,262 @@
+#include "reactor.h"
+#include <rthw.h>
+
+#define DBG_ENABLE
+#define DBG_COLOR
+#define DBG_SECTION_NAME    "reactor"
+#define DBG_LEVEL           DBG_INFO
+#include <rtdbg.h>
+
+#define REACTOR_EVENT_WAKEUP            (1UL << 0)
+
+ALIGN(RT_ALIGN_SIZE)
+static rt_uint8_t reactor_thread_stack[REACTOR_THREAD_STACK_SIZE];
+static struct rt_thread reactor_thread;
+static struct rt_event reactor_event;
+
+static reactor_source_t source_table[REACTOR_SOURCE_MAX] = {0};
+/* 所有定时器共用一个时间轮, 在 reactor 线程中到期 */
+static struct timer_wheel timer_wheel;
+static rt_slist_t work_header = RT_SLIST_OBJECT_INIT(work_header);
+
+int reactor_source_register(reactor_source_t source, void (*handler)(reactor_source_t source), void *user_data)
+{
+    rt_base_t level;
+    int i;
+
+    RT_ASSERT(source);
+    RT_ASSERT(handler);
+
+    level = rt_hw_interrupt_disable();
+
+    for (i = 0; i < REACTOR_SOURCE_MAX; i++)
+    {
+        if (source_table[i] == RT_NULL)
+            break;
+    }
+
+    if (i >= REACTOR_SOURCE_MAX)
+    {
+        rt_hw_interrupt_enable(level);
+        LOG_E("source table is full.");
+        return -RT_ERROR;
+    }
+
+    source->event = (1UL << (i + 1));
+    source->handler = handler;
+    source->user_data = user_data;
+    source_table[i] = source;
+
+    rt_hw_interrupt_enable(level);
+
+    return RT_EOK;
+}
+
+/* 可在中断中调用 */
+void reactor_source_notify(reactor_source_t source)
+{
+    rt_event_send(&reactor_event, source->event);
+}
+
+void reactor_timer_init(reactor_timer_t timer, void (*handler)(reactor_timer_t timer), void *user_data)
+{
+    RT_ASSERT(timer);
+    RT_ASSERT(handler);
+
+    timer->active = 0;
+    timer->handler = handler;
+    timer->user_data = user_data;
+    timer_wheel_node_init(&(timer->node));
+}
+
+static void _reactor_timer_remove(reactor_timer_t timer)
+{
+    if (timer->active)
+    {
+        timer_wheel_remove(&timer_wheel, &(timer->node));
+        timer->active = 0;
+    }
+}
+
+/* 可在中断中调用 */
+void reactor_timer_start(reactor_timer_t timer, rt_int32_t ms)
+{
+    rt_base_t level;
+
+    RT_ASSERT(timer);
+
+    level = rt_hw_interrupt_disable();
+
+    _reactor_timer_remove(timer);
+    timer_wheel_add(&timer_wheel, &(timer->node), rt_tick_get() + rt_tick_from_millisecond(ms));
+    timer->active = 1;
+
+    rt_hw_interrupt_enable(level);
+
+    /**
+     * reactor 线程中启动的定时器在下次等待前会重新计算超时.
+     * 中断可能打断 reactor 线程计算超时之后等待之前, 必须唤醒.
+     */
+    if ((rt_interrupt_get_nest() != 0) || (rt_thread_self() != &reactor_thread))
+        rt_event_send(&reactor_event, REACTOR_EVENT_WAKEUP);
+}
+
+void reactor_timer_stop(reactor_timer_t timer)
+{
+    rt_base_t level;
+
+    RT_ASSERT(timer);
+
+    level = rt_hw_interrupt_disable();
+    _reactor_timer_remove(timer);
+    rt_hw_interrupt_enable(level);
+}
+
+void reactor_work_init(reactor_work_t work, void (*handler)(reactor_work_t work), void *user_data)
+{
+    RT_ASSERT(work);
+    RT_ASSERT(handler);
+
+    work->pending = 0;
+    work->handler = handler;
+    work->user_data = user_data;
+    rt_slist_init(&(work->slist));
+}
+
+/* 可在中断中调用, 未执行前重复提交只执行一次 */
+void reactor_work_submit(reactor_work_t work)
+{
+    rt_base_t level;
+
+    RT_ASSERT(work);
+
+    level = rt_hw_interrupt_disable();
+
+    if (!work->pending)
+    {
+        work->pending = 1;
+        rt_slist_append(&work_header, &(work->slist));
+    }
+
+    rt_hw_interrupt_enable(level);
+
+    rt_event_send(&reactor_event, REACTOR_EVENT_WAKEUP);
+}
+
+static rt_int32_t reactor_next_timeout(void)
+{
+    rt_base_t level;
+    rt_int32_t wait = RT_WAITING_FOREVER;
+    rt_tick_t next;
+
+    level = rt_hw_interrupt_disable();
+    next = timer_wheel_next(&timer_wheel, rt_tick_get());
+    rt_hw_interrupt_enable(level);
+
+    if (next == TIMER_WHEEL_FOREVER)
+        wait = RT_WAITING_FOREVER;
+    else if (next == 0)
+        wait = RT_WAITING_NO;
+    else if (next < (RT_TICK_MAX / 2))
+        wait = next;
+
+    return wait;
+}
+
+static void reactor_timer_process(void)
+{
+    rt_base_t level;
+    timer_wheel_node_t node;
+    reactor_timer_t timer;
+
+    while (1)
+    {
+        level = rt_hw_interrupt_disable();
+
+        node = timer_wheel_expire(&timer_wheel, rt_tick_get());
+        if (node == RT_NULL)
+        {
+            rt_hw_interrupt_enable(level);
+            break;
+        }
+
+        timer = rt_container_of(node, struct reactor_timer, node);
+        timer->active = 0;
+
+        rt_hw_interrupt_enable(level);
+
+        timer->handler(timer);
+    }
+}
+
+static void reactor_work_process(void)
+{
+    rt_base_t level;
+    reactor_work_t work;
+
+    while (1)
+    {
+        level = rt_hw_interrupt_disable();
+
+        if (rt_slist_isempty(&work_header))
+        {
+            rt_hw_interrupt_enable(level);
+            break;
+        }
+
+        work = rt_slist_first_entry(&work_header, struct reactor_work, slist);
+        rt_slist_remove(&work_header, &(work->slist));
+        work->pending = 0;
+
+        rt_hw_interrupt_enable(level);
+
+        work->handler(work);
+    }
+}
+
+static void reactor_source_process(rt_uint32_t recved)
+{
+    int i;
+
+    recved >>= 1;
+    for (i = 0; recved && i < REACTOR_SOURCE_MAX; i++, recved >>= 1)
+    {
+        if ((recved & 0x01) && source_table[i])
+            source_table[i]->handler(source_table[i]);
+    }
+}
+
+static void reactor_entry(void *parameter)
+{
+    rt_uint32_t recved;
+
+    while (1)
+    {
+        recved = 0;
+        rt_event_recv(&reactor_event, 0xFFFFFFFF, RT_EVENT_FLAG_OR | RT_EVENT_FLAG_CLEAR,
+                      reactor_next_timeout(), &recved);
+
+        reactor_timer_process();
+        reactor_work_process();
+        reactor_source_process(recved);
+    }
+}
+
+static int reactor_init(void)
+{
+    rt_event_init(&reactor_event, "reactor", RT_IPC_FLAG_FIFO);
+    timer_wheel_init(&timer_wheel, rt_tick_get());
+
+    rt_thread_init(&reactor_thread,
+                   "reactor",
+                   reactor_entry,
+                   RT_NULL,
+                   &reactor_thread_stack[0],
+                   sizeof(reactor_thread_stack),
+                   REACTOR_THREAD_PRIORITY,
+                   100);
+    rt_thread_startup(&reactor_thread);
+
+    return RT_EOK;
+}
+INIT_PREV_EXPORT(reactor_init);
@@ -0,0 +1,53 @@
+#ifndef __REACTOR_H
+#define __REACTOR_H
+#include <rtthread.h>
+#include "timer_wheel.h"
+
+#ifndef REACTOR_THREAD_STACK_SIZE
+#define REACTOR_THREAD_STACK_SIZE       1536
+#endif
+
+#ifndef REACTOR_THREAD_PRIORITY
+#define REACTOR_THREAD_PRIORITY         1
+#endif
+
+/* bit0 被 reactor 内部使用 (定时器/工作项唤醒), 其余每个事件源占用一位 */
+#define REACTOR_SOURCE_MAX              31
+
+struct reactor_source
+{
+    rt_uint32_t event;
+    void (*handler)(struct reactor_source *source);
+    void *user_data;
+};
+typedef struct reactor_source *reactor_source_t;
+
+struct reactor_timer
+{
+    rt_uint8_t active;
+    void (*handler)(struct reactor_timer *timer);
+    void *user_data;
+    struct timer_wheel_node node;
+};
+typedef struct reactor_timer *reactor_timer_t;
+
+struct reactor_work
+{
+    rt_uint8_t pending;
+    void (*handler)(struct reactor_work *work);
+    void *user_data;
+    rt_slist_t slist;
+};
+typedef struct reactor_work *reactor_work_t;
+
+int reactor_source_register(reactor_source_t source, void (*handler)(reactor_source_t source), void *user_data);
+void reactor_source_notify(reactor_source_t source);
+
+void reactor_timer_init(reactor_timer_t timer, void (*handler)(reactor_timer_t timer), void *user_data);
+void reactor_timer_start(reactor_timer_t timer, rt_int32_t ms);
+void reactor_timer_stop(reactor_timer_t timer);
+
+void reactor_work_init(reactor_work_t work, void (*handler)(reactor_work_t work), void *user_data);
+void reactor_work_submit(reactor_work_t work);
+
+#endif
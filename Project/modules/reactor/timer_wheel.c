@@ -0,0 +1,218 @@
+#include "timer_wheel.h"
+
+#define TIMER_WHEEL_LVL_SHIFT(lvl)      ((lvl) ? (TIMER_WHEEL_LVL0_BITS + ((lvl) - 1) * TIMER_WHEEL_LVLN_BITS) : 0)
+#define TIMER_WHEEL_LVL_SIZE(lvl)       ((lvl) ? TIMER_WHEEL_LVLN_SIZE : TIMER_WHEEL_LVL0_SIZE)
+#define TIMER_WHEEL_LVL_OFFSET(lvl)     ((lvl) ? (TIMER_WHEEL_LVL0_SIZE + ((lvl) - 1) * TIMER_WHEEL_LVLN_SIZE) : 0)
+/* 该层能容纳的最大相对时间 + 1 */
+#define TIMER_WHEEL_LVL_SPAN(lvl)       (1UL << (TIMER_WHEEL_LVL_SHIFT(lvl) + ((lvl) ? TIMER_WHEEL_LVLN_BITS : TIMER_WHEEL_LVL0_BITS)))
+
+void timer_wheel_init(timer_wheel_t tw, rt_tick_t now)
+{
+    int i;
+
+    RT_ASSERT(tw);
+
+    tw->cur = now;
+    for (i = 0; i < TIMER_WHEEL_LVL_NUM; i++)
+        tw->lvl_cnt[i] = 0;
+    rt_list_init(&(tw->expired));
+    for (i = 0; i < TIMER_WHEEL_SLOT_NUM; i++)
+        rt_list_init(&(tw->slots[i]));
+}
+
+void timer_wheel_node_init(timer_wheel_node_t node)
+{
+    RT_ASSERT(node);
+
+    rt_list_init(&(node->list));
+    node->timeout = 0;
+    node->lvl = TIMER_WHEEL_LVL_NONE;
+}
+
+/* 按相对 cur 的时间放入对应层的槽, 已到期的放入到期链表 */
+static void _timer_wheel_insert(timer_wheel_t tw, timer_wheel_node_t node)
+{
+    rt_tick_t delta = node->timeout - tw->cur;
+    rt_tick_t timeout = node->timeout;
+    int lvl;
+
+    if ((delta == 0) || (delta >= RT_TICK_MAX / 2))
+    {
+        rt_list_insert_before(&(tw->expired), &(node->list));
+        node->lvl = TIMER_WHEEL_LVL_EXPIRED;
+        return;
+    }
+
+    for (lvl = 0; lvl < TIMER_WHEEL_LVL_NUM - 1; lvl++)
+    {
+        if (delta < TIMER_WHEEL_LVL_SPAN(lvl))
+            break;
+    }
+
+    /* 超出最高层的先放在最高层最远的槽, 下移时重新计算 */
+    if (delta >= TIMER_WHEEL_LVL_SPAN(lvl))
+        timeout = tw->cur + TIMER_WHEEL_LVL_SPAN(lvl) - 1;
+
+    rt_list_insert_before(&(tw->slots[TIMER_WHEEL_LVL_OFFSET(lvl) +
+                                     ((timeout >> TIMER_WHEEL_LVL_SHIFT(lvl)) & (TIMER_WHEEL_LVL_SIZE(lvl) - 1))]),
+                          &(node->list));
+    node->lvl = lvl;
+    tw->lvl_cnt[lvl]++;
+}
+
+/* 槽中的定时器重新放入, 上层的下移一层, 第 0 层的到期 */
+static void _timer_wheel_cascade(timer_wheel_t tw, int lvl, rt_uint32_t index)
+{
+    rt_list_t *slot = &(tw->slots[TIMER_WHEEL_LVL_OFFSET(lvl) + index]);
+
+    while (!rt_list_isempty(slot))
+    {
+        timer_wheel_node_t node = rt_list_entry(slot->next, struct timer_wheel_node, list);
+
+        rt_list_remove(&(node->list));
+        tw->lvl_cnt[lvl]--;
+        _timer_wheel_insert(tw, node);
+    }
+}
+
+/* 前进一个 tick */
+static void _timer_wheel_tick(timer_wheel_t tw)
+{
+    rt_tick_t now = ++tw->cur;
+    int lvl;
+
+    for (lvl = 1; lvl < TIMER_WHEEL_LVL_NUM; lvl++)
+    {
+        if (now & ((1UL << TIMER_WHEEL_LVL_SHIFT(lvl)) - 1))
+            break;
+
+        _timer_wheel_cascade(tw, lvl, (now >> TIMER_WHEEL_LVL_SHIFT(lvl)) & (TIMER_WHEEL_LVL_SIZE(lvl) - 1));
+    }
+
+    _timer_wheel_cascade(tw, 0, now & (TIMER_WHEEL_LVL0_SIZE - 1));
+}
+
+/* 距 cur 最近一次需要处理 (到期或下移) 的 tick 数 */
+static rt_tick_t _timer_wheel_next_delta(timer_wheel_t tw)
+{
+    rt_tick_t next = TIMER_WHEEL_FOREVER;
+    int lvl;
+
+    if (!rt_list_isempty(&(tw->expired)))
+        return 0;
+
+    for (lvl = 0; lvl < TIMER_WHEEL_LVL_NUM; lvl++)
+    {
+        rt_tick_t base, delta;
+        rt_uint32_t i;
+
+        if (tw->lvl_cnt[lvl] == 0)
+            continue;
+
+        base = tw->cur >> TIMER_WHEEL_LVL_SHIFT(lvl);
+        for (i = 1; i <= TIMER_WHEEL_LVL_SIZE(lvl); i++)
+        {
+            if (rt_list_isempty(&(tw->slots[TIMER_WHEEL_LVL_OFFSET(lvl) + ((base + i) & (TIMER_WHEEL_LVL_SIZE(lvl) - 1))])))
+                continue;
+
+            delta = ((base + i) << TIMER_WHEEL_LVL_SHIFT(lvl)) - tw->cur;
+            if (delta < next)
+                next = delta;
+            break;
+        }
+    }
+
+    return next;
+}
+
+/**
+ * 添加定时器, 已在时间轮中的先调用 timer_wheel_remove
+ *
+ * @param timeout 到期时间, 不晚于 cur 的立即到期
+ */
+void timer_wheel_add(timer_wheel_t tw, timer_wheel_node_t node, rt_tick_t timeout)
+{
+    RT_ASSERT(tw);
+    RT_ASSERT(node);
+    RT_ASSERT(node->lvl == TIMER_WHEEL_LVL_NONE);
+
+    node->timeout = timeout;
+    _timer_wheel_insert(tw, node);
+}
+
+void timer_wheel_remove(timer_wheel_t tw, timer_wheel_node_t node)
+{
+    RT_ASSERT(tw);
+    RT_ASSERT(node);
+
+    if (node->lvl == TIMER_WHEEL_LVL_NONE)
+        return;
+
+    if (node->lvl < TIMER_WHEEL_LVL_NUM)
+        tw->lvl_cnt[node->lvl]--;
+
+    rt_list_remove(&(node->list));
+    node->lvl = TIMER_WHEEL_LVL_NONE;
+}
+
+/**
+ * 获取距下次需要调用 timer_wheel_expire 的 tick 数
+ *
+ * @return TIMER_WHEEL_FOREVER: 没有定时器
+ *                           0: 有定时器已到期
+ */
+rt_tick_t timer_wheel_next(timer_wheel_t tw, rt_tick_t now)
+{
+    rt_tick_t next, elapsed;
+
+    RT_ASSERT(tw);
+
+    next = _timer_wheel_next_delta(tw);
+    if (next == TIMER_WHEEL_FOREVER)
+        return TIMER_WHEEL_FOREVER;
+
+    elapsed = now - tw->cur;
+    if (elapsed >= RT_TICK_MAX / 2)
+        elapsed = 0;
+
+    return (next > elapsed) ? (next - elapsed) : 0;
+}
+
+/**
+ * 时间推进到 now, 取出一个到期的定时器. 中间没有需要处理的槽时直接跳过
+ *
+ * @return != RT_NULL: 到期的定时器, 已从时间轮中移除
+ *            RT_NULL: 没有到期的定时器
+ */
+timer_wheel_node_t timer_wheel_expire(timer_wheel_t tw, rt_tick_t now)
+{
+    timer_wheel_node_t node;
+    rt_tick_t elapsed, next;
+
+    RT_ASSERT(tw);
+
+    while (1)
+    {
+        if (!rt_list_isempty(&(tw->expired)))
+        {
+            node = rt_list_entry(tw->expired.next, struct timer_wheel_node, list);
+            rt_list_remove(&(node->list));
+            node->lvl = TIMER_WHEEL_LVL_NONE;
+            return node;
+        }
+
+        elapsed = now - tw->cur;
+        if ((elapsed == 0) || (elapsed >= RT_TICK_MAX / 2))
+            return RT_NULL;
+
+        next = _timer_wheel_next_delta(tw);
+        if ((next == TIMER_WHEEL_FOREVER) || (next > elapsed))
+        {
+            tw->cur = now;
+            return RT_NULL;
+        }
+
+        tw->cur += next - 1;
+        _timer_wheel_tick(tw);
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef __TIMER_WHEEL_H
+#define __TIMER_WHEEL_H
+#include <rtthread.h>
+
+/**
+ * 分层时间轮.
+ * 第 0 层每个槽 1 个 tick, 其余每层每个槽为下一层转一圈的时间, 到期前逐层下移.
+ * 添加和删除为 O(1), 空闲时不需要每个 tick 处理, 由 timer_wheel_next 得到下次需要处理的时间.
+ *
+ * 时间由调用者传入, 不依赖系统 tick, 本身不加锁.
+ */
+#define TIMER_WHEEL_LVL0_BITS           6
+#define TIMER_WHEEL_LVLN_BITS           4
+#define TIMER_WHEEL_LVL_NUM             4
+
+#define TIMER_WHEEL_LVL0_SIZE           (1UL << TIMER_WHEEL_LVL0_BITS)
+#define TIMER_WHEEL_LVLN_SIZE           (1UL << TIMER_WHEEL_LVLN_BITS)
+#define TIMER_WHEEL_SLOT_NUM            (TIMER_WHEEL_LVL0_SIZE + (TIMER_WHEEL_LVL_NUM - 1) * TIMER_WHEEL_LVLN_SIZE)
+
+/* 没有定时器时 timer_wheel_next 的返回值 */
+#define TIMER_WHEEL_FOREVER             RT_TICK_MAX
+
+/* 不在时间轮中 */
+#define TIMER_WHEEL_LVL_NONE            0xFF
+/* 已到期等待取出 */
+#define TIMER_WHEEL_LVL_EXPIRED         0xFE
+
+struct timer_wheel_node
+{
+    rt_list_t list;
+    rt_tick_t timeout;
+    rt_uint8_t lvl;
+};
+typedef struct timer_wheel_node *timer_wheel_node_t;
+
+struct timer_wheel
+{
+    /* 已处理到的时间 */
+    rt_tick_t cur;
+    rt_uint16_t lvl_cnt[TIMER_WHEEL_LVL_NUM];
+    rt_list_t expired;
+    rt_list_t slots[TIMER_WHEEL_SLOT_NUM];
+};
+typedef struct timer_wheel *timer_wheel_t;
+
+void timer_wheel_init(timer_wheel_t tw, rt_tick_t now);
+void timer_wheel_node_init(timer_wheel_node_t node);
+void timer_wheel_add(timer_wheel_t tw, timer_wheel_node_t node, rt_tick_t timeout);
+void timer_wheel_remove(timer_wheel_t tw, timer_wheel_node_t node);
+rt_tick_t timer_wheel_next(timer_wheel_t tw, rt_tick_t now);
+timer_wheel_node_t timer_wheel_expire(timer_wheel_t tw, rt_tick_t now);
+
+#endif
@@ -0,0 +1,210 @@
+#include "mpsc_ring.h"
+
+#define MPSC_RING_HDR_COMMIT        (1UL << 31)
+#define MPSC_RING_HDR_PAD           (1UL << 30)
+#define MPSC_RING_HDR_LEN_MASK      0xFFFFUL
+#define MPSC_RING_HDR_SIZE          4
+
+#if defined(__CC_ARM) || (defined(__GNUC__) && (defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__)))
+/* Cortex-M3 使用 LDREX/STREX */
+#include "cmsis_compiler.h"
+
+static rt_bool_t atomic_cas(volatile rt_uint32_t *ptr, rt_uint32_t old_val, rt_uint32_t new_val)
+{
+    do
+    {
+        if (__LDREXW(ptr) != old_val)
+        {
+            __CLREX();
+            return RT_FALSE;
+        }
+    } while (__STREXW(new_val, ptr) != 0);
+
+    __DMB();
+
+    return RT_TRUE;
+}
+
+static void atomic_inc(volatile rt_uint32_t *ptr)
+{
+    rt_uint32_t val;
+
+    do
+    {
+        val = __LDREXW(ptr);
+    } while (__STREXW(val + 1, ptr) != 0);
+}
+
+static rt_uint32_t atomic_load(volatile rt_uint32_t *ptr)
+{
+    rt_uint32_t val = *ptr;
+
+    __DMB();
+
+    return val;
+}
+
+static void atomic_store(volatile rt_uint32_t *ptr, rt_uint32_t val)
+{
+    __DMB();
+    *ptr = val;
+}
+#else
+/* 主机上使用编译器原子操作 */
+static rt_bool_t atomic_cas(volatile rt_uint32_t *ptr, rt_uint32_t old_val, rt_uint32_t new_val)
+{
+    return __atomic_compare_exchange_n(ptr, &old_val, new_val, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+static void atomic_inc(volatile rt_uint32_t *ptr)
+{
+    __atomic_fetch_add(ptr, 1, __ATOMIC_RELAXED);
+}
+
+static rt_uint32_t atomic_load(volatile rt_uint32_t *ptr)
+{
+    return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+}
+
+static void atomic_store(volatile rt_uint32_t *ptr, rt_uint32_t val)
+{
+    __atomic_store_n(ptr, val, __ATOMIC_RELEASE);
+}
+#endif
+
+void mpsc_ring_init(mpsc_ring_t ring, rt_uint8_t *buf, rt_uint32_t size)
+{
+    RT_ASSERT(ring);
+    RT_ASSERT(buf);
+    RT_ASSERT(((rt_ubase_t)buf & 0x03) == 0);
+    RT_ASSERT(size >= 2 * MPSC_RING_HDR_SIZE && size <= MPSC_RING_HDR_LEN_MASK + 1);
+    RT_ASSERT((size & (size - 1)) == 0);
+
+    rt_memset(buf, 0, size);
+    ring->buf = buf;
+    ring->size = size;
+    ring->head = 0;
+    ring->tail = 0;
+    ring->drop_cnt = 0;
+}
+
+/**
+ * 预留一条记录, 可在中断中调用
+ *
+ * @param ring 环形缓冲区
+ * @param len 记录长度
+ *
+ * @return != RT_NULL: 记录地址, 写完后调用 mpsc_ring_commit
+ *            RT_NULL: 空间不足, 记录被丢弃
+ */
+void *mpsc_ring_reserve(mpsc_ring_t ring, rt_uint32_t len)
+{
+    rt_uint32_t head, tail, pos, need, pad;
+    volatile rt_uint32_t *hdr;
+
+    need = RT_ALIGN(len, 4) + MPSC_RING_HDR_SIZE;
+    if (need > ring->size / 2)
+    {
+        atomic_inc(&ring->drop_cnt);
+        return RT_NULL;
+    }
+
+    do
+    {
+        head = ring->head;
+        tail = atomic_load(&ring->tail);
+        pos = head & (ring->size - 1);
+        /* 记录不跨越末尾 */
+        pad = (ring->size - pos < need) ? (ring->size - pos) : 0;
+
+        if (ring->size - (head - tail) < pad + need)
+        {
+            atomic_inc(&ring->drop_cnt);
+            return RT_NULL;
+        }
+    } while (!atomic_cas(&ring->head, head, head + pad + need));
+
+    if (pad)
+    {
+        hdr = (volatile rt_uint32_t *)(ring->buf + pos);
+        atomic_store(hdr, MPSC_RING_HDR_COMMIT | MPSC_RING_HDR_PAD | (pad - MPSC_RING_HDR_SIZE));
+        pos = 0;
+    }
+
+    hdr = (volatile rt_uint32_t *)(ring->buf + pos);
+    *hdr = need - MPSC_RING_HDR_SIZE;
+
+    return (void *)(hdr + 1);
+}
+
+/**
+ * 提交预留的记录, 消费者按预留顺序读出, 前面的记录未提交时后面的记录也读不到
+ */
+void mpsc_ring_commit(mpsc_ring_t ring, void *ptr)
+{
+    volatile rt_uint32_t *hdr = (volatile rt_uint32_t *)ptr - 1;
+
+    RT_ASSERT(ptr);
+
+    atomic_store(hdr, *hdr | MPSC_RING_HDR_COMMIT);
+}
+
+/**
+ * 获取下一条已提交的记录, 只能由唯一的消费者调用
+ *
+ * @param len 记录长度 (4 字节对齐后)
+ *
+ * @return != RT_NULL: 记录地址, 处理完调用 mpsc_ring_release
+ *            RT_NULL: 没有已提交的记录
+ */
+void *mpsc_ring_peek(mpsc_ring_t ring, rt_uint32_t *len)
+{
+    rt_uint32_t tail, val;
+    volatile rt_uint32_t *hdr;
+
+    while (1)
+    {
+        tail = ring->tail;
+        if (tail == atomic_load(&ring->head))
+            return RT_NULL;
+
+        hdr = (volatile rt_uint32_t *)(ring->buf + (tail & (ring->size - 1)));
+        val = atomic_load(hdr);
+        if (!(val & MPSC_RING_HDR_COMMIT))
+            return RT_NULL;
+
+        if (!(val & MPSC_RING_HDR_PAD))
+            break;
+
+        /* 跳过尾部填充 */
+        rt_memset((void *)hdr, 0, (val & MPSC_RING_HDR_LEN_MASK) + MPSC_RING_HDR_SIZE);
+        atomic_store(&ring->tail, tail + (val & MPSC_RING_HDR_LEN_MASK) + MPSC_RING_HDR_SIZE);
+    }
+
+    if (len)
+        *len = val & MPSC_RING_HDR_LEN_MASK;
+
+    return (void *)(hdr + 1);
+}
+
+/**
+ * 释放 mpsc_ring_peek 得到的记录
+ */
+void mpsc_ring_release(mpsc_ring_t ring)
+{
+    rt_uint32_t tail = ring->tail;
+    volatile rt_uint32_t *hdr = (volatile rt_uint32_t *)(ring->buf + (tail & (ring->size - 1)));
+    rt_uint32_t total = (*hdr & MPSC_RING_HDR_LEN_MASK) + MPSC_RING_HDR_SIZE;
+
+    /* 先清零再推进 tail, 以后在这里预留的记录头在提交前总是读到 0 */
+    rt_memset((void *)hdr, 0, total);
+    atomic_store(&ring->tail, tail + total);
+}
+
+/**
+ * 已预留 (含未提交) 的字节数
+ */
+rt_uint32_t mpsc_ring_data_len(mpsc_ring_t ring)
+{
+    return ring->head - ring->tail;
+}
@@ -0,0 +1,33 @@
+#ifndef __MPSC_RING_H
+#define __MPSC_RING_H
+#include <rtthread.h>
+
+/**
+ * 多生产者单消费者的变长记录环形缓冲区.
+ * 生产者通过原子比较交换预留空间, 不关中断, 可在中断和多个线程中同时写入;
+ * 消费者只能有一个, 按预留顺序读出已提交的记录.
+ *
+ * 每条记录前有 4 字节头: bit31 已提交, bit30 填充, 低 16 位为记录长度.
+ * 记录不会跨越缓冲区末尾, 尾部放不下时用填充记录补齐.
+ */
+struct mpsc_ring
+{
+    rt_uint8_t *buf;
+    /* 2 的幂, 4 字节对齐 */
+    rt_uint32_t size;
+    /* 自由增长的位置, 生产者预留推进 head, 消费者释放推进 tail */
+    volatile rt_uint32_t head;
+    volatile rt_uint32_t tail;
+    /* 空间不足丢弃的记录数 */
+    volatile rt_uint32_t drop_cnt;
+};
+typedef struct mpsc_ring *mpsc_ring_t;
+
+void mpsc_ring_init(mpsc_ring_t ring, rt_uint8_t *buf, rt_uint32_t size);
+void *mpsc_ring_reserve(mpsc_ring_t ring, rt_uint32_t len);
+void mpsc_ring_commit(mpsc_ring_t ring, void *ptr);
+void *mpsc_ring_peek(mpsc_ring_t ring, rt_uint32_t *len);
+void mpsc_ring_release(mpsc_ring_t ring);
+rt_uint32_t mpsc_ring_data_len(mpsc_ring_t ring);
+
+#endif
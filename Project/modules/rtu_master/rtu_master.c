@@ -1,5 +1,7 @@
+#include "rtu_master.h"
 #include "drv_usart.h"
-#include "agile_modbus.h"
+#include "reactor.h"
+#include <rthw.h>
 
 #define DBG_ENABLE
 #define DBG_COLOR
@@ -9,101 +11,232 @@
 
 #define DEVICE_NAME         "usart2"
 
+#define RTU_MASTER_POLL_INTERVAL        10
+#define RTU_MASTER_RESPONSE_TIMEOUT     1000
+#define RTU_MASTER_FRAME_TIMEOUT        20
+
+typedef enum
+{
+    RTU_MASTER_STATE_IDLE = 0,
+    RTU_MASTER_STATE_WAIT_RESPONSE
+} rtu_master_state_t;
+
 ALIGN(RT_ALIGN_SIZE)
 /* 串口 */
 static usr_device_t dev = RT_NULL;
 static rt_uint8_t usart_send_buf[2048];
 static rt_uint8_t usart_read_buf[256];
-static struct rt_semaphore rx_sem;
 
 /* modbus */
+static agile_modbus_rtu_t ctx;
 static rt_uint8_t ctx_send_buf[AGILE_MODBUS_MAX_ADU_LENGTH];
 static rt_uint8_t ctx_read_buf[AGILE_MODBUS_MAX_ADU_LENGTH];
+static rt_uint16_t hold_register[100];
+static int read_len = 0;
 static rt_uint32_t send_count = 0;
 static rt_uint32_t success_count = 0;
 
-/* 线程 */
-static rt_uint8_t _thread_stack[512];
-static struct rt_thread _thread;
+/* reactor */
+static struct reactor_source rx_source;
+static struct reactor_timer rtu_master_timer;
+static struct reactor_work xfer_work;
+static rtu_master_state_t state = RTU_MASTER_STATE_IDLE;
+
+/* 外部请求 */
+static rt_slist_t xfer_header = RT_SLIST_OBJECT_INIT(xfer_header);
+static rtu_master_xfer_t cur_xfer = RT_NULL;
+static rt_uint32_t xfer_count = 0;
+static rt_uint32_t xfer_fail_count = 0;
 
 
 static int get_rtu_master_info(void)
 {
     LOG_I("send_cnt:%u, success_cnt:%u", send_count, success_count);
+    LOG_I("xfer_cnt:%u, xfer_fail_cnt:%u", xfer_count, xfer_fail_count);
 
     return RT_EOK;
 }
 MSH_CMD_EXPORT(get_rtu_master_info, get rtu master info);
 
-static int _usart_receive(rt_uint8_t *read_buf, int read_bufsz, int timeout)
+static rtu_master_xfer_t rtu_master_xfer_get(void)
+{
+    rtu_master_xfer_t xfer = RT_NULL;
+
+    rt_base_t level = rt_hw_interrupt_disable();
+
+    if(!rt_slist_isempty(&xfer_header))
+    {
+        xfer = rt_slist_first_entry(&xfer_header, struct rtu_master_xfer, slist);
+        rt_slist_remove(&xfer_header, &(xfer->slist));
+    }
+
+    rt_hw_interrupt_enable(level);
+
+    return xfer;
+}
+
+static void rtu_master_xfer_done(rtu_master_xfer_t xfer, int result)
 {
-    rt_sem_control(&rx_sem, RT_IPC_CMD_RESET, RT_NULL);
+    xfer_count++;
+    if(result < 0)
+        xfer_fail_count++;
 
-    int len = 0;
-    rt_uint8_t flag = 0;
+    xfer->result = result;
+    xfer->done(xfer);
+}
 
-    while(1)
+static void rtu_master_request(void)
+{
+    int send_len = 0;
+
+    cur_xfer = rtu_master_xfer_get();
+    if(cur_xfer)
     {
-        int rc = usr_device_read(dev, 0, read_buf + len, read_bufsz);
-        if(rc > 0)
+        send_len = agile_modbus_serialize_raw_request(&(ctx._ctx), cur_xfer->buf, cur_xfer->len);
+        if(send_len < 0)
         {
-            len += rc;
-            read_bufsz -= rc;
-            if(read_bufsz <= 0)
-                break;
-            
-            flag = 1;
+            rtu_master_xfer_done(cur_xfer, -RT_ERROR);
+            cur_xfer = RT_NULL;
+            reactor_timer_start(&rtu_master_timer, 0);
+            return;
         }
-        else
+
+        /* 广播没有响应 */
+        if(cur_xfer->buf[0] == AGILE_MODBUS_BROADCAST_ADDRESS)
         {
-            if(flag)
-                timeout = 20;
-            
-            if(rt_sem_take(&rx_sem, timeout) != RT_EOK)
-                break;
+            usr_device_write(dev, 0, ctx._ctx.send_buf, send_len);
+            rtu_master_xfer_done(cur_xfer, 0);
+            cur_xfer = RT_NULL;
+            reactor_timer_start(&rtu_master_timer, RTU_MASTER_POLL_INTERVAL);
+            return;
         }
     }
+    else
+    {
+        send_count++;
+        send_len = agile_modbus_serialize_read_registers(&(ctx._ctx), 0, 100);
+    }
 
-    return len;
+    read_len = 0;
+    state = RTU_MASTER_STATE_WAIT_RESPONSE;
+    usr_device_write(dev, 0, ctx._ctx.send_buf, send_len);
+    reactor_timer_start(&rtu_master_timer, RTU_MASTER_RESPONSE_TIMEOUT);
 }
 
-static int _usart_pass(rt_uint8_t *send_buf, int send_len, rt_uint8_t *read_buf, int read_bufsz, int timeout)
+static int rtu_master_xfer_response(rtu_master_xfer_t xfer)
 {
-    if((send_buf == RT_NULL) || (send_len <= 0) || (read_buf == RT_NULL) || (read_bufsz <= 0) || (timeout <= 0))
-        return -RT_ERROR;
-    
-    usr_device_write(dev, 0, send_buf, send_len);
-    int read_len = _usart_receive(read_buf, read_bufsz, timeout);
+    if(read_len <= 0)
+        return -RT_ETIMEOUT;
+
+    const rt_uint8_t *req = ctx._ctx.send_buf;
+    rt_uint8_t *rsp = ctx._ctx.read_buf;
+
+    if(agile_modbus_deserialize_raw_response(&(ctx._ctx), read_len) < 0)
+    {
+        /* 异常响应原样返回给请求方 */
+        if((read_len != 5) || (rsp[0] != req[0]) || (rsp[1] != (req[1] | 0x80)))
+            return -RT_ERROR;
+        if(ctx._ctx.backend->check_integrity(&(ctx._ctx), rsp, read_len) < 0)
+            return -RT_ERROR;
+    }
+
+    int len = read_len - ctx._ctx.backend->checksum_length;
+    rt_memcpy(xfer->buf, rsp, len);
 
-    return read_len;
+    return len;
 }
 
-static void rtu_master_entry(void *parameter)
+static void rtu_master_response(void)
 {
-    agile_modbus_rtu_t ctx;
-    agile_modbus_rtu_init(&ctx, ctx_send_buf, sizeof(ctx_send_buf), ctx_read_buf, sizeof(ctx_read_buf));
-    agile_modbus_set_slave(&(ctx._ctx), 1);
-
-    rt_uint16_t hold_register[100];
-    while(1)
+    if(cur_xfer)
     {
-        rt_thread_mdelay(10);
+        rtu_master_xfer_t xfer = cur_xfer;
 
-        send_count++;
-        int send_len = agile_modbus_serialize_read_registers(&(ctx._ctx), 0, 100);
-        int read_len = _usart_pass(ctx._ctx.send_buf, send_len, ctx._ctx.read_buf, ctx._ctx.read_bufsz, 1000);
+        cur_xfer = RT_NULL;
+        rtu_master_xfer_done(xfer, rtu_master_xfer_response(xfer));
+    }
+    else
+    {
         int rc = agile_modbus_deserialize_read_registers(&(ctx._ctx), read_len, hold_register);
-
         if(rc == 100)
         {
             success_count++;
         }
     }
+
+    state = RTU_MASTER_STATE_IDLE;
+    /* 有外部请求时立即发送, 帧间隔已由 RTU_MASTER_FRAME_TIMEOUT 保证 */
+    reactor_timer_start(&rtu_master_timer, rt_slist_isempty(&xfer_header) ? RTU_MASTER_POLL_INTERVAL : 0);
+}
+
+static void rx_source_handler(reactor_source_t source)
+{
+    if(state != RTU_MASTER_STATE_WAIT_RESPONSE)
+        return;
+
+    int rc = 0;
+    while(read_len < ctx._ctx.read_bufsz)
+    {
+        rc = usr_device_read(dev, 0, ctx._ctx.read_buf + read_len, ctx._ctx.read_bufsz - read_len);
+        if(rc <= 0)
+            break;
+
+        read_len += rc;
+    }
+
+    if(read_len >= ctx._ctx.read_bufsz)
+    {
+        reactor_timer_stop(&rtu_master_timer);
+        rtu_master_response();
+        return;
+    }
+
+    /* 收到数据后以帧间隔超时判断一帧结束 */
+    if(read_len > 0)
+        reactor_timer_start(&rtu_master_timer, RTU_MASTER_FRAME_TIMEOUT);
+}
+
+static void rtu_master_timer_handler(reactor_timer_t timer)
+{
+    if(state == RTU_MASTER_STATE_WAIT_RESPONSE)
+        rtu_master_response();
+    else
+        rtu_master_request();
+}
+
+static void xfer_work_handler(reactor_work_t work)
+{
+    if(state != RTU_MASTER_STATE_IDLE)
+        return;
+
+    reactor_timer_stop(&rtu_master_timer);
+    rtu_master_request();
+}
+
+int rtu_master_xfer_submit(rtu_master_xfer_t xfer)
+{
+    RT_ASSERT(xfer);
+    RT_ASSERT(xfer->done);
+
+    if(dev == RT_NULL)
+        return -RT_ERROR;
+
+    if((xfer->len < 2) || (xfer->len > AGILE_MODBUS_MAX_PDU_LENGTH + 1))
+        return -RT_EINVAL;
+
+    rt_base_t level = rt_hw_interrupt_disable();
+    rt_slist_init(&(xfer->slist));
+    rt_slist_append(&xfer_header, &(xfer->slist));
+    rt_hw_interrupt_enable(level);
+
+    reactor_work_submit(&xfer_work);
+
+    return RT_EOK;
 }
 
 static rt_err_t rx_indicate(usr_device_t dev, rt_size_t size)
 {
-    rt_sem_release(&rx_sem);
+    reactor_source_notify(&rx_source);
 
     return RT_EOK;
 }
@@ -114,8 +247,13 @@ static int rtu_master_init(void)
     dev = usr_device_find(DEVICE_NAME);
     if(dev == RT_NULL)
         return -RT_ERROR;
-    
-    rt_sem_init(&rx_sem, "rms_r", 0, RT_IPC_FLAG_FIFO);
+
+    agile_modbus_rtu_init(&ctx, ctx_send_buf, sizeof(ctx_send_buf), ctx_read_buf, sizeof(ctx_read_buf));
+    agile_modbus_set_slave(&(ctx._ctx), 1);
+
+    reactor_source_register(&rx_source, rx_source_handler, RT_NULL);
+    reactor_timer_init(&rtu_master_timer, rtu_master_timer_handler, RT_NULL);
+    reactor_work_init(&xfer_work, xfer_work_handler, RT_NULL);
     usr_device_set_rx_indicate(dev, rx_indicate);
 
 
@@ -127,15 +265,7 @@ static int rtu_master_init(void)
     usr_device_control(dev, USR_DEVICE_USART_CMD_SET_BUFFER, &buffer);
     usr_device_init(dev);
 
-    rt_thread_init(&_thread,
-                   "rtu_master",
-                   rtu_master_entry,
-                   RT_NULL,
-                   &_thread_stack[0],
-                   sizeof(_thread_stack),
-                   3,
-                   100);
-    rt_thread_startup(&_thread);
+    reactor_timer_start(&rtu_master_timer, RTU_MASTER_POLL_INTERVAL);
 
     return RT_EOK;
 }
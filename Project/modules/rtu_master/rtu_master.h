@@ -0,0 +1,23 @@
+#ifndef __RTU_MASTER_H
+#define __RTU_MASTER_H
+#include <rtthread.h>
+#include "agile_modbus.h"
+
+/* 其他模块提交到 RS485 总线的请求, 优先于轮询请求执行 */
+struct rtu_master_xfer
+{
+    /* 请求为 从机地址 + PDU, 完成后存放响应 (从机地址 + PDU, 不含 CRC) */
+    rt_uint8_t buf[AGILE_MODBUS_RTU_MAX_ADU_LENGTH];
+    int len;
+    /* 响应长度, 广播为 0, 失败为 -RT_ETIMEOUT / -RT_ERROR */
+    int result;
+    /* 在 reactor 线程中调用 */
+    void (*done)(struct rtu_master_xfer *xfer);
+    void *user_data;
+    rt_slist_t slist;
+};
+typedef struct rtu_master_xfer *rtu_master_xfer_t;
+
+int rtu_master_xfer_submit(rtu_master_xfer_t xfer);
+
+#endif
@@ -0,0 +1,467 @@
+#include "drv_usart.h"
+#include "agile_modbus.h"
+#include "reactor.h"
+#include "ringbuffer.h"
+#include <rthw.h>
+#include <string.h>
+#include <stdlib.h>
+
+#define DBG_ENABLE
+#define DBG_COLOR
+#define DBG_SECTION_NAME    "rtu_sniffer"
+#define DBG_LEVEL           DBG_INFO
+#include <rtdbg.h>
+
+#ifndef RTU_SNIFFER_RING_SIZE
+#define RTU_SNIFFER_RING_SIZE           4096
+#endif
+
+#define RTU_SNIFFER_CHUNK_NUM           32
+#define RTU_SNIFFER_FRAME_MAX           AGILE_MODBUS_RTU_MAX_ADU_LENGTH
+
+/* 帧标志 */
+#define RTU_SNIFFER_FLAG_CRC_OK         0x01
+#define RTU_SNIFFER_FLAG_TRUNCATED      0x02
+
+/* pcap LINKTYPE_USER0, wireshark 中可指定为 mbrtu 解析 */
+#define RTU_SNIFFER_PCAP_LINKTYPE       147
+
+/* 每次观察到 DMA 计数变化时记录的数据块 */
+struct rtu_sniffer_chunk
+{
+    rt_uint32_t us;
+    rt_uint16_t len;
+};
+
+/* 环形缓冲区中每帧的头部, 后跟 len 字节数据 */
+struct rtu_sniffer_record
+{
+    rt_uint32_t tick;
+    rt_uint16_t us;
+    rt_uint16_t len;
+    rt_uint8_t flags;
+};
+
+ALIGN(RT_ALIGN_SIZE)
+/* 只在设备原来没有设置缓冲区时使用, 嗅探时不发送 */
+static rt_uint8_t usart_send_buf[RT_ALIGN_SIZE];
+static rt_uint8_t usart_read_buf[1024];
+static rt_uint8_t ring_buf[RTU_SNIFFER_RING_SIZE];
+static struct rt_ringbuffer ring;
+
+static usr_device_t dev = RT_NULL;
+/* 停止时恢复原来的接收回调, 缓冲区和串口参数 */
+static rt_err_t (*prev_rx_indicate)(usr_device_t dev, rt_size_t size) = RT_NULL;
+static struct usr_device_usart_buffer prev_buffer;
+static struct usr_device_usart_parameter prev_parameter;
+static rt_uint8_t source_init = 0;
+static struct reactor_source rx_source;
+static struct reactor_timer frame_timer;
+
+static struct rtu_sniffer_chunk chunks[RTU_SNIFFER_CHUNK_NUM];
+static rt_uint8_t chunk_head = 0;
+static rt_uint8_t chunk_num = 0;
+
+/* 每字节时间及 t3.5 (us) */
+static rt_uint32_t char_us = 0;
+static rt_uint32_t t35_us = 0;
+
+/* modbus 仅用于校验 */
+static agile_modbus_rtu_t ctx;
+static rt_uint8_t frame_buf[RTU_SNIFFER_FRAME_MAX];
+static int frame_len = 0;
+static rt_uint8_t frame_flags = 0;
+static rt_uint32_t frame_start_us = 0;
+static rt_uint32_t frame_last_us = 0;
+
+static rt_uint32_t frame_cnt = 0;
+static rt_uint32_t crc_err_cnt = 0;
+static rt_uint32_t overwrite_cnt = 0;
+static rt_uint32_t rx_error_cnt = 0;
+
+/* 以 SysTick 计数补足 tick 以下的精度 */
+static rt_uint32_t rtu_sniffer_time_us(void)
+{
+    rt_base_t level = rt_hw_interrupt_disable();
+
+    rt_tick_t tick = rt_tick_get();
+    rt_uint32_t val = SysTick->VAL;
+    /* SysTick 已重装但中断还未处理 */
+    if(SCB->ICSR & SCB_ICSR_PENDSTSET_Msk)
+    {
+        tick++;
+        val = SysTick->VAL;
+    }
+    rt_uint32_t load = SysTick->LOAD;
+
+    rt_hw_interrupt_enable(level);
+
+    return tick * (1000000 / RT_TICK_PER_SECOND) + (load - val) * (1000000 / RT_TICK_PER_SECOND) / (load + 1);
+}
+
+static void rtu_sniffer_ring_put(const struct rtu_sniffer_record *record, const rt_uint8_t *data)
+{
+    int need = sizeof(struct rtu_sniffer_record) + record->len;
+    if(need > ring.buffer_size)
+        return;
+
+    rt_base_t level = rt_hw_interrupt_disable();
+
+    /* 空间不足时覆盖最早的帧 */
+    while(rt_ringbuffer_space_len(&ring) < need)
+    {
+        struct rtu_sniffer_record old;
+        rt_uint8_t *ptr;
+
+        rt_ringbuffer_get(&ring, (rt_uint8_t *)&old, sizeof(old));
+        int skip = old.len;
+        while(skip > 0)
+            skip -= rt_ringbuffer_peak(&ring, &ptr, skip);
+
+        overwrite_cnt++;
+    }
+
+    rt_ringbuffer_put(&ring, (const rt_uint8_t *)record, sizeof(struct rtu_sniffer_record));
+    rt_ringbuffer_put(&ring, data, record->len);
+
+    rt_hw_interrupt_enable(level);
+}
+
+static void rtu_sniffer_frame_end(void)
+{
+    if(frame_len <= 0)
+        return;
+
+    if(frame_len >= 4)
+    {
+        rt_memcpy(ctx._ctx.read_buf, frame_buf, frame_len);
+        /* 异常响应等短帧不满足请求格式, 再单独校验 CRC */
+        if(agile_modbus_receive_judge(&(ctx._ctx), frame_len) > 0)
+            frame_flags |= RTU_SNIFFER_FLAG_CRC_OK;
+        else if(ctx._ctx.backend->check_integrity(&(ctx._ctx), ctx._ctx.read_buf, frame_len) > 0)
+            frame_flags |= RTU_SNIFFER_FLAG_CRC_OK;
+    }
+
+    if(!(frame_flags & RTU_SNIFFER_FLAG_CRC_OK))
+        crc_err_cnt++;
+
+    struct rtu_sniffer_record record;
+    rt_uint32_t tick_us = 1000000 / RT_TICK_PER_SECOND;
+    record.tick = frame_start_us / tick_us;
+    record.us = frame_start_us % tick_us;
+    record.len = frame_len;
+    record.flags = frame_flags;
+    rtu_sniffer_ring_put(&record, frame_buf);
+
+    frame_cnt++;
+    frame_len = 0;
+    frame_flags = 0;
+}
+
+static void rtu_sniffer_frame_append(const struct rtu_sniffer_chunk *chunk, const rt_uint8_t *buf, int len)
+{
+    rt_uint32_t start_us = chunk->us - chunk->len * char_us;
+
+    /* 与上一块数据的间隔达到 t3.5 时为新的一帧 */
+    if((frame_len > 0) && ((rt_int32_t)(start_us - frame_last_us) >= (rt_int32_t)t35_us))
+        rtu_sniffer_frame_end();
+
+    if(frame_len == 0)
+        frame_start_us = start_us;
+    frame_last_us = chunk->us;
+
+    int copy_len = len;
+    if(frame_len + copy_len > RTU_SNIFFER_FRAME_MAX)
+    {
+        copy_len = RTU_SNIFFER_FRAME_MAX - frame_len;
+        frame_flags |= RTU_SNIFFER_FLAG_TRUNCATED;
+    }
+
+    rt_memcpy(frame_buf + frame_len, buf, copy_len);
+    frame_len += copy_len;
+}
+
+static void rx_source_handler(reactor_source_t source)
+{
+    rt_uint8_t buf[64];
+
+    if(dev == RT_NULL)
+        return;
+
+    if(dev->error)
+    {
+        rx_error_cnt++;
+        frame_len = 0;
+        frame_flags = 0;
+        usr_device_init(dev);
+        return;
+    }
+
+    while(1)
+    {
+        struct rtu_sniffer_chunk chunk;
+
+        rt_base_t level = rt_hw_interrupt_disable();
+        if(chunk_num == 0)
+        {
+            rt_hw_interrupt_enable(level);
+            break;
+        }
+        chunk = chunks[chunk_head];
+        chunk_head = (chunk_head + 1) % RTU_SNIFFER_CHUNK_NUM;
+        chunk_num--;
+        rt_hw_interrupt_enable(level);
+
+        int remain = chunk.len;
+        while(remain > 0)
+        {
+            int len = usr_device_read(dev, 0, buf, remain > sizeof(buf) ? sizeof(buf) : remain);
+            if(len <= 0)
+                break;
+
+            rtu_sniffer_frame_append(&chunk, buf, len);
+            remain -= len;
+        }
+    }
+
+    if(frame_len > 0)
+        reactor_timer_start(&frame_timer, t35_us / 1000 + 1);
+}
+
+static void frame_timer_handler(reactor_timer_t timer)
+{
+    if(frame_len <= 0)
+        return;
+
+    rt_int32_t idle_us = rtu_sniffer_time_us() - frame_last_us;
+    if(idle_us >= (rt_int32_t)t35_us)
+    {
+        rtu_sniffer_frame_end();
+        return;
+    }
+
+    reactor_timer_start(&frame_timer, (t35_us - idle_us) / 1000 + 1);
+}
+
+/* 在 DMA 中断或空闲钩子中调用, 记录本次 DMA 计数变化的时间 */
+static rt_err_t rx_indicate(usr_device_t dev, rt_size_t size)
+{
+    rt_uint32_t us = rtu_sniffer_time_us();
+
+    rt_base_t level = rt_hw_interrupt_disable();
+    if(chunk_num < RTU_SNIFFER_CHUNK_NUM)
+    {
+        int index = (chunk_head + chunk_num) % RTU_SNIFFER_CHUNK_NUM;
+        chunks[index].us = us;
+        chunks[index].len = size;
+        chunk_num++;
+    }
+    else
+    {
+        /* 来不及处理时合并到最后一块, 只损失帧间隔的精度 */
+        int index = (chunk_head + chunk_num - 1) % RTU_SNIFFER_CHUNK_NUM;
+        chunks[index].us = us;
+        chunks[index].len += size;
+    }
+    rt_hw_interrupt_enable(level);
+
+    reactor_source_notify(&rx_source);
+
+    return RT_EOK;
+}
+
+static void rtu_sniffer_stop(void);
+
+static int rtu_sniffer_start(const char *name, rt_uint32_t baudrate)
+{
+    usr_device_t device = usr_device_find(name);
+    if(device == RT_NULL)
+    {
+        LOG_E("device %s not found.", name);
+        return -RT_ERROR;
+    }
+
+    if(!source_init)
+    {
+        rt_ringbuffer_init(&ring, ring_buf, sizeof(ring_buf));
+        agile_modbus_rtu_init(&ctx, frame_buf, sizeof(frame_buf), frame_buf, sizeof(frame_buf));
+        reactor_source_register(&rx_source, rx_source_handler, RT_NULL);
+        reactor_timer_init(&frame_timer, frame_timer_handler, RT_NULL);
+        source_init = 1;
+    }
+
+    rtu_sniffer_stop();
+
+    /* 1 起始位 + 8 数据位 + 校验位/停止位共 11 位, 波特率大于 19200 时 t3.5 固定为 1.75ms */
+    char_us = 11 * 1000000 / baudrate;
+    t35_us = (baudrate > 19200) ? 1750 : (char_us * 7 / 2);
+
+    rt_base_t level = rt_hw_interrupt_disable();
+    chunk_head = 0;
+    chunk_num = 0;
+    frame_len = 0;
+    frame_flags = 0;
+    rt_hw_interrupt_enable(level);
+
+    dev = device;
+    prev_rx_indicate = dev->rx_indicate;
+    prev_buffer = ((struct usr_device_usart *)dev)->buffer;
+    prev_parameter = ((struct usr_device_usart *)dev)->parameter;
+
+    /* 发送缓冲区保持原来的, 停止前原模块发送的数据不受影响 */
+    struct usr_device_usart_buffer buffer;
+    buffer.send_buf = prev_buffer.send_buf ? prev_buffer.send_buf : usart_send_buf;
+    buffer.send_bufsz = prev_buffer.send_buf ? prev_buffer.send_bufsz : sizeof(usart_send_buf);
+    buffer.read_buf = usart_read_buf;
+    buffer.read_bufsz = sizeof(usart_read_buf);
+    usr_device_control(dev, USR_DEVICE_USART_CMD_SET_BUFFER, &buffer);
+    struct usr_device_usart_parameter parameter = USR_DEVICE_USART_PARAMETER_DEFAULT;
+    parameter.baudrate = baudrate;
+    usr_device_control(dev, USR_DEVICE_USART_CMD_SET_PARAMETER, &parameter);
+    usr_device_set_rx_indicate(dev, rx_indicate);
+    usr_device_init(dev);
+
+    LOG_I("sniffing %s at %u, t3.5 %uus.", name, baudrate, t35_us);
+
+    return RT_EOK;
+}
+
+static void rtu_sniffer_stop(void)
+{
+    usr_device_t device = dev;
+
+    if(device == RT_NULL)
+        return;
+
+    dev = RT_NULL;
+    reactor_timer_stop(&frame_timer);
+
+    usr_device_set_rx_indicate(device, prev_rx_indicate);
+    /* 设备原来没有设置缓冲区时保持嗅探的缓冲区, 下次由原模块设置 */
+    if(prev_buffer.read_buf)
+        usr_device_control(device, USR_DEVICE_USART_CMD_SET_BUFFER, &prev_buffer);
+    usr_device_control(device, USR_DEVICE_USART_CMD_SET_PARAMETER, &prev_parameter);
+}
+
+/* 取出最早的一帧, 返回数据长度, 没有数据返回 -1 */
+static int rtu_sniffer_ring_get(struct rtu_sniffer_record *record, rt_uint8_t *data)
+{
+    rt_base_t level = rt_hw_interrupt_disable();
+
+    if(rt_ringbuffer_data_len(&ring) < sizeof(struct rtu_sniffer_record))
+    {
+        rt_hw_interrupt_enable(level);
+        return -1;
+    }
+
+    rt_ringbuffer_get(&ring, (rt_uint8_t *)record, sizeof(struct rtu_sniffer_record));
+    rt_ringbuffer_get(&ring, data, record->len);
+
+    rt_hw_interrupt_enable(level);
+
+    return record->len;
+}
+
+static void rtu_sniffer_hex(const void *buf, int len)
+{
+    const rt_uint8_t *ptr = buf;
+
+    for (int i = 0; i < len; i++)
+        rt_kprintf("%02x", ptr[i]);
+}
+
+static void rtu_sniffer_le32(rt_uint8_t *buf, rt_uint32_t value)
+{
+    buf[0] = value & 0xFF;
+    buf[1] = (value >> 8) & 0xFF;
+    buf[2] = (value >> 16) & 0xFF;
+    buf[3] = (value >> 24) & 0xFF;
+}
+
+static void rtu_sniffer_dump(int pcap)
+{
+    struct rtu_sniffer_record record;
+    rt_uint8_t data[RTU_SNIFFER_FRAME_MAX];
+
+    if(!source_init)
+        return;
+
+    /* pcap 文件以十六进制输出, 可用 xxd -r -p 还原 */
+    if(pcap)
+    {
+        rt_uint8_t header[24];
+        rtu_sniffer_le32(header, 0xa1b2c3d4);
+        header[4] = 2;
+        header[5] = 0;
+        header[6] = 4;
+        header[7] = 0;
+        rtu_sniffer_le32(header + 8, 0);
+        rtu_sniffer_le32(header + 12, 0);
+        rtu_sniffer_le32(header + 16, RTU_SNIFFER_FRAME_MAX);
+        rtu_sniffer_le32(header + 20, RTU_SNIFFER_PCAP_LINKTYPE);
+        rtu_sniffer_hex(header, sizeof(header));
+        rt_kprintf("\r\n");
+    }
+
+    while(rtu_sniffer_ring_get(&record, data) >= 0)
+    {
+        rt_uint32_t sec = record.tick / RT_TICK_PER_SECOND;
+        rt_uint32_t usec = (record.tick % RT_TICK_PER_SECOND) * (1000000 / RT_TICK_PER_SECOND) + record.us;
+
+        if(pcap)
+        {
+            rt_uint8_t header[16];
+            rtu_sniffer_le32(header, sec);
+            rtu_sniffer_le32(header + 4, usec);
+            rtu_sniffer_le32(header + 8, record.len);
+            rtu_sniffer_le32(header + 12, record.len);
+            rtu_sniffer_hex(header, sizeof(header));
+        }
+        else
+        {
+            rt_kprintf("[%u.%06u] %s%s%3d: ", sec, usec,
+                       (record.flags & RTU_SNIFFER_FLAG_CRC_OK) ? "OK " : "ERR",
+                       (record.flags & RTU_SNIFFER_FLAG_TRUNCATED) ? "+" : " ", record.len);
+        }
+
+        rtu_sniffer_hex(data, record.len);
+        rt_kprintf("\r\n");
+    }
+}
+
+static int rtu_sniffer(int argc, char **argv)
+{
+    if((argc >= 3) && !strcmp(argv[1], "start"))
+    {
+        rt_uint32_t baudrate = (argc >= 4) ? atoi(argv[3]) : 9600;
+        if(baudrate == 0)
+            return -RT_ERROR;
+
+        return rtu_sniffer_start(argv[2], baudrate);
+    }
+
+    if((argc >= 2) && !strcmp(argv[1], "stop"))
+    {
+        rtu_sniffer_stop();
+        return RT_EOK;
+    }
+
+    if((argc >= 2) && !strcmp(argv[1], "dump"))
+    {
+        rtu_sniffer_dump(0);
+        return RT_EOK;
+    }
+
+    if((argc >= 2) && !strcmp(argv[1], "pcap"))
+    {
+        rtu_sniffer_dump(1);
+        return RT_EOK;
+    }
+
+    LOG_I("device:%s, frame:%u, crc err:%u, overwrite:%u, rx err:%u, buffered:%d",
+          dev ? dev->name : "none", frame_cnt, crc_err_cnt, overwrite_cnt, rx_error_cnt,
+          source_init ? rt_ringbuffer_data_len(&ring) : 0);
+
+    return RT_EOK;
+}
+MSH_CMD_EXPORT(rtu_sniffer, rtu_sniffer <start dev [baudrate]|stop|dump|pcap>: passive modbus rtu monitor);
@@ -11,11 +11,12 @@
 #include <rthw.h>
 #include <stdlib.h>
 #include <ulog.h>
+#include "console.h"
 
 #ifdef ULOG_BACKEND_USING_CONSOLE
 
-#if defined(ULOG_ASYNC_OUTPUT_BY_THREAD) && ULOG_ASYNC_OUTPUT_THREAD_STACK < 384
-#error "The thread stack size must more than 384 when using async output by thread (ULOG_ASYNC_OUTPUT_BY_THREAD)"
+#if defined(ULOG_USING_ASYNC_OUTPUT) && ULOG_ASYNC_OUTPUT_THREAD_STACK < 384
+#error "The thread stack size must more than 384 when using async output by thread (ULOG_USING_ASYNC_OUTPUT)"
 #endif
 
 static struct ulog_backend console = {0};
@@ -47,9 +48,38 @@ void ulog_console_backend_output(struct ulog_backend *backend, rt_uint32_t level
 
 }
 
+#ifdef ULOG_USING_DEFERRED
+static void ulog_console_backend_output_batch(struct ulog_backend *backend, const struct ulog_batch_item *items,
+                                              rt_size_t num)
+{
+    char *start;
+    rt_size_t i, len;
+
+    /* 内存连续的日志合并后直接用 DMA 发送, 不再拷贝到串口发送缓冲区 */
+    start = items[0].log;
+    len = items[0].len;
+    for (i = 1; i < num; i++)
+    {
+        if (items[i].log == start + len)
+        {
+            len += items[i].len;
+            continue;
+        }
+
+        console_write_stream(start, len);
+        start = items[i].log;
+        len = items[i].len;
+    }
+    console_write_stream(start, len);
+}
+#endif /* ULOG_USING_DEFERRED */
+
 int ulog_console_backend_init(void)
 {
     console.output = ulog_console_backend_output;
+#ifdef ULOG_USING_DEFERRED
+    console.output_batch = ulog_console_backend_output_batch;
+#endif
 
     ulog_backend_register(&console, "console", RT_TRUE);
 
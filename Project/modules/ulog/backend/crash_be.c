@@ -0,0 +1,646 @@
+/*
+ * 崩溃日志后端
+ *
+ * 日志以二进制记录写入 .noinit RAM 环形缓冲区, 看门狗等热复位后内容保留;
+ * main hook 中定期把未保存的部分批量写入内部 flash 末尾的若干页, 页按顺序轮流使用.
+ * 上电时先把上次复位前未写入 flash 的记录补写进去, 并记录复位原因.
+ * 使用延后日志时在保存参数时就把原始记录 (格式串指针和参数) 写入 RAM, 调用者中不做格式化,
+ * 写入 flash 时再用 ulog_capture_format 格式化为文本记录. 复位后格式串前 8 字节的校验和不一致
+ * (固件已更新) 的原始记录丢弃.
+ *
+ * RAM 记录: 0xA5, level, len(2), tick(4), text[len]
+ * RAM 原始记录: 0xA6, level, len(2), tick(4), struct ulog_deferred_rec, args[argc], str[] (reserved 为校验和)
+ * flash 块: magic(2) 'GL', len(2), seq(4), data[len] (补齐到半字), 只有文本记录
+ *
+ * ulog_crash dump 以十六进制输出 flash 和 RAM 区域, 用 tools/ulog_crash_decode.py 解析.
+ */
+#include <rthw.h>
+#include <stdlib.h>
+#include <ulog.h>
+#include "stm32f1xx_hal.h"
+#include "main_hook.h"
+
+#ifdef ULOG_BACKEND_USING_CRASH
+
+#define CRASH_RAM_MAGIC             0x554C4F47
+#define CRASH_RAM_BUF_SIZE          (ULOG_CRASH_RAM_SIZE - 16)
+#define CRASH_REC_SYNC              0xA5
+#define CRASH_REC_SYNC_RAW          0xA6
+#define CRASH_REC_HDR_SIZE          8
+#define CRASH_REC_LEN_MAX           (CRASH_RAM_BUF_SIZE / 4)
+/* 复位原因记录的等级, text 为 RCC->CSR */
+#define CRASH_REC_LVL_BOOT          0xFF
+
+#define CRASH_CHUNK_MAGIC           0x4C47
+#define CRASH_CHUNK_HDR_SIZE        8
+/* 页剩余空间放不下一条最长的记录时换页 */
+#define CRASH_CHUNK_MIN_DATA        (CRASH_REC_HDR_SIZE + CRASH_REC_LEN_MAX)
+/* 一次写入 flash 的块最大长度 */
+#define CRASH_FLUSH_BUF_SIZE        (2 * CRASH_CHUNK_MIN_DATA)
+/* 原始记录校验的格式串长度 */
+#define CRASH_FMT_CHECK_LEN         8
+
+#if ULOG_CRASH_RAM_SIZE < 256
+#error "the crash log RAM size must more than 256"
+#endif
+
+/* 放在链接器不清零的 RAM 区域, 复位后保留 */
+struct crash_ram
+{
+    rt_uint32_t magic;
+    /* 自由增长的写位置和已写入 flash 的位置 */
+    rt_uint32_t write;
+    rt_uint32_t flush;
+    rt_uint32_t boot_cnt;
+    rt_uint8_t buf[CRASH_RAM_BUF_SIZE];
+};
+
+#if defined(__CC_ARM) || defined(__CLANG_ARM)
+static struct crash_ram crash_ram __attribute__((at(ULOG_CRASH_RAM_ADDR), zero_init));
+#elif defined(__GNUC__)
+static struct crash_ram crash_ram __attribute__((section(".noinit")));
+#else
+static struct crash_ram crash_ram;
+#endif
+
+static struct ulog_backend crash = {0};
+static struct main_hook_module crash_main_hook_module = {0};
+
+static struct
+{
+    rt_uint16_t page;
+    rt_uint16_t offset;
+    rt_uint32_t seq;
+    rt_tick_t flush_tick;
+    rt_uint8_t flushing;
+    /* RAM 满时覆盖未写入 flash 的记录次数 */
+    rt_uint32_t overrun_cnt;
+    rt_uint32_t flash_err_cnt;
+    /* 不能格式化而丢弃的原始记录数 */
+    rt_uint32_t invalid_cnt;
+    rt_uint32_t reset_csr;
+} crash_flash = {0};
+
+/* 写入 flash 的数据, 原始记录在这里格式化 */
+static rt_uint8_t crash_flush_buf[CRASH_FLUSH_BUF_SIZE];
+#ifdef ULOG_USING_DEFERRED
+static rt_uint32_t crash_rec_buf[(CRASH_REC_LEN_MAX + 3) / 4];
+static char crash_line_buf[ULOG_LINE_BUF_SIZE + 1];
+#endif
+
+static void crash_ram_put(const rt_uint8_t *data, rt_size_t len)
+{
+    rt_uint32_t pos = crash_ram.write % CRASH_RAM_BUF_SIZE;
+    rt_size_t first = CRASH_RAM_BUF_SIZE - pos;
+
+    if (first > len)
+        first = len;
+
+    rt_memcpy(&crash_ram.buf[pos], data, first);
+    rt_memcpy(&crash_ram.buf[0], data + first, len - first);
+    crash_ram.write += len;
+}
+
+static rt_uint8_t crash_ram_byte(rt_uint32_t pos)
+{
+    return crash_ram.buf[pos % CRASH_RAM_BUF_SIZE];
+}
+
+/* 需关中断调用, 写入记录头, 后面跟着 len 字节数据 */
+static void crash_ram_hdr(rt_uint8_t sync, rt_uint8_t level, rt_tick_t tick, rt_size_t len)
+{
+    rt_uint8_t hdr[CRASH_REC_HDR_SIZE];
+
+    hdr[0] = sync;
+    hdr[1] = level;
+    hdr[2] = len & 0xFF;
+    hdr[3] = (len >> 8) & 0xFF;
+    hdr[4] = tick & 0xFF;
+    hdr[5] = (tick >> 8) & 0xFF;
+    hdr[6] = (tick >> 16) & 0xFF;
+    hdr[7] = (tick >> 24) & 0xFF;
+
+    /* 未写入 flash 的记录被覆盖 */
+    if (crash_ram.write + CRASH_REC_HDR_SIZE + len - crash_ram.flush > CRASH_RAM_BUF_SIZE)
+    {
+        crash_ram.flush = crash_ram.write + CRASH_REC_HDR_SIZE + len - CRASH_RAM_BUF_SIZE;
+        crash_flash.overrun_cnt++;
+    }
+
+    crash_ram_put(hdr, CRASH_REC_HDR_SIZE);
+}
+
+static void crash_ram_append(rt_uint8_t level, const char *text, rt_size_t len)
+{
+    rt_base_t irq_level;
+    rt_tick_t tick = rt_tick_get();
+
+    if (len > CRASH_REC_LEN_MAX)
+        len = CRASH_REC_LEN_MAX;
+
+    irq_level = rt_hw_interrupt_disable();
+    crash_ram_hdr(CRASH_REC_SYNC, level, tick, len);
+    crash_ram_put((const rt_uint8_t *)text, len);
+    rt_hw_interrupt_enable(irq_level);
+}
+
+static rt_uint32_t crash_page_addr(rt_uint16_t page)
+{
+    return ULOG_CRASH_FLASH_ADDR + page * FLASH_PAGE_SIZE;
+}
+
+static rt_bool_t crash_flash_blank(rt_uint32_t addr, rt_size_t size)
+{
+    rt_size_t i;
+
+    for (i = 0; i < size; i += 2)
+    {
+        if (*(volatile rt_uint16_t *)(addr + i) != 0xFFFF)
+            return RT_FALSE;
+    }
+
+    return RT_TRUE;
+}
+
+static int crash_flash_erase(rt_uint16_t page)
+{
+    FLASH_EraseInitTypeDef erase;
+    uint32_t page_error = 0;
+    HAL_StatusTypeDef status;
+
+    if (crash_flash_blank(crash_page_addr(page), FLASH_PAGE_SIZE))
+        return RT_EOK;
+
+    erase.TypeErase = FLASH_TYPEERASE_PAGES;
+    erase.Banks = FLASH_BANK_1;
+    erase.PageAddress = crash_page_addr(page);
+    erase.NbPages = 1;
+
+    HAL_FLASH_Unlock();
+    status = HAL_FLASHEx_Erase(&erase, &page_error);
+    HAL_FLASH_Lock();
+
+    if (status != HAL_OK)
+    {
+        crash_flash.flash_err_cnt++;
+        return -RT_ERROR;
+    }
+
+    return RT_EOK;
+}
+
+/* 上电时找到最后写入的块, 从它后面继续写 */
+static void crash_flash_scan(void)
+{
+    rt_uint16_t page;
+    rt_uint32_t addr, offset, seq, best_seq = 0;
+    rt_bool_t found = RT_FALSE;
+    rt_uint16_t len;
+
+    crash_flash.page = 0;
+    crash_flash.offset = 0;
+
+    for (page = 0; page < ULOG_CRASH_FLASH_PAGE_NUM; page++)
+    {
+        addr = crash_page_addr(page);
+
+        for (offset = 0; offset + CRASH_CHUNK_HDR_SIZE <= FLASH_PAGE_SIZE;)
+        {
+            if (*(volatile rt_uint16_t *)(addr + offset) != CRASH_CHUNK_MAGIC)
+                break;
+
+            len = *(volatile rt_uint16_t *)(addr + offset + 2);
+            seq = *(volatile rt_uint32_t *)(addr + offset + 4);
+            if (offset + CRASH_CHUNK_HDR_SIZE + RT_ALIGN(len, 2) > FLASH_PAGE_SIZE)
+            {
+                /* 块头损坏, 这一页不再写入 */
+                offset = FLASH_PAGE_SIZE;
+                break;
+            }
+
+            if (!found || (rt_int32_t)(seq - best_seq) > 0)
+            {
+                found = RT_TRUE;
+                best_seq = seq;
+                crash_flash.page = page;
+            }
+
+            offset += CRASH_CHUNK_HDR_SIZE + RT_ALIGN(len, 2);
+        }
+
+        if (found && crash_flash.page == page)
+            crash_flash.offset = offset;
+    }
+
+    crash_flash.seq = found ? best_seq + 1 : 0;
+}
+
+static int crash_flash_program(rt_uint32_t addr, rt_uint16_t data)
+{
+    if (HAL_FLASH_Program(FLASH_TYPEPROGRAM_HALFWORD, addr, data) != HAL_OK)
+    {
+        crash_flash.flash_err_cnt++;
+        return -RT_ERROR;
+    }
+
+    return RT_EOK;
+}
+
+#ifdef ULOG_USING_DEFERRED
+static rt_uint8_t crash_fmt_check(const char *format)
+{
+    rt_uint8_t sum = 0;
+    int i;
+
+    for (i = 0; i < CRASH_FMT_CHECK_LEN && format[i] != '\0'; i++)
+        sum += format[i];
+
+    return sum;
+}
+
+/* 指针在 flash 或 RAM 中, 读取时不会异常 */
+static rt_bool_t crash_addr_valid(const void *p)
+{
+    rt_uint32_t addr = (rt_uint32_t)p;
+
+    return (addr >= FLASH_BASE && addr < ULOG_CRASH_FLASH_ADDR)
+           || (addr >= SRAM_BASE && addr < ULOG_CRASH_RAM_ADDR);
+}
+
+/* 格式串和标签是复位前的指针, 固件更新后可能指向其他内容 */
+static rt_bool_t crash_rec_valid(const struct ulog_deferred_rec *rec)
+{
+    if (!crash_addr_valid(rec->format) || !crash_addr_valid(rec->tag))
+        return RT_FALSE;
+#ifdef ULOG_OUTPUT_THREAD_NAME
+    if (rec->thread && !crash_addr_valid(rec->thread))
+        return RT_FALSE;
+#endif
+
+    return crash_fmt_check(rec->format) == rec->reserved;
+}
+
+/* 把原始记录格式化为文本记录 */
+static int crash_rec_format(const rt_uint8_t *hdr, rt_size_t len, rt_uint8_t *out, rt_size_t space, rt_size_t *out_len)
+{
+    const struct ulog_deferred_rec *rec = (const struct ulog_deferred_rec *)crash_rec_buf;
+    rt_size_t newline_len = sizeof(ULOG_NEWLINE_SIGN) - 1;
+    int text_len;
+
+    if (len < sizeof(struct ulog_deferred_rec) || !crash_rec_valid(rec))
+    {
+        crash_flash.invalid_cnt++;
+        return RT_EOK;
+    }
+
+    text_len = ulog_capture_format(crash_line_buf, rec, len);
+    if (text_len == -RT_EBUSY)
+        return -RT_EBUSY;
+    if (text_len <= 0)
+        return RT_EOK;
+
+    if (text_len >= newline_len && rt_memcmp(crash_line_buf + text_len - newline_len, ULOG_NEWLINE_SIGN, newline_len) == 0)
+        text_len -= newline_len;
+    if (text_len > CRASH_REC_LEN_MAX)
+        text_len = CRASH_REC_LEN_MAX;
+
+    if (space < CRASH_REC_HDR_SIZE + text_len)
+        return -RT_EFULL;
+
+    rt_memcpy(out, hdr, CRASH_REC_HDR_SIZE);
+    out[0] = CRASH_REC_SYNC;
+    out[2] = text_len & 0xFF;
+    out[3] = (text_len >> 8) & 0xFF;
+    rt_memcpy(out + CRASH_REC_HDR_SIZE, crash_line_buf, text_len);
+    *out_len = CRASH_REC_HDR_SIZE + text_len;
+
+    return RT_EOK;
+}
+#endif /* ULOG_USING_DEFERRED */
+
+/**
+ * 读出 pos 处的一条记录放到 out, 原始记录格式化为文本记录
+ *
+ * @param out_len 放到 out 的长度, 0: 记录丢弃
+ *
+ * @return >0: 记录在 RAM 中占用的长度
+ *  -RT_EFULL: out 放不下
+ *  -RT_EBUSY: 暂时不能格式化
+ */
+static int crash_rec_read(rt_uint32_t pos, rt_uint32_t end, rt_uint8_t *out, rt_size_t space, rt_size_t *out_len)
+{
+    rt_base_t irq_level;
+    rt_uint8_t hdr[CRASH_REC_HDR_SIZE];
+    rt_uint32_t i;
+    rt_size_t len;
+    int result = RT_EOK;
+
+    *out_len = 0;
+
+    if (end - pos < CRASH_REC_HDR_SIZE)
+        return end - pos;
+
+    /* 在关中断时拷贝, 拷贝过程中不会被覆盖 */
+    irq_level = rt_hw_interrupt_disable();
+
+    /* 已被覆盖 */
+    if ((rt_int32_t)(crash_ram.flush - pos) > 0)
+    {
+        rt_hw_interrupt_enable(irq_level);
+        return crash_ram.flush - pos;
+    }
+
+    for (i = 0; i < CRASH_REC_HDR_SIZE; i++)
+        hdr[i] = crash_ram_byte(pos + i);
+    len = hdr[2] | (hdr[3] << 8);
+
+    /* 覆盖留下的残缺数据, 找下一个记录头 */
+    if ((hdr[0] != CRASH_REC_SYNC && hdr[0] != CRASH_REC_SYNC_RAW) || len > CRASH_REC_LEN_MAX
+            || end - pos - CRASH_REC_HDR_SIZE < len)
+    {
+        rt_hw_interrupt_enable(irq_level);
+        return 1;
+    }
+
+    if (hdr[0] == CRASH_REC_SYNC)
+    {
+        if (space < CRASH_REC_HDR_SIZE + len)
+        {
+            result = -RT_EFULL;
+        }
+        else
+        {
+            for (i = 0; i < CRASH_REC_HDR_SIZE + len; i++)
+                out[i] = crash_ram_byte(pos + i);
+            *out_len = CRASH_REC_HDR_SIZE + len;
+        }
+    }
+#ifdef ULOG_USING_DEFERRED
+    else
+    {
+        for (i = 0; i < len; i++)
+            ((rt_uint8_t *)crash_rec_buf)[i] = crash_ram_byte(pos + CRASH_REC_HDR_SIZE + i);
+    }
+#endif
+
+    rt_hw_interrupt_enable(irq_level);
+
+#ifdef ULOG_USING_DEFERRED
+    if (hdr[0] == CRASH_REC_SYNC_RAW)
+        result = crash_rec_format(hdr, len, out, space, out_len);
+#endif
+
+    if (result != RT_EOK)
+        return result;
+
+    return CRASH_REC_HDR_SIZE + len;
+}
+
+/* 写入一个块, 数据按半字写入, 最后一个字节补 0xFF */
+static int crash_chunk_program(rt_uint32_t addr, const rt_uint8_t *data, rt_size_t len)
+{
+    rt_size_t i;
+    rt_uint16_t value;
+    int result;
+
+    HAL_FLASH_Unlock();
+
+    /* 先写块头, 写到一半复位时上电扫描也能跳过整个块 */
+    result = crash_flash_program(addr, CRASH_CHUNK_MAGIC);
+    if (result == RT_EOK)
+        result = crash_flash_program(addr + 2, len);
+    if (result == RT_EOK)
+        result = crash_flash_program(addr + 4, crash_flash.seq & 0xFFFF);
+    if (result == RT_EOK)
+        result = crash_flash_program(addr + 6, crash_flash.seq >> 16);
+
+    for (i = 0; i < len && result == RT_EOK; i += 2)
+    {
+        value = data[i] | ((i + 1 < len ? data[i + 1] : 0xFF) << 8);
+        result = crash_flash_program(addr + CRASH_CHUNK_HDR_SIZE + i, value);
+    }
+
+    HAL_FLASH_Lock();
+
+    return result;
+}
+
+/* 把 RAM 中未保存的记录写入 flash, 只在线程中调用 */
+static void crash_flush(void)
+{
+    rt_base_t irq_level;
+    rt_uint32_t start, end, pos;
+    rt_size_t used, limit, out_len;
+    int rc = RT_EOK;
+
+    /* main hook 和命令行可能同时调用 */
+    irq_level = rt_hw_interrupt_disable();
+    if (crash_flash.flushing)
+    {
+        rt_hw_interrupt_enable(irq_level);
+        return;
+    }
+    crash_flash.flushing = 1;
+    rt_hw_interrupt_enable(irq_level);
+
+    crash_flash.flush_tick = rt_tick_get();
+
+    while (rc != -RT_EBUSY)
+    {
+        irq_level = rt_hw_interrupt_disable();
+        start = crash_ram.flush;
+        end = crash_ram.write;
+        rt_hw_interrupt_enable(irq_level);
+
+        if (start == end)
+            break;
+
+        /* 当前页空间不足或不是空白则换到下一页 */
+        if (FLASH_PAGE_SIZE - crash_flash.offset < CRASH_CHUNK_HDR_SIZE + CRASH_CHUNK_MIN_DATA
+                || !crash_flash_blank(crash_page_addr(crash_flash.page) + crash_flash.offset,
+                                      FLASH_PAGE_SIZE - crash_flash.offset))
+        {
+            crash_flash.page = (crash_flash.page + 1) % ULOG_CRASH_FLASH_PAGE_NUM;
+            crash_flash.offset = 0;
+            if (crash_flash_erase(crash_flash.page) != RT_EOK)
+                break;
+        }
+
+        limit = FLASH_PAGE_SIZE - crash_flash.offset - CRASH_CHUNK_HDR_SIZE;
+        if (limit > CRASH_FLUSH_BUF_SIZE)
+            limit = CRASH_FLUSH_BUF_SIZE;
+
+        /* 攒一批完整的记录 */
+        used = 0;
+        for (pos = start; (rt_int32_t)(end - pos) > 0; pos += rc)
+        {
+            rc = crash_rec_read(pos, end, crash_flush_buf + used, limit - used, &out_len);
+            if (rc < 0)
+                break;
+            used += out_len;
+        }
+
+        if (used > 0)
+        {
+            int result = crash_chunk_program(crash_page_addr(crash_flash.page) + crash_flash.offset,
+                                             crash_flush_buf, used);
+
+            crash_flash.seq++;
+            crash_flash.offset += CRASH_CHUNK_HDR_SIZE + RT_ALIGN(used, 2);
+
+            if (result != RT_EOK)
+                break;
+        }
+
+        irq_level = rt_hw_interrupt_disable();
+        /* 写的过程中被覆盖则 flush 可能已被推进到更后面 */
+        if ((rt_int32_t)(pos - crash_ram.flush) > 0)
+            crash_ram.flush = pos;
+        rt_hw_interrupt_enable(irq_level);
+    }
+
+    crash_flash.flushing = 0;
+}
+
+static void crash_main_hook_cb(void)
+{
+    rt_uint32_t pending = crash_ram.write - crash_ram.flush;
+
+    if (pending == 0)
+        return;
+
+    if (pending >= ULOG_CRASH_FLUSH_THRESHOLD
+            || (rt_tick_get() - crash_flash.flush_tick) >= rt_tick_from_millisecond(ULOG_CRASH_FLUSH_INTERVAL))
+        crash_flush();
+}
+
+static void ulog_crash_backend_output(struct ulog_backend *backend, rt_uint32_t level, const char *tag,
+                                      rt_bool_t is_raw, char *log, size_t len)
+{
+    rt_size_t newline_len = sizeof(ULOG_NEWLINE_SIGN) - 1;
+
+    if (is_raw || level > ULOG_CRASH_LVL)
+        return;
+
+    if (len >= newline_len && rt_memcmp(log + len - newline_len, ULOG_NEWLINE_SIGN, newline_len) == 0)
+        len -= newline_len;
+
+    crash_ram_append(level, log, len);
+}
+
+#ifdef ULOG_USING_DEFERRED
+/* 保存参数时调用, 可能在中断中, 只拷贝原始记录 */
+static void ulog_crash_backend_capture(struct ulog_backend *backend, const struct ulog_deferred_rec *rec,
+                                       const rt_ubase_t *argv, const char *str, rt_size_t str_len)
+{
+    rt_base_t irq_level;
+    struct ulog_deferred_rec hdr = *rec;
+    rt_size_t argv_len = rec->argc * sizeof(rt_ubase_t);
+    rt_size_t len = sizeof(hdr) + argv_len + str_len;
+
+    /* RAM 太小时放不下参数多的记录 */
+    if (len > CRASH_REC_LEN_MAX)
+        return;
+
+    hdr.reserved = crash_fmt_check(rec->format);
+
+    irq_level = rt_hw_interrupt_disable();
+    crash_ram_hdr(CRASH_REC_SYNC_RAW, rec->level, rec->tick, len);
+    crash_ram_put((const rt_uint8_t *)&hdr, sizeof(hdr));
+    crash_ram_put((const rt_uint8_t *)argv, argv_len);
+    crash_ram_put((const rt_uint8_t *)str, str_len);
+    rt_hw_interrupt_enable(irq_level);
+}
+#endif /* ULOG_USING_DEFERRED */
+
+int ulog_crash_backend_init(void)
+{
+    /* 复位后内容不合法则重新初始化 */
+    if (crash_ram.magic != CRASH_RAM_MAGIC || crash_ram.write - crash_ram.flush > CRASH_RAM_BUF_SIZE)
+    {
+        rt_memset(&crash_ram, 0, sizeof(crash_ram));
+        crash_ram.magic = CRASH_RAM_MAGIC;
+    }
+    crash_ram.boot_cnt++;
+
+    crash_flash.reset_csr = RCC->CSR;
+    __HAL_RCC_CLEAR_RESET_FLAGS();
+    crash_ram_append(CRASH_REC_LVL_BOOT, (const char *)&crash_flash.reset_csr, sizeof(crash_flash.reset_csr));
+
+    crash_flash_scan();
+    /* 上次复位前没来得及保存的记录 */
+    crash_flush();
+
+    crash.output = ulog_crash_backend_output;
+#ifdef ULOG_USING_DEFERRED
+    crash.capture = ulog_crash_backend_capture;
+    crash.capture_lvl = ULOG_CRASH_LVL;
+#endif
+    ulog_backend_register(&crash, "crash", RT_FALSE);
+
+    crash_main_hook_module.hook = crash_main_hook_cb;
+    main_hook_module_register(&crash_main_hook_module);
+
+    return 0;
+}
+INIT_DEVICE_EXPORT(ulog_crash_backend_init);
+
+#if defined(RT_USING_FINSH) && defined(FINSH_USING_MSH)
+#include <finsh.h>
+
+static void crash_hex_dump(rt_uint32_t addr, rt_size_t size)
+{
+    rt_size_t i, j;
+
+    for (i = 0; i < size; i += 32)
+    {
+        rt_kprintf("%08X:", addr + i);
+        for (j = 0; j < 32 && i + j < size; j++)
+            rt_kprintf("%02X", *(volatile rt_uint8_t *)(addr + i + j));
+        rt_kprintf("\r\n");
+    }
+}
+
+static void ulog_crash(uint8_t argc, char **argv)
+{
+    rt_uint16_t page;
+
+    if (argc < 2)
+    {
+        rt_kprintf("boot: %u, reset csr: 0x%08X\r\n", crash_ram.boot_cnt, crash_flash.reset_csr);
+        rt_kprintf("ram: %u/%u bytes pending, overrun: %u, invalid: %u\r\n", crash_ram.write - crash_ram.flush,
+                   CRASH_RAM_BUF_SIZE, crash_flash.overrun_cnt, crash_flash.invalid_cnt);
+        rt_kprintf("flash: page %u, offset %u, seq %u, error %u\r\n", crash_flash.page, crash_flash.offset,
+                   crash_flash.seq, crash_flash.flash_err_cnt);
+        rt_kprintf("Please input: ulog_crash <dump | flush | erase>\r\n");
+        return;
+    }
+
+    if (!rt_strcmp(argv[1], "dump"))
+    {
+        /* 跳过空白页 */
+        for (page = 0; page < ULOG_CRASH_FLASH_PAGE_NUM; page++)
+        {
+            if (!crash_flash_blank(crash_page_addr(page), CRASH_CHUNK_HDR_SIZE))
+                crash_hex_dump(crash_page_addr(page), FLASH_PAGE_SIZE);
+        }
+        crash_hex_dump((rt_uint32_t)&crash_ram, sizeof(crash_ram));
+    }
+    else if (!rt_strcmp(argv[1], "flush"))
+    {
+        crash_flush();
+    }
+    else if (!rt_strcmp(argv[1], "erase"))
+    {
+        for (page = 0; page < ULOG_CRASH_FLASH_PAGE_NUM; page++)
+            crash_flash_erase(page);
+
+        crash_flash.page = 0;
+        crash_flash.offset = 0;
+        crash_flash.seq = 0;
+    }
+}
+MSH_CMD_EXPORT(ulog_crash, Show or dump ulog crash log);
+#endif /* defined(RT_USING_FINSH) && defined(FINSH_USING_MSH) */
+
+#endif /* ULOG_BACKEND_USING_CRASH */
@@ -10,9 +10,13 @@
 
 #include <stdarg.h>
 #include <stdlib.h>
+#include <limits.h>
 #include "ulog.h"
 #include "rthw.h"
 #include "ringblk_buf.h"
+#ifdef ULOG_USING_DEFERRED
+#include "mpsc_ring.h"
+#endif
 
 #ifdef ULOG_USING_SYSLOG
 #include <syslog.h>
@@ -26,6 +30,10 @@
 #include <time.h>
 #endif
 
+#ifdef ULOG_USING_DEFERRED
+#include "main_hook.h"
+#endif
+
 #ifdef RT_USING_ULOG
 
 /* the number of log block */
@@ -72,6 +80,71 @@
 #error "the log line buffer size must more than 80"
 #endif
 
+#ifndef ULOG_HDR_CACHE_NUM
+#define ULOG_HDR_CACHE_NUM              8
+#endif
+
+#if (ULOG_HDR_CACHE_NUM == 0) || (ULOG_HDR_CACHE_NUM & (ULOG_HDR_CACHE_NUM - 1))
+#error "the header cache num must be power of 2"
+#endif
+
+/* 缓存的等级和标签部分最大长度, 更长的标签每次重新拼接 */
+#define ULOG_HDR_SEG_MAX                32
+
+/**
+ * 日志头中时间之后的等级和标签部分, 如 " I/wifi".
+ * 按标签地址和等级选缓存项, 命中时还要比较标签内容, 同一地址的标签缓冲区内容改变后不会输出旧标签
+ */
+struct ulog_hdr_seg
+{
+    rt_uint8_t level;
+    rt_uint8_t len;
+    /* 标签在 buf 中的位置 */
+    rt_uint8_t tag_off;
+    char buf[ULOG_HDR_SEG_MAX];
+};
+
+#ifdef ULOG_USING_FILTER
+#if ULOG_TAG_NUM >= 255
+#error "the interned tag num must less than 255"
+#endif
+
+#define ULOG_TAG_ID_NONE                0xFF
+
+/* 登记的标签及其过滤结果, 过滤设置变化时刷新 */
+struct ulog_tag
+{
+    const char *name;
+    rt_uint32_t level;
+    rt_bool_t match;
+};
+#endif /* ULOG_USING_FILTER */
+
+#ifdef ULOG_USING_DEFERRED
+#if defined(ULOG_USING_SYSLOG) || defined(ULOG_OUTPUT_FLOAT) || defined(ULOG_TIME_USING_TIMESTAMP)
+#error "deferred log is not available on syslog, float or timestamp mode"
+#endif
+
+#if (ULOG_DEFERRED_BUFSZ & (ULOG_DEFERRED_BUFSZ - 1)) || (ULOG_DEFERRED_BUFSZ > 65536)
+#error "the deferred log buffer size must be power of 2 and not more than 65536"
+#endif
+
+#if ULOG_BATCH_BUFSZ < ULOG_LINE_BUF_SIZE + 1
+#error "the batch buffer size must more than the log line buffer size"
+#endif
+
+#ifdef ULOG_USING_ASYNC_OUTPUT
+#define ULOG_ASYNC_EVENT_OUTPUT         (1 << 0)
+#define ULOG_ASYNC_EVENT_SPACE          (1 << 1)
+
+/* 队列满时溢出次数达到此值仍无法预留则丢弃 */
+#define ULOG_ASYNC_OVERWRITE_RETRY      8
+#endif /* ULOG_USING_ASYNC_OUTPUT */
+
+/* 延后格式化时每条日志最多保存的参数个数, 与 ulog_deferred_output 的调用一致, 超过时直接格式化输出 */
+#define ULOG_DEFERRED_ARG_MAX           8
+#endif /* ULOG_USING_DEFERRED */
+
 struct rt_ulog
 {
     rt_bool_t init_ok;
@@ -82,6 +155,66 @@ struct rt_ulog
     struct rt_rbb_blk log_rbb_blk[ULOG_RBB_BLKNUM];
     struct rt_rbb log_rbb;
 
+#ifdef ULOG_USING_DEFERRED
+    struct
+    {
+        /* 多生产者无锁环形缓冲区, 记录日志不关中断 */
+        rt_uint32_t ring_buf[ULOG_DEFERRED_BUFSZ / 4];
+        struct mpsc_ring ring;
+        /* 正在输出的记录, 格式化时使用记录中的时间和线程 */
+        struct ulog_deferred_rec *cur;
+        /* 正在输出延后日志的线程, 其他线程此时直接格式化的日志不使用 cur */
+        rt_thread_t cur_thread;
+        /* 设置了 capture 的后端中 capture_lvl 的最大值 */
+        rt_uint32_t capture_lvl;
+        rt_uint8_t capture_used;
+        rt_uint8_t draining;
+        rt_uint32_t output_cnt;
+        /* 各等级丢弃的日志数 */
+        rt_uint32_t drop_cnt[LOG_LVL_DBG + 1];
+        /* 格式化后的日志攒成一批再输出到后端 */
+        char batch_buf[ULOG_BATCH_BUFSZ];
+        struct ulog_batch_item batch_items[ULOG_BATCH_NUM];
+        rt_size_t batch_num;
+        rt_size_t batch_used;
+    } deferred;
+#endif /* ULOG_USING_DEFERRED */
+
+#ifdef ULOG_USING_ASYNC_OUTPUT
+    struct
+    {
+        struct rt_thread thread;
+        rt_uint8_t thread_stack[ULOG_ASYNC_OUTPUT_THREAD_STACK];
+        struct rt_event event;
+        /* 各等级队列满时的处理方式 */
+        rt_uint8_t policy[LOG_LVL_DBG + 1];
+        /* 为新日志丢弃的旧日志数 */
+        rt_uint32_t overwrite_cnt;
+        /* 阻塞等待空间的次数 */
+        rt_uint32_t block_cnt;
+    } async;
+#endif /* ULOG_USING_ASYNC_OUTPUT */
+
+    /* 日志头缓存 */
+    struct
+    {
+#ifdef ULOG_USING_COLOR
+        rt_uint8_t color_len[LOG_LVL_DBG + 1];
+#endif
+        struct ulog_hdr_seg segs[ULOG_HDR_CACHE_NUM];
+#ifdef ULOG_OUTPUT_TIME
+        /* 上次格式化的时间, 同一秒内直接复用, time_len 为 0 表示无效 */
+#ifdef ULOG_TIME_USING_TIMESTAMP
+        time_t time_key;
+#else
+        /* tick / 1000 */
+        rt_uint32_t time_key;
+#endif
+        rt_uint8_t time_len;
+        char time_buf[16];
+#endif /* ULOG_OUTPUT_TIME */
+    } hdr;
+
 #ifdef ULOG_USING_FILTER
     struct
     {
@@ -92,6 +225,8 @@ struct rt_ulog
         char tag[ULOG_FILTER_TAG_MAX_LEN + 1];
         char keyword[ULOG_FILTER_KW_MAX_LEN + 1];
     } filter;
+    /* interned tags, index is tag id - 1 */
+    struct ulog_tag tags[ULOG_TAG_NUM];
 #endif /* ULOG_USING_FILTER */
 };
 
@@ -148,23 +283,240 @@ size_t ulog_strcpy(size_t cur_len, char *dst, const char *src)
     return src - src_old;
 }
 
+/* 按位减去 10 的幂得到每一位, 不用除法 */
+static const unsigned long int ultoa_pow10[] =
+{
+#if ULONG_MAX > 0xFFFFFFFFUL
+    10000000000000000000UL, 1000000000000000000UL, 100000000000000000UL, 10000000000000000UL,
+    1000000000000000UL, 100000000000000UL, 10000000000000UL, 1000000000000UL,
+    100000000000UL, 10000000000UL,
+#endif
+    1000000000UL, 100000000UL, 10000000UL, 1000000UL, 100000UL, 10000UL, 1000UL, 100UL, 10UL, 1UL,
+};
+
 size_t ulog_ultoa(char *s, unsigned long int n)
 {
-    size_t i = 0, j = 0, len = 0;
-    char swap;
+    size_t i, len = 0;
+    char digit;
 
-    do
+    for (i = 0; i < sizeof(ultoa_pow10) / sizeof(ultoa_pow10[0]); i++)
     {
-        s[len++] = n % 10 + '0';
-    } while (n /= 10);
+        digit = '0';
+        while (n >= ultoa_pow10[i])
+        {
+            n -= ultoa_pow10[i];
+            digit++;
+        }
+        /* skip leading zero */
+        if (len || digit != '0' || ultoa_pow10[i] == 1)
+        {
+            s[len++] = digit;
+        }
+    }
     s[len] = '\0';
-    /* reverse string */
-    for (i = 0, j = len - 1; i < j; ++i, --j)
+
+    return len;
+}
+
+#ifdef ULOG_USING_DEFERRED
+/* 当前格式化的延后日志记录, 直接格式化时为 RT_NULL */
+static struct ulog_deferred_rec *ulog_deferred_cur(void)
+{
+    if (rt_interrupt_get_nest() != 0 || rt_thread_self() != ulog.deferred.cur_thread)
+        return RT_NULL;
+
+    return ulog.deferred.cur;
+}
+#endif /* ULOG_USING_DEFERRED */
+
+#ifdef ULOG_OUTPUT_TIME
+/**
+ * format the time part of log header, the part in same second is cached
+ *
+ * @param buf output buffer, must has 16 bytes space at least
+ *
+ * @return time part length
+ */
+static rt_size_t ulog_hdr_time(char *buf)
+{
+    rt_size_t len = 0;
+    rt_base_t level;
+#ifdef ULOG_TIME_USING_TIMESTAMP
+    time_t now = time(NULL);
+    struct tm tm_info;
+
+    level = rt_hw_interrupt_disable();
+    if (ulog.hdr.time_len && ulog.hdr.time_key == now)
+    {
+        len = ulog.hdr.time_len;
+        rt_memcpy(buf, ulog.hdr.time_buf, len);
+    }
+    rt_hw_interrupt_enable(level);
+
+    if (len == 0)
+    {
+        localtime_r(&now, &tm_info);
+        len = rt_snprintf(buf, sizeof(ulog.hdr.time_buf), "%02d-%02d %02d:%02d:%02d", tm_info.tm_mon + 1,
+                          tm_info.tm_mday, tm_info.tm_hour, tm_info.tm_min, tm_info.tm_sec);
+        if (len >= sizeof(ulog.hdr.time_buf))
+        {
+            len = sizeof(ulog.hdr.time_buf) - 1;
+        }
+
+        level = rt_hw_interrupt_disable();
+        rt_memcpy(ulog.hdr.time_buf, buf, len);
+        ulog.hdr.time_len = len;
+        ulog.hdr.time_key = now;
+        rt_hw_interrupt_enable(level);
+    }
+#else
+    rt_tick_t tick;
+    rt_uint32_t high, low, digit;
+
+#ifdef ULOG_USING_DEFERRED
+    struct ulog_deferred_rec *rec;
+
+    rec = ulog_deferred_cur();
+    tick = rec ? rec->tick : rt_tick_get();
+#else
+    tick = rt_tick_get();
+#endif
+    /* 除以常数由编译器转换为乘法 */
+    high = tick / 1000;
+    low = tick - high * 1000;
+
+    buf[len++] = '[';
+    if (high)
+    {
+        rt_size_t high_len = 0;
+
+        level = rt_hw_interrupt_disable();
+        if (ulog.hdr.time_len && ulog.hdr.time_key == high)
+        {
+            high_len = ulog.hdr.time_len;
+            rt_memcpy(buf + len, ulog.hdr.time_buf, high_len);
+        }
+        rt_hw_interrupt_enable(level);
+
+        if (high_len == 0)
+        {
+            high_len = ulog_ultoa(buf + len, high);
+
+            level = rt_hw_interrupt_disable();
+            rt_memcpy(ulog.hdr.time_buf, buf + len, high_len);
+            ulog.hdr.time_len = high_len;
+            ulog.hdr.time_key = high;
+            rt_hw_interrupt_enable(level);
+        }
+        len += high_len;
+
+        /* low part always has 3 digits */
+        digit = low / 100;
+        buf[len++] = '0' + digit;
+        low -= digit * 100;
+        digit = low / 10;
+        buf[len++] = '0' + digit;
+        buf[len++] = '0' + (low - digit * 10);
+    }
+    else
+    {
+        len += ulog_ultoa(buf + len, low);
+    }
+    buf[len++] = ']';
+#endif /* ULOG_TIME_USING_TIMESTAMP */
+
+    return len;
+}
+#endif /* ULOG_OUTPUT_TIME */
+
+/* 拼接等级和标签部分, 返回需要的长度, 超过 size 时只写入 size 个字符 */
+static rt_size_t ulog_hdr_seg_build(char *buf, rt_size_t size, rt_uint32_t level, const char *tag)
+{
+    rt_size_t len = 0;
+    const char *src;
+
+#ifdef ULOG_OUTPUT_LEVEL
+#ifdef ULOG_OUTPUT_TIME
+    if (len < size) buf[len] = ' ';
+    len++;
+#endif
+    for (src = level_output_info[level]; src && *src; src++, len++)
+    {
+        if (len < size) buf[len] = *src;
+    }
+#endif /* ULOG_OUTPUT_LEVEL */
+
+#ifdef ULOG_OUTPUT_TAG
+#if !defined(ULOG_OUTPUT_LEVEL) && defined(ULOG_OUTPUT_TIME)
+    if (len < size) buf[len] = ' ';
+    len++;
+#endif
+    for (src = tag; *src; src++, len++)
+    {
+        if (len < size) buf[len] = *src;
+    }
+#endif /* ULOG_OUTPUT_TAG */
+
+    return len;
+}
+
+/* 缓存的标签与 tag 内容相同 */
+static rt_bool_t ulog_hdr_seg_match(const struct ulog_hdr_seg *seg, const char *tag)
+{
+#ifdef ULOG_OUTPUT_TAG
+    rt_size_t tag_len = seg->len - seg->tag_off;
+
+    return rt_strncmp(seg->buf + seg->tag_off, tag, tag_len) == 0 && tag[tag_len] == '\0';
+#else
+    return RT_TRUE;
+#endif
+}
+
+/**
+ * output the level and tag part of log header by cache
+ *
+ * @param buf output buffer
+ * @param size output buffer size, must more than ULOG_HDR_SEG_MAX
+ * @param level level
+ * @param tag tag
+ *
+ * @return level and tag part length
+ */
+static rt_size_t ulog_hdr_seg(char *buf, rt_size_t size, rt_uint32_t level, const char *tag)
+{
+    struct ulog_hdr_seg *seg = &ulog.hdr.segs[(((rt_ubase_t)tag >> 2) + level) & (ULOG_HDR_CACHE_NUM - 1)];
+    rt_size_t len = 0;
+    rt_base_t irq;
+
+    irq = rt_hw_interrupt_disable();
+    if (seg->len && seg->level == level && ulog_hdr_seg_match(seg, tag))
+    {
+        len = seg->len;
+        rt_memcpy(buf, seg->buf, len);
+    }
+    rt_hw_interrupt_enable(irq);
+
+    if (len)
+        return len;
+
+    len = ulog_hdr_seg_build(buf, size, level, tag);
+    if (len > ULOG_HDR_SEG_MAX)
     {
-        swap = s[i];
-        s[i] = s[j];
-        s[j] = swap;
+        /* too long to cache */
+        return len < size ? len : size;
     }
+
+    irq = rt_hw_interrupt_disable();
+    seg->level = level;
+    seg->len = len;
+#ifdef ULOG_OUTPUT_TAG
+    seg->tag_off = len - rt_strlen(tag);
+#else
+    seg->tag_off = len;
+#endif
+    rt_memcpy(seg->buf, buf, len);
+    rt_hw_interrupt_enable(irq);
+
     return len;
 }
 
@@ -187,194 +539,905 @@ RT_WEAK rt_size_t ulog_formater(char *log_buf, rt_uint32_t level, const char *ta
     RT_ASSERT(format);
 
     log_len = 0;
-    newline_len = rt_strlen(ULOG_NEWLINE_SIGN);
+    newline_len = sizeof(ULOG_NEWLINE_SIGN) - 1;
 
 #ifdef ULOG_USING_COLOR
     /* add CSI start sign and color info */
-    if (color_output_info[level])
+    if (ulog.hdr.color_len[level])
     {
-        log_len += ulog_strcpy(log_len, log_buf + log_len, CSI_START);
-        log_len += ulog_strcpy(log_len, log_buf + log_len, color_output_info[level]);
+        rt_memcpy(log_buf + log_len, CSI_START, sizeof(CSI_START) - 1);
+        log_len += sizeof(CSI_START) - 1;
+        rt_memcpy(log_buf + log_len, color_output_info[level], ulog.hdr.color_len[level]);
+        log_len += ulog.hdr.color_len[level];
     }
 #endif /* ULOG_USING_COLOR */
 
 #ifdef ULOG_OUTPUT_TIME
     /* add time info */
+    log_len += ulog_hdr_time(log_buf + log_len);
+#endif /* ULOG_OUTPUT_TIME */
+
+#if defined(ULOG_OUTPUT_LEVEL) || defined(ULOG_OUTPUT_TAG)
+    /* add level and tag info */
+    log_len += ulog_hdr_seg(log_buf + log_len, ULOG_LINE_BUF_SIZE - log_len, level, tag);
+#endif
+
+#ifdef ULOG_OUTPUT_THREAD_NAME
+    /* add thread info */
     {
-#ifdef ULOG_TIME_USING_TIMESTAMP
-        time_t now;
-        struct tm tm_info;
 
-        now = time(NULL);
-        localtime_r(&now, &tm_info);
+#if defined(ULOG_OUTPUT_TIME) || defined(ULOG_OUTPUT_LEVEL) || defined(ULOG_OUTPUT_TAG)
+        log_len += ulog_strcpy(log_len, log_buf + log_len, " ");
+#endif
+
+#ifdef ULOG_USING_DEFERRED
+        struct ulog_deferred_rec *rec = ulog_deferred_cur();
+
+        if (rec)
+        {
+            if (rec->thread)
+            {
+                rt_size_t name_len = rt_strnlen(rec->thread, RT_NAME_MAX);
+
+                rt_strncpy(log_buf + log_len, rec->thread, name_len);
+                log_len += name_len;
+            }
+            else
+            {
+                log_len += ulog_strcpy(log_len, log_buf + log_len, "ISR");
+            }
+        }
+        else
+#endif /* ULOG_USING_DEFERRED */
+        /* is not in interrupt context */
+        if (rt_interrupt_get_nest() == 0)
+        {
+            rt_size_t name_len = rt_strnlen(rt_thread_self()->name, RT_NAME_MAX);
+
+            rt_strncpy(log_buf + log_len, rt_thread_self()->name, name_len);
+            log_len += name_len;
+        }
+        else
+        {
+            log_len += ulog_strcpy(log_len, log_buf + log_len, "ISR");
+        }
+    }
+#endif /* ULOG_OUTPUT_THREAD_NAME */
+
+    log_buf[log_len++] = ':';
+    log_buf[log_len++] = ' ';
+
+#ifdef ULOG_OUTPUT_FLOAT
+    fmt_result = vsnprintf(log_buf + log_len, ULOG_LINE_BUF_SIZE - log_len, format, args);
+#else
+    fmt_result = rt_vsnprintf(log_buf + log_len, ULOG_LINE_BUF_SIZE - log_len, format, args);
+#endif /* ULOG_OUTPUT_FLOAT */
 
-        rt_snprintf(log_buf + log_len, ULOG_LINE_BUF_SIZE - log_len, "%02d-%02d %02d:%02d:%02d", tm_info.tm_mon + 1,
-                    tm_info.tm_mday, tm_info.tm_hour, tm_info.tm_min, tm_info.tm_sec);
+    /* calculate log length */
+    if ((log_len + fmt_result <= ULOG_LINE_BUF_SIZE) && (fmt_result > -1))
+    {
+        log_len += fmt_result;
+    }
+    else
+    {
+        /* using max length */
+        log_len = ULOG_LINE_BUF_SIZE;
+    }
+
+    /* overflow check and reserve some space for CSI end sign and newline sign */
+#ifdef ULOG_USING_COLOR
+    if (log_len + (sizeof(CSI_END) - 1) + newline_len > ULOG_LINE_BUF_SIZE)
+    {
+        /* using max length */
+        log_len = ULOG_LINE_BUF_SIZE;
+        /* reserve some space for CSI end sign */
+        log_len -= (sizeof(CSI_END) - 1);
+#else
+    if (log_len + newline_len > ULOG_LINE_BUF_SIZE)
+    {
+        /* using max length */
+        log_len = ULOG_LINE_BUF_SIZE;
+#endif /* ULOG_USING_COLOR */
+        /* reserve some space for newline sign */
+        log_len -= newline_len;
+    }
+
+    /* package newline sign */
+    if (newline)
+    {
+        log_len += ulog_strcpy(log_len, log_buf + log_len, ULOG_NEWLINE_SIGN);
+    }
+
+#ifdef ULOG_USING_COLOR
+    /* add CSI end sign  */
+    if (color_output_info[level])
+    {
+        log_len += ulog_strcpy(log_len, log_buf + log_len, CSI_END);
+    }
+#endif /* ULOG_USING_COLOR */
+
+    return log_len;
+}
+
+static void ulog_output_to_backend(ulog_backend_t backend, rt_uint32_t level, const char *tag, rt_bool_t is_raw, char *log, rt_size_t size)
+{
+#if !defined(ULOG_USING_COLOR) || defined(ULOG_USING_SYSLOG)
+    backend->output(backend, level, tag, is_raw, log, size);
 #else
-        rt_size_t tick_len = 0;
+    if (backend->support_color || is_raw)
+    {
+        backend->output(backend, level, tag, is_raw, log, size);
+    }
+    else
+    {
+        /* recalculate the log start address and log size when backend not supported color */
+        rt_size_t color_info_len = ulog.hdr.color_len[level], output_size = size;
+        if (color_info_len)
+        {
+            rt_size_t color_hdr_len = (sizeof(CSI_START) - 1) + color_info_len;
+
+            log += color_hdr_len;
+            output_size -= (color_hdr_len + (sizeof(CSI_END) - 1));
+        }
+        backend->output(backend, level, tag, is_raw, log, output_size);
+    }
+#endif /* !defined(ULOG_USING_COLOR) || defined(ULOG_USING_SYSLOG) */
+}
+
+static void ulog_output_to_all_backend(rt_uint32_t level, const char *tag, rt_bool_t is_raw, char *log, rt_size_t size)
+{
+    rt_slist_t *node;
+    ulog_backend_t backend;
+
+    if (!ulog.init_ok)
+        return;
+
+    /* output for all backends */
+    for (node = rt_slist_first(&ulog.backend_list); node; node = rt_slist_next(node))
+    {
+        backend = rt_slist_entry(node, struct ulog_backend, list);
+        ulog_output_to_backend(backend, level, tag, is_raw, log, size);
+    }
+}
+
+#ifdef ULOG_USING_DEFERRED
+/* output a batch of logs, the backend which has output_batch is called once */
+static void ulog_output_batch_to_all_backend(const struct ulog_batch_item *items, rt_size_t num)
+{
+    rt_slist_t *node;
+    ulog_backend_t backend;
+    rt_size_t i;
+
+    if (!ulog.init_ok || num == 0)
+        return;
+
+    for (node = rt_slist_first(&ulog.backend_list); node; node = rt_slist_next(node))
+    {
+        backend = rt_slist_entry(node, struct ulog_backend, list);
+        /* capture_lvl 以内的日志已在保存参数时交给后端 */
+        if (backend->capture)
+        {
+            for (i = 0; i < num; i++)
+            {
+                if (items[i].level > backend->capture_lvl)
+                    ulog_output_to_backend(backend, items[i].level, items[i].tag, items[i].is_raw, items[i].log, items[i].len);
+            }
+            continue;
+        }
+#if defined(ULOG_USING_COLOR) && !defined(ULOG_USING_SYSLOG)
+        if (backend->output_batch && backend->support_color)
+#else
+        if (backend->output_batch)
+#endif
+        {
+            backend->output_batch(backend, items, num);
+        }
+        else
+        {
+            for (i = 0; i < num; i++)
+                ulog_output_to_backend(backend, items[i].level, items[i].tag, items[i].is_raw, items[i].log, items[i].len);
+        }
+    }
+}
+#endif /* ULOG_USING_DEFERRED */
+
+static void do_output(rt_uint32_t level, const char *tag, rt_bool_t is_raw, char *log_buf, rt_size_t log_len)
+{
+    /* is in thread context */
+    if (rt_interrupt_get_nest() == 0)
+    {
+        /* output to all backends */
+        ulog_output_to_all_backend(level, tag, is_raw, log_buf, log_len);
+    }
+    else
+    {
+#ifdef ULOG_BACKEND_USING_CONSOLE
+        /* We can't ensure that all backends support ISR context output.
+         * So only using rt_kprintf when context is ISR */
+        extern void ulog_console_backend_output(struct ulog_backend *backend, rt_uint32_t level, const char *tag,
+                                                rt_bool_t is_raw, char *log, size_t len);
+        ulog_console_backend_output(NULL, level, tag, is_raw, log_buf, log_len);
+#endif /* ULOG_BACKEND_USING_CONSOLE */
+    }
+}
+
+/**
+ * format the log line and do keyword filter
+ *
+ * @param log_buf the buffer must has ULOG_LINE_BUF_SIZE + 1 bytes
+ *
+ * @return log length, 0 when filtered by keyword
+ */
+static rt_size_t ulog_format_line(char *log_buf, rt_uint32_t level, const char *tag, rt_bool_t newline, const char *format, va_list args)
+{
+    rt_size_t log_len = 0;
+
+#ifndef ULOG_USING_SYSLOG
+    log_len = ulog_formater(log_buf, level, tag, newline, format, args);
+#else
+    extern rt_size_t syslog_formater(char *log_buf, rt_uint8_t level, const char *tag, rt_bool_t newline, const char *format, va_list args);
+    log_len = syslog_formater(log_buf, level, tag, newline, format, args);
+#endif /* ULOG_USING_SYSLOG */
+
+#ifdef ULOG_USING_FILTER
+    /* keyword filter */
+    if (ulog.filter.keyword[0] != '\0')
+    {
+        /* add string end sign */
+        log_buf[log_len] = '\0';
+        /* find the keyword */
+        if (!rt_strstr(log_buf, ulog.filter.keyword))
+        {
+            return 0;
+        }
+    }
+#endif /* ULOG_USING_FILTER */
+
+    return log_len;
+}
+
+static void ulog_voutput_format(rt_uint32_t level, const char *tag, rt_bool_t newline, const char *format, va_list args)
+{
+    char *log_buf = NULL;
+    rt_size_t log_len = 0;
+
+    rt_rbb_blk_t block = get_log_blk();
+    if(block == RT_NULL)
+        return;
+
+    /* get log buffer */
+    log_buf = (char *)block->buf;
+
+    log_len = ulog_format_line(log_buf, level, tag, newline, format, args);
+    /* do log output */
+    if (log_len > 0)
+        do_output(level, tag, RT_FALSE, log_buf, log_len);
+
+    rt_rbb_blk_free(&ulog.log_rbb, block);
+}
+
+#ifdef ULOG_USING_DEFERRED
+/**
+ * 只扫描格式串取出原始参数, 不做格式化.
+ * %s 参数拷贝到字符串区 (调用者的缓冲区在输出时可能已失效), 其余参数按字保存.
+ *
+ * @return >= 0: 字符串区使用长度
+ *           -1: 参数超过 ULOG_DEFERRED_ARG_MAX 个或有 64 位参数, 不能按字保存
+ */
+static int ulog_deferred_pack(rt_ubase_t *argv, rt_uint8_t *argc, char *str, const char *format, va_list args)
+{
+    const char *p;
+    const char *s;
+    rt_size_t str_len = 0, n;
+    int precision, qualifier;
+
+    *argc = 0;
+
+    for (p = format; *p != '\0'; p++)
+    {
+        if (*p != '%')
+            continue;
+
+        p++;
+        if (*p == '%')
+            continue;
+
+        /* flags */
+        while (*p == '-' || *p == '+' || *p == ' ' || *p == '#' || *p == '0')
+            p++;
+
+        /* width */
+        if (*p == '*')
+        {
+            if (*argc >= ULOG_DEFERRED_ARG_MAX)
+                return -1;
+            argv[(*argc)++] = va_arg(args, int);
+            p++;
+        }
+        else
+        {
+            while (*p >= '0' && *p <= '9')
+                p++;
+        }
+
+        /* precision */
+        precision = -1;
+        if (*p == '.')
+        {
+            p++;
+            if (*p == '*')
+            {
+                if (*argc >= ULOG_DEFERRED_ARG_MAX)
+                    return -1;
+                precision = va_arg(args, int);
+                argv[(*argc)++] = precision;
+                p++;
+            }
+            else
+            {
+                precision = 0;
+                while (*p >= '0' && *p <= '9')
+                    precision = precision * 10 + (*p++ - '0');
+            }
+        }
+
+        /* qualifier, %ll 和 %L 的参数占两个字 */
+        qualifier = 0;
+        while (*p == 'h' || *p == 'l' || *p == 'L')
+        {
+            if (*p == 'l')
+                qualifier++;
+            else if (*p == 'L')
+                qualifier += 2;
+            p++;
+        }
+
+        if (*p == '\0')
+            break;
+
+        if (qualifier >= 2 || *argc >= ULOG_DEFERRED_ARG_MAX)
+            return -1;
+
+        if (*p == 's')
+        {
+            s = va_arg(args, const char *);
+            if (s == RT_NULL)
+                s = "(NULL)";
+
+            if (str_len < ULOG_DEFERRED_STR_MAX)
+            {
+                n = (precision >= 0) ? rt_strnlen(s, precision) : rt_strlen(s);
+                if (n > ULOG_DEFERRED_STR_MAX - 1 - str_len)
+                    n = ULOG_DEFERRED_STR_MAX - 1 - str_len;
+
+                rt_memcpy(str + str_len, s, n);
+                str[str_len + n] = '\0';
+                argv[(*argc)++] = str_len;
+                str_len += n + 1;
+            }
+            else
+            {
+                /* 字符串区已满, 指向最后一个结束符, 输出为空串 */
+                argv[(*argc)++] = ULOG_DEFERRED_STR_MAX - 1;
+            }
+        }
+        else
+        {
+            argv[(*argc)++] = va_arg(args, rt_ubase_t);
+        }
+    }
+
+    return str_len;
+}
+
+/* 同一时间只有一个消费者, 中断中不能等待, 拿不到直接返回 */
+static rt_bool_t ulog_deferred_lock(void)
+{
+    rt_base_t level;
+    rt_bool_t result = RT_FALSE;
+
+    level = rt_hw_interrupt_disable();
+    if (!ulog.deferred.draining)
+    {
+        ulog.deferred.draining = 1;
+        result = RT_TRUE;
+    }
+    rt_hw_interrupt_enable(level);
+
+    return result;
+}
+
+static void ulog_deferred_unlock(void)
+{
+    ulog.deferred.draining = 0;
+}
+
+#ifdef ULOG_USING_ASYNC_OUTPUT
+/* 不格式化直接丢掉最旧的一条日志 */
+static rt_bool_t ulog_deferred_discard_oldest(void)
+{
+    rt_bool_t result = RT_FALSE;
+    struct ulog_deferred_rec *rec;
+
+    if (!ulog_deferred_lock())
+        return RT_FALSE;
+
+    rec = mpsc_ring_peek(&ulog.deferred.ring, RT_NULL);
+    if (rec)
+    {
+        ulog.deferred.drop_cnt[rec->level]++;
+        ulog.async.overwrite_cnt++;
+        mpsc_ring_release(&ulog.deferred.ring);
+        result = RT_TRUE;
+    }
+
+    ulog_deferred_unlock();
+
+    return result;
+}
+
+/* 中断, 调度器启动前和 ulog 线程自己都不能阻塞 */
+static rt_bool_t ulog_async_can_block(void)
+{
+    rt_thread_t thread = rt_thread_self();
+
+    if (rt_interrupt_get_nest() != 0 || thread == RT_NULL || thread == &ulog.async.thread)
+        return RT_FALSE;
+
+    return RT_TRUE;
+}
+#endif /* ULOG_USING_ASYNC_OUTPUT */
+
+/* 按日志等级的策略预留空间 */
+static struct ulog_deferred_rec *ulog_deferred_reserve(rt_uint32_t level, rt_size_t size)
+{
+    struct ulog_deferred_rec *rec;
+#ifdef ULOG_USING_ASYNC_OUTPUT
+    int retry;
+#endif
+
+    rec = mpsc_ring_reserve(&ulog.deferred.ring, size);
+    if (rec)
+        return rec;
+
+#ifdef ULOG_USING_ASYNC_OUTPUT
+    switch (ulog.async.policy[level])
+    {
+    case ULOG_ASYNC_POLICY_OVERWRITE:
+        for (retry = 0; retry < ULOG_ASYNC_OVERWRITE_RETRY; retry++)
+        {
+            /* 消费者正在输出或最旧的日志还没提交 */
+            if (!ulog_deferred_discard_oldest())
+                break;
+
+            rec = mpsc_ring_reserve(&ulog.deferred.ring, size);
+            if (rec)
+                break;
+        }
+        break;
+
+    case ULOG_ASYNC_POLICY_BLOCK:
+        if (!ulog_async_can_block())
+            break;
+
+        ulog.async.block_cnt++;
+        while (rec == RT_NULL)
+        {
+            rt_event_send(&ulog.async.event, ULOG_ASYNC_EVENT_OUTPUT);
+            if (rt_event_recv(&ulog.async.event, ULOG_ASYNC_EVENT_SPACE, RT_EVENT_FLAG_OR | RT_EVENT_FLAG_CLEAR,
+                              rt_tick_from_millisecond(ULOG_ASYNC_BLOCK_TIMEOUT), RT_NULL) != RT_EOK)
+                break;
+
+            rec = mpsc_ring_reserve(&ulog.deferred.ring, size);
+        }
+        break;
+
+    default:
+        break;
+    }
+#endif /* ULOG_USING_ASYNC_OUTPUT */
+
+    return rec;
+}
+
+/**
+ * 复位后要保留的日志在保存参数时就把原始记录交给设置了 capture 的后端, 不在调用者中格式化.
+ * 延后的日志在看门狗复位时还没有格式化, 由后端在复位后用 ulog_capture_format 格式化.
+ */
+static void ulog_deferred_capture_output(const struct ulog_deferred_rec *rec, const rt_ubase_t *argv,
+        const char *str, rt_size_t str_len)
+{
+    rt_slist_t *node;
+    ulog_backend_t backend;
+
+    for (node = rt_slist_first(&ulog.backend_list); node; node = rt_slist_next(node))
+    {
+        backend = rt_slist_entry(node, struct ulog_backend, list);
+        if (backend->capture && rec->level <= backend->capture_lvl)
+            backend->capture(backend, rec, argv, str, str_len);
+    }
+}
+
+/**
+ * 保存原始参数, 延后格式化
+ *
+ * @return RT_FALSE: 参数不能延后格式化, 由调用者直接输出
+ */
+static rt_bool_t ulog_deferred_capture(rt_uint32_t level, const char *tag, rt_bool_t newline, const char *format, va_list args)
+{
+    rt_ubase_t argv[ULOG_DEFERRED_ARG_MAX];
+    char str[ULOG_DEFERRED_STR_MAX];
+    rt_uint8_t argc;
+    rt_size_t size;
+    int str_len;
+    struct ulog_deferred_rec *rec;
+    struct ulog_deferred_rec drop_rec;
+    va_list args_copy;
+
+    /* 不能延后时调用者还要用 args 格式化 */
+    va_copy(args_copy, args);
+    str_len = ulog_deferred_pack(argv, &argc, str, format, args_copy);
+    va_end(args_copy);
+    if (str_len < 0)
+        return RT_FALSE;
+
+    size = sizeof(struct ulog_deferred_rec) + argc * sizeof(rt_ubase_t) + str_len;
+
+    rec = ulog_deferred_reserve(level, size);
+    if (rec == RT_NULL)
+    {
+        ulog.deferred.drop_cnt[level]++;
+        /* 丢弃的日志仍交给 capture 后端 */
+        if (!ulog.deferred.capture_used || level > ulog.deferred.capture_lvl)
+            return RT_TRUE;
+        rec = &drop_rec;
+    }
+
+    rec->format = format;
+    rec->tag = tag;
+    rec->tick = rt_tick_get();
+#ifdef ULOG_OUTPUT_THREAD_NAME
+    rec->thread = (rt_interrupt_get_nest() == 0) ? rt_thread_self()->name : RT_NULL;
+#endif
+    rec->level = level;
+    rec->newline = newline;
+    rec->argc = argc;
+    rec->reserved = 0;
+
+    if (ulog.deferred.capture_used && level <= ulog.deferred.capture_lvl)
+        ulog_deferred_capture_output(rec, argv, str, str_len);
+
+    if (rec == &drop_rec)
+        return RT_TRUE;
+
+    rt_memcpy(rec + 1, argv, argc * sizeof(rt_ubase_t));
+    rt_memcpy((rt_uint8_t *)(rec + 1) + argc * sizeof(rt_ubase_t), str, str_len);
+
+    mpsc_ring_commit(&ulog.deferred.ring, rec);
+
+#ifdef ULOG_USING_ASYNC_OUTPUT
+    rt_event_send(&ulog.async.event, ULOG_ASYNC_EVENT_OUTPUT);
+#endif
+
+    return RT_TRUE;
+}
+
+/* 把 %s 参数的偏移换成记录中的字符串地址, 超出字符串区的偏移输出为空串 */
+static void ulog_deferred_unpack(const struct ulog_deferred_rec *rec, rt_ubase_t *argv, const char *str, rt_size_t str_len)
+{
+    const char *p;
+    int i;
+
+    for (p = rec->format, i = 0; *p != '\0' && i < rec->argc; p++)
+    {
+        if (*p != '%')
+            continue;
+
+        p++;
+        if (*p == '%')
+            continue;
+
+        while (*p == '-' || *p == '+' || *p == ' ' || *p == '#' || *p == '0')
+            p++;
+        if (*p == '*')
+        {
+            i++;
+            p++;
+        }
+        else
+        {
+            while (*p >= '0' && *p <= '9')
+                p++;
+        }
+        if (*p == '.')
+        {
+            p++;
+            if (*p == '*')
+            {
+                i++;
+                p++;
+            }
+            else
+            {
+                while (*p >= '0' && *p <= '9')
+                    p++;
+            }
+        }
+        while (*p == 'h' || *p == 'l' || *p == 'L')
+            p++;
+
+        if (*p == '\0' || i >= rec->argc)
+            break;
+
+        if (*p == 's')
+            argv[i] = (rt_ubase_t)((argv[i] < str_len) ? (str + argv[i]) : "");
+        i++;
+    }
+}
+
+/* 把日志格式化到批量缓冲区 */
+static void ulog_deferred_output(rt_uint32_t level, const char *tag, rt_bool_t newline, const char *format, ...)
+{
+    va_list args;
+    struct ulog_batch_item *item = &ulog.deferred.batch_items[ulog.deferred.batch_num];
+    char *log_buf = ulog.deferred.batch_buf + ulog.deferred.batch_used;
+
+    va_start(args, format);
+    item->len = ulog_format_line(log_buf, level, tag, newline, format, args);
+    va_end(args);
+
+    if (item->len == 0)
+        return;
+
+    item->level = level;
+    item->tag = tag;
+    item->is_raw = RT_FALSE;
+    item->log = log_buf;
+    ulog.deferred.batch_num++;
+    ulog.deferred.batch_used += item->len;
+}
+
+static void ulog_deferred_batch_flush(void)
+{
+    ulog_output_batch_to_all_backend(ulog.deferred.batch_items, ulog.deferred.batch_num);
+    ulog.deferred.batch_num = 0;
+    ulog.deferred.batch_used = 0;
+}
+
+/**
+ * 格式化并输出所有延后的日志, 只能在线程中调用
+ */
+void ulog_deferred_flush(void)
+{
+    struct ulog_deferred_rec *rec;
+    rt_ubase_t argv[ULOG_DEFERRED_ARG_MAX];
+    const char *str;
+
+    if (!ulog.init_ok || rt_interrupt_get_nest() != 0)
+        return;
+
+    if (!ulog_deferred_lock())
+        return;
+
+    ulog.deferred.cur_thread = rt_thread_self();
+
+    while ((rec = mpsc_ring_peek(&ulog.deferred.ring, RT_NULL)) != RT_NULL)
+    {
+        rt_memset(argv, 0, sizeof(argv));
+        rt_memcpy(argv, rec + 1, rec->argc * sizeof(rt_ubase_t));
+        str = (const char *)(rec + 1) + rec->argc * sizeof(rt_ubase_t);
+
+        ulog_deferred_unpack(rec, argv, str, ULOG_DEFERRED_STR_MAX);
+
+        /* 批量缓冲区放不下一行时先输出 */
+        if (ulog.deferred.batch_num >= ULOG_BATCH_NUM
+                || ULOG_BATCH_BUFSZ - ulog.deferred.batch_used < ULOG_LINE_BUF_SIZE + 1)
+            ulog_deferred_batch_flush();
+
+        ulog.deferred.cur = rec;
+        ulog_deferred_output(rec->level, rec->tag, rec->newline, rec->format,
+                             argv[0], argv[1], argv[2], argv[3], argv[4], argv[5], argv[6], argv[7]);
+        ulog.deferred.cur = RT_NULL;
+
+        mpsc_ring_release(&ulog.deferred.ring);
+        ulog.deferred.output_cnt++;
+
+#ifdef ULOG_USING_ASYNC_OUTPUT
+        rt_event_send(&ulog.async.event, ULOG_ASYNC_EVENT_SPACE);
+#endif
+    }
+
+    ulog_deferred_batch_flush();
+    ulog_deferred_unlock();
+}
+
+static rt_size_t ulog_capture_format_line(char *log_buf, rt_uint32_t level, const char *tag, rt_bool_t newline,
+        const char *format, ...)
+{
+    va_list args;
+    rt_size_t log_len;
+
+    va_start(args, format);
+    log_len = ulog_format_line(log_buf, level, tag, newline, format, args);
+    va_end(args);
+
+    return log_len;
+}
+
+/**
+ * 格式化 capture 后端保存的原始记录, 只能在线程中调用.
+ * 记录中的格式串和标签是指针, 复位后要由后端确认固件没有变化.
+ *
+ * @param log_buf the buffer must has ULOG_LINE_BUF_SIZE + 1 bytes
+ * @param rec 记录, 后面跟着参数和字符串区
+ * @param size 记录总长度
+ *
+ * @return >0: 日志长度
+ *          0: 记录不完整或被关键字过滤
+ *  -RT_EBUSY: 正在输出延后日志, 稍后再试
+ */
+int ulog_capture_format(char *log_buf, const struct ulog_deferred_rec *rec, rt_size_t size)
+{
+    rt_ubase_t argv[ULOG_DEFERRED_ARG_MAX];
+    rt_size_t hdr_size, str_len;
+    const char *str;
+    int log_len;
+
+    if (size < sizeof(struct ulog_deferred_rec) || rec->argc > ULOG_DEFERRED_ARG_MAX || rec->level > LOG_LVL_DBG)
+        return 0;
 
-        log_buf[log_len] = '[';
-        tick_len = ulog_ultoa(log_buf + log_len + 1, rt_tick_get());
-        log_buf[log_len + 1 + tick_len] = ']';
-        log_buf[log_len + 1 + tick_len + 1] = '\0';
-#endif /* ULOG_TIME_USING_TIMESTAMP */
+    hdr_size = sizeof(struct ulog_deferred_rec) + rec->argc * sizeof(rt_ubase_t);
+    if (size < hdr_size)
+        return 0;
 
-        log_len += rt_strlen(log_buf + log_len);
-    }
-#endif /* ULOG_OUTPUT_TIME */
+    str = (const char *)rec + hdr_size;
+    str_len = size - hdr_size;
+    if (str_len > 0 && str[str_len - 1] != '\0')
+        return 0;
 
-#ifdef ULOG_OUTPUT_LEVEL
+    if (!ulog.init_ok || rt_interrupt_get_nest() != 0)
+        return -RT_EBUSY;
 
-#ifdef ULOG_OUTPUT_TIME
-    log_len += ulog_strcpy(log_len, log_buf + log_len, " ");
-#endif
+    if (!ulog_deferred_lock())
+        return -RT_EBUSY;
 
-    /* add level info */
-    log_len += ulog_strcpy(log_len, log_buf + log_len, level_output_info[level]);
-#endif /* ULOG_OUTPUT_LEVEL */
+    rt_memset(argv, 0, sizeof(argv));
+    rt_memcpy(argv, rec + 1, rec->argc * sizeof(rt_ubase_t));
+    ulog_deferred_unpack(rec, argv, str, str_len);
 
-#ifdef ULOG_OUTPUT_TAG
+    /* 使用记录中的时间 */
+    ulog.deferred.cur_thread = rt_thread_self();
+    ulog.deferred.cur = (struct ulog_deferred_rec *)rec;
+    log_len = ulog_capture_format_line(log_buf, rec->level, rec->tag, rec->newline, rec->format,
+                                       argv[0], argv[1], argv[2], argv[3], argv[4], argv[5], argv[6], argv[7]);
+    ulog.deferred.cur = RT_NULL;
 
-#if !defined(ULOG_OUTPUT_LEVEL) && defined(ULOG_OUTPUT_TIME)
-    log_len += ulog_strcpy(log_len, log_buf + log_len, " ");
-#endif
+    ulog_deferred_unlock();
 
-    /* add tag info */
-    log_len += ulog_strcpy(log_len, log_buf + log_len, tag);
-#endif /* ULOG_OUTPUT_TAG */
+    return log_len;
+}
 
-#ifdef ULOG_OUTPUT_THREAD_NAME
-    /* add thread info */
-    {
+#ifdef ULOG_USING_ASYNC_OUTPUT
+/**
+ * set the policy when the async log queue is full
+ *
+ * @param level log level
+ * @param policy ULOG_ASYNC_POLICY_DROP, ULOG_ASYNC_POLICY_OVERWRITE or ULOG_ASYNC_POLICY_BLOCK
+ *
+ * @return RT_EOK: success, -RT_EINVAL: level or policy is out of range
+ */
+int ulog_async_policy_set(rt_uint32_t level, rt_uint32_t policy)
+{
+    if (level > LOG_LVL_DBG || policy > ULOG_ASYNC_POLICY_BLOCK)
+        return -RT_EINVAL;
 
-#if defined(ULOG_OUTPUT_TIME) || defined(ULOG_OUTPUT_LEVEL) || defined(ULOG_OUTPUT_TAG)
-        log_len += ulog_strcpy(log_len, log_buf + log_len, " ");
-#endif
+    ulog.async.policy[level] = policy;
 
-        /* is not in interrupt context */
-        if (rt_interrupt_get_nest() == 0)
-        {
-            rt_size_t name_len = rt_strnlen(rt_thread_self()->name, RT_NAME_MAX);
+    return RT_EOK;
+}
 
-            rt_strncpy(log_buf + log_len, rt_thread_self()->name, name_len);
-            log_len += name_len;
-        }
-        else
-        {
-            log_len += ulog_strcpy(log_len, log_buf + log_len, "ISR");
-        }
+static void ulog_async_output_entry(void *parameter)
+{
+    while (1)
+    {
+        rt_event_recv(&ulog.async.event, ULOG_ASYNC_EVENT_OUTPUT, RT_EVENT_FLAG_OR | RT_EVENT_FLAG_CLEAR,
+                      RT_WAITING_FOREVER, RT_NULL);
+        ulog_deferred_flush();
     }
-#endif /* ULOG_OUTPUT_THREAD_NAME */
+}
+#else
+static struct main_hook_module ulog_main_hook_module = {0};
+#endif /* ULOG_USING_ASYNC_OUTPUT */
+#endif /* ULOG_USING_DEFERRED */
 
-    log_len += ulog_strcpy(log_len, log_buf + log_len, ": ");
+/* the log has passed all filters */
+static void ulog_voutput_pass(rt_uint32_t level, const char *tag, rt_bool_t newline, const char *format, va_list args)
+{
+#ifdef ULOG_USING_DEFERRED
+    /* 断言日志之后马上死循环, 直接输出 */
+    if (level != LOG_LVL_ASSERT && ulog_deferred_capture(level, tag, newline, format, args))
+        return;
 
-#ifdef ULOG_OUTPUT_FLOAT
-    fmt_result = vsnprintf(log_buf + log_len, ULOG_LINE_BUF_SIZE - log_len, format, args);
-#else
-    fmt_result = rt_vsnprintf(log_buf + log_len, ULOG_LINE_BUF_SIZE - log_len, format, args);
-#endif /* ULOG_OUTPUT_FLOAT */
+    /* 直接输出前先输出之前延后的日志, 保持顺序 */
+    ulog_deferred_flush();
+#endif
 
-    /* calculate log length */
-    if ((log_len + fmt_result <= ULOG_LINE_BUF_SIZE) && (fmt_result > -1))
-    {
-        log_len += fmt_result;
-    }
-    else
-    {
-        /* using max length */
-        log_len = ULOG_LINE_BUF_SIZE;
-    }
+    ulog_voutput_format(level, tag, newline, format, args);
+}
 
-    /* overflow check and reserve some space for CSI end sign and newline sign */
-#ifdef ULOG_USING_COLOR
-    if (log_len + (sizeof(CSI_END) - 1) + newline_len > ULOG_LINE_BUF_SIZE)
+#ifdef ULOG_USING_FILTER
+static rt_bool_t ulog_filter_pass(rt_uint32_t level, rt_uint32_t global_lvl, rt_uint32_t tag_lvl, rt_bool_t tag_match)
+{
+    /* level filter */
+#ifndef ULOG_USING_SYSLOG
+    if (level > global_lvl || level > tag_lvl)
     {
-        /* using max length */
-        log_len = ULOG_LINE_BUF_SIZE;
-        /* reserve some space for CSI end sign */
-        log_len -= (sizeof(CSI_END) - 1);
+        return RT_FALSE;
+    }
 #else
-    if (log_len + newline_len > ULOG_LINE_BUF_SIZE)
+    if (((LOG_MASK(LOG_PRI(level)) & global_lvl) == 0)
+            || ((LOG_MASK(LOG_PRI(level)) & tag_lvl) == 0))
     {
-        /* using max length */
-        log_len = ULOG_LINE_BUF_SIZE;
-#endif /* ULOG_USING_COLOR */
-        /* reserve some space for newline sign */
-        log_len -= newline_len;
+        return RT_FALSE;
     }
+#endif /* ULOG_USING_SYSLOG */
 
-    /* package newline sign */
-    if (newline)
-    {
-        log_len += ulog_strcpy(log_len, log_buf + log_len, ULOG_NEWLINE_SIGN);
-    }
+    /* tag filter */
+    return tag_match;
+}
 
-#ifdef ULOG_USING_COLOR
-    /* add CSI end sign  */
-    if (color_output_info[level])
+/* 过滤设置变化时刷新所有已登记标签的过滤结果 */
+static void ulog_tag_cache_update(void)
+{
+    int i;
+
+    for (i = 0; i < ULOG_TAG_NUM; i++)
     {
-        log_len += ulog_strcpy(log_len, log_buf + log_len, CSI_END);
-    }
-#endif /* ULOG_USING_COLOR */
+        if (ulog.tags[i].name == RT_NULL)
+            break;
 
-    return log_len;
+        ulog.tags[i].level = ulog_tag_lvl_filter_get(ulog.tags[i].name);
+        ulog.tags[i].match = (rt_strstr(ulog.tags[i].name, ulog.filter.tag) != RT_NULL);
+    }
 }
 
-static void ulog_output_to_all_backend(rt_uint32_t level, const char *tag, rt_bool_t is_raw, char *log, rt_size_t size)
+/**
+ * 登记标签, 每个调用点只在第一次输出时执行
+ *
+ * @return 1 ~ ULOG_TAG_NUM: 标签 id
+ *         ULOG_TAG_ID_NONE: 标签表已满
+ */
+static rt_uint8_t ulog_tag_intern(const char *tag)
 {
-    rt_slist_t *node;
-    ulog_backend_t backend;
+    rt_base_t level;
+    rt_uint8_t id = ULOG_TAG_ID_NONE;
+    int i;
 
-    if (!ulog.init_ok)
-        return;
+    level = rt_hw_interrupt_disable();
 
-    /* output for all backends */
-    for (node = rt_slist_first(&ulog.backend_list); node; node = rt_slist_next(node))
+    for (i = 0; i < ULOG_TAG_NUM; i++)
     {
-        backend = rt_slist_entry(node, struct ulog_backend, list);
-#if !defined(ULOG_USING_COLOR) || defined(ULOG_USING_SYSLOG)
-        backend->output(backend, level, tag, is_raw, log, size);
-#else
-        if (backend->support_color || is_raw)
+        if (ulog.tags[i].name == RT_NULL)
         {
-            backend->output(backend, level, tag, is_raw, log, size);
+            ulog.tags[i].name = tag;
+            ulog.tags[i].level = ulog_tag_lvl_filter_get(tag);
+            ulog.tags[i].match = (rt_strstr(tag, ulog.filter.tag) != RT_NULL);
+            id = i + 1;
+            break;
         }
-        else
-        {
-            /* recalculate the log start address and log size when backend not supported color */
-            rt_size_t color_info_len = rt_strlen(color_output_info[level]), output_size = size;
-            if (color_info_len)
-            {
-                rt_size_t color_hdr_len = rt_strlen(CSI_START) + color_info_len;
 
-                log += color_hdr_len;
-                output_size -= (color_hdr_len + (sizeof(CSI_END) - 1));
-            }
-            backend->output(backend, level, tag, is_raw, log, output_size);
+        if (ulog.tags[i].name == tag || !rt_strcmp(ulog.tags[i].name, tag))
+        {
+            id = i + 1;
+            break;
         }
-#endif /* !defined(ULOG_USING_COLOR) || defined(ULOG_USING_SYSLOG) */
     }
-}
 
-static void do_output(rt_uint32_t level, const char *tag, rt_bool_t is_raw, char *log_buf, rt_size_t log_len)
-{
-    /* is in thread context */
-    if (rt_interrupt_get_nest() == 0)
-    {
-        /* output to all backends */
-        ulog_output_to_all_backend(level, tag, is_raw, log_buf, log_len);
-    }
-    else
-    {
-#ifdef ULOG_BACKEND_USING_CONSOLE
-        /* We can't ensure that all backends support ISR context output.
-         * So only using rt_kprintf when context is ISR */
-        extern void ulog_console_backend_output(struct ulog_backend *backend, rt_uint32_t level, const char *tag,
-                                                rt_bool_t is_raw, char *log, size_t len);
-        ulog_console_backend_output(NULL, level, tag, is_raw, log_buf, log_len);
-#endif /* ULOG_BACKEND_USING_CONSOLE */
-    }
+    rt_hw_interrupt_enable(level);
+
+    return id;
 }
+#endif /* ULOG_USING_FILTER */
 
 /**
  * output the log by variable argument list
@@ -387,9 +1450,6 @@ static void do_output(rt_uint32_t level, const char *tag, rt_bool_t is_raw, char
  */
 void ulog_voutput(rt_uint32_t level, const char *tag, rt_bool_t newline, const char *format, va_list args)
 {
-    char *log_buf = NULL;
-    rt_size_t log_len = 0;
-
 #ifndef ULOG_USING_SYSLOG
     RT_ASSERT(level <= LOG_LVL_DBG);
 #else
@@ -405,59 +1465,66 @@ void ulog_voutput(rt_uint32_t level, const char *tag, rt_bool_t newline, const c
     }
 
 #ifdef ULOG_USING_FILTER
-    /* level filter */
-#ifndef ULOG_USING_SYSLOG
-    if (level > ulog.filter.level || level > ulog_tag_lvl_filter_get(tag))
+    if (!ulog_filter_pass(level, ulog.filter.level, ulog_tag_lvl_filter_get(tag), rt_strstr(tag, ulog.filter.tag) != RT_NULL))
     {
         return;
     }
-#else
-    if (((LOG_MASK(LOG_PRI(level)) & ulog.filter.level) == 0)
-            || ((LOG_MASK(LOG_PRI(level)) & ulog_tag_lvl_filter_get(tag)) == 0))
+#endif /* ULOG_USING_FILTER */
+
+    ulog_voutput_pass(level, tag, newline, format, args);
+}
+
+#ifdef ULOG_USING_FILTER
+/**
+ * output the log with the interned tag id of the call site, used by LOG_X API
+ *
+ * @param tag_id tag id of the call site, 0 when not interned
+ * @param level level
+ * @param tag tag
+ * @param newline has newline
+ * @param format output format
+ * @param ... args
+ */
+void ulog_output_id(rt_uint8_t *tag_id, rt_uint32_t level, const char *tag, rt_bool_t newline, const char *format, ...)
+{
+    va_list args;
+    rt_uint8_t id;
+
+    RT_ASSERT(tag_id);
+    RT_ASSERT(tag);
+    RT_ASSERT(format);
+
+    if (!ulog.init_ok)
     {
         return;
     }
-#endif /* ULOG_USING_SYSLOG */
-    else if (!rt_strstr(tag, ulog.filter.tag))
+
+    id = *tag_id;
+    if (id == 0)
     {
-        /* tag filter */
-        return;
+        id = ulog_tag_intern(tag);
+        *tag_id = id;
     }
-#endif /* ULOG_USING_FILTER */
-
-    rt_rbb_blk_t block = get_log_blk();
-    if(block == RT_NULL)
-        return;
-
-    /* get log buffer */
-    log_buf = (char *)block->buf;
-
-#ifndef ULOG_USING_SYSLOG
-    log_len = ulog_formater(log_buf, level, tag, newline, format, args);
-#else
-    extern rt_size_t syslog_formater(char *log_buf, rt_uint8_t level, const char *tag, rt_bool_t newline, const char *format, va_list args);
-    log_len = syslog_formater(log_buf, level, tag, newline, format, args);
-#endif /* ULOG_USING_SYSLOG */
 
-#ifdef ULOG_USING_FILTER
-    /* keyword filter */
-    if (ulog.filter.keyword[0] != '\0')
+    if (id == ULOG_TAG_ID_NONE)
     {
-        /* add string end sign */
-        log_buf[log_len] = '\0';
-        /* find the keyword */
-        if (!rt_strstr(log_buf, ulog.filter.keyword))
-        {
-            rt_rbb_blk_free(&ulog.log_rbb, block);
+        /* 标签表已满, 退回字符串匹配 */
+        if (!ulog_filter_pass(level, ulog.filter.level, ulog_tag_lvl_filter_get(tag), rt_strstr(tag, ulog.filter.tag) != RT_NULL))
             return;
-        }
     }
-#endif /* ULOG_USING_FILTER */
-    /* do log output */
-    do_output(level, tag, RT_FALSE, log_buf, log_len);
+    else
+    {
+        struct ulog_tag *t = &ulog.tags[id - 1];
 
-    rt_rbb_blk_free(&ulog.log_rbb, block);
+        if (!ulog_filter_pass(level, ulog.filter.level, t->level, t->match))
+            return;
+    }
+
+    va_start(args, format);
+    ulog_voutput_pass(level, tag, newline, format, args);
+    va_end(args);
 }
+#endif /* ULOG_USING_FILTER */
 
 /**
  * output the log
@@ -498,6 +1565,11 @@ void ulog_raw(const char *format, ...)
         return;
     }
 
+#ifdef ULOG_USING_DEFERRED
+    /* 先输出延后的日志, 保持顺序 */
+    ulog_deferred_flush();
+#endif
+
     rt_rbb_blk_t block = get_log_blk();
     if(block == RT_NULL)
         return;
@@ -574,6 +1646,10 @@ void ulog_hexdump(const char *tag, rt_size_t width, rt_uint8_t *buf, rt_size_t s
     }
 #endif /* ULOG_USING_FILTER */
 
+#ifdef ULOG_USING_DEFERRED
+    ulog_deferred_flush();
+#endif
+
     rt_rbb_blk_t block = get_log_blk();
     if(block == RT_NULL)
         return;
@@ -740,6 +1816,8 @@ int ulog_tag_lvl_filter_set(const char *tag, rt_uint32_t level)
         }
     }
 
+    ulog_tag_cache_update();
+
     return result;
 }
 
@@ -813,6 +1891,7 @@ void ulog_global_filter_tag_set(const char *tag)
         return;
 
     rt_strncpy(ulog.filter.tag, tag, ULOG_FILTER_TAG_MAX_LEN);
+    ulog_tag_cache_update();
 }
 
 /**
@@ -1019,6 +2098,47 @@ MSH_CMD_EXPORT(ulog_filter, Show ulog filter settings);
 #endif /* defined(RT_USING_FINSH) && defined(FINSH_USING_MSH) */
 #endif /* ULOG_USING_FILTER */
 
+#if defined(ULOG_USING_DEFERRED) && defined(RT_USING_FINSH) && defined(FINSH_USING_MSH)
+static void ulog_deferred(uint8_t argc, char **argv)
+{
+    const char *lvl_name[] = { "Assert ", RT_NULL, RT_NULL, "Error  ", "Warning", RT_NULL, "Info   ", "Debug  " };
+#ifdef ULOG_USING_ASYNC_OUTPUT
+    const char *policy_name[] = { "drop", "overwrite", "block" };
+#endif
+    int i;
+
+#ifdef ULOG_USING_ASYNC_OUTPUT
+    if (argc > 2)
+    {
+        if (ulog_async_policy_set(atoi(argv[1]), atoi(argv[2])) != RT_EOK)
+            rt_kprintf("Please input: ulog_deferred <level> <0:drop | 1:overwrite | 2:block>.\n");
+        return;
+    }
+#endif
+
+    rt_kprintf("output   : %u\n", ulog.deferred.output_cnt);
+    rt_kprintf("reserve fail : %u\n", ulog.deferred.ring.drop_cnt);
+    rt_kprintf("pending  : %u/%u bytes\n", mpsc_ring_data_len(&ulog.deferred.ring), ULOG_DEFERRED_BUFSZ);
+#ifdef ULOG_USING_ASYNC_OUTPUT
+    rt_kprintf("overwrite: %u\n", ulog.async.overwrite_cnt);
+    rt_kprintf("block    : %u\n", ulog.async.block_cnt);
+#endif
+
+    for (i = 0; i <= LOG_LVL_DBG; i++)
+    {
+        if (lvl_name[i] == RT_NULL)
+            continue;
+
+#ifdef ULOG_USING_ASYNC_OUTPUT
+        rt_kprintf("%s: dropped %u, %s\n", lvl_name[i], ulog.deferred.drop_cnt[i], policy_name[ulog.async.policy[i]]);
+#else
+        rt_kprintf("%s: dropped %u\n", lvl_name[i], ulog.deferred.drop_cnt[i]);
+#endif
+    }
+}
+MSH_CMD_EXPORT(ulog_deferred, Show ulog deferred log statistics or set async policy);
+#endif /* defined(ULOG_USING_DEFERRED) && defined(RT_USING_FINSH) && defined(FINSH_USING_MSH) */
+
 rt_err_t ulog_backend_register(ulog_backend_t backend, const char *name, rt_bool_t support_color)
 {
     rt_base_t level;
@@ -1043,6 +2163,13 @@ rt_err_t ulog_backend_register(ulog_backend_t backend, const char *name, rt_bool
 
     level = rt_hw_interrupt_disable();
     rt_slist_append(&ulog.backend_list, &backend->list);
+#ifdef ULOG_USING_DEFERRED
+    if (backend->capture && (!ulog.deferred.capture_used || backend->capture_lvl > ulog.deferred.capture_lvl))
+    {
+        ulog.deferred.capture_lvl = backend->capture_lvl;
+        ulog.deferred.capture_used = 1;
+    }
+#endif
     rt_hw_interrupt_enable(level);
 
     return RT_EOK;
@@ -1059,6 +2186,10 @@ void ulog_flush(void)
     if (!ulog.init_ok)
         return;
 
+#ifdef ULOG_USING_DEFERRED
+    ulog_deferred_flush();
+#endif
+
     /* flush all backends */
     for (node = rt_slist_first(&ulog.backend_list); node; node = rt_slist_next(node))
     {
@@ -1080,6 +2211,42 @@ int ulog_init(void)
     rt_slist_init(&ulog.backend_list);
     rt_rbb_init(&ulog.log_rbb, ulog.log_rbb_buf, ULOG_RBB_BUFSZ, ulog.log_rbb_blk, ULOG_RBB_BLKNUM);
 
+#ifdef ULOG_USING_COLOR
+    {
+        rt_uint32_t level;
+
+        for (level = 0; level <= LOG_LVL_DBG; level++)
+        {
+            ulog.hdr.color_len[level] = color_output_info[level] ? rt_strlen(color_output_info[level]) : 0;
+        }
+    }
+#endif /* ULOG_USING_COLOR */
+
+#ifdef ULOG_USING_DEFERRED
+    mpsc_ring_init(&ulog.deferred.ring, (rt_uint8_t *)ulog.deferred.ring_buf, ULOG_DEFERRED_BUFSZ);
+#ifdef ULOG_USING_ASYNC_OUTPUT
+    ulog.async.policy[LOG_LVL_ASSERT] = ULOG_ASYNC_POLICY_BLOCK;
+    ulog.async.policy[LOG_LVL_ERROR] = ULOG_ASYNC_POLICY_ERROR;
+    ulog.async.policy[LOG_LVL_WARNING] = ULOG_ASYNC_POLICY_WARNING;
+    ulog.async.policy[LOG_LVL_INFO] = ULOG_ASYNC_POLICY_INFO;
+    ulog.async.policy[LOG_LVL_DBG] = ULOG_ASYNC_POLICY_DEBUG;
+
+    rt_event_init(&ulog.async.event, "ulog", RT_IPC_FLAG_FIFO);
+    rt_thread_init(&ulog.async.thread,
+                   "ulog",
+                   ulog_async_output_entry,
+                   RT_NULL,
+                   &ulog.async.thread_stack[0],
+                   sizeof(ulog.async.thread_stack),
+                   ULOG_ASYNC_OUTPUT_THREAD_PRIORITY,
+                   100);
+    rt_thread_startup(&ulog.async.thread);
+#else
+    ulog_main_hook_module.hook = ulog_deferred_flush;
+    main_hook_module_register(&ulog_main_hook_module);
+#endif /* ULOG_USING_ASYNC_OUTPUT */
+#endif /* ULOG_USING_DEFERRED */
+
 #ifdef ULOG_USING_FILTER
     ulog_global_filter_lvl_set(LOG_FILTER_LVL_ALL);
 #endif
@@ -70,6 +70,25 @@ const char *ulog_global_filter_kw_get(void);
  */
 void ulog_flush(void);
 
+#ifdef ULOG_USING_DEFERRED
+/*
+ * format and output all deferred log, only in thread context
+ */
+void ulog_deferred_flush(void);
+
+/*
+ * format the raw record passed to the capture of backend, only in thread context
+ */
+int ulog_capture_format(char *log_buf, const struct ulog_deferred_rec *rec, rt_size_t size);
+#endif /* ULOG_USING_DEFERRED */
+
+#ifdef ULOG_USING_ASYNC_OUTPUT
+/*
+ * set the policy when the async log queue is full
+ */
+int ulog_async_policy_set(rt_uint32_t level, rt_uint32_t policy);
+#endif /* ULOG_USING_ASYNC_OUTPUT */
+
 /*
  * dump the hex format data to log
  */
@@ -81,6 +100,9 @@ void ulog_hexdump(const char *tag, rt_size_t width, rt_uint8_t *buf, rt_size_t s
 void ulog_voutput(rt_uint32_t level, const char *tag, rt_bool_t newline, const char *format, va_list args);
 void ulog_output(rt_uint32_t level, const char *tag, rt_bool_t newline, const char *format, ...);
 void ulog_raw(const char *format, ...);
+#ifdef ULOG_USING_FILTER
+void ulog_output_id(rt_uint8_t *tag_id, rt_uint32_t level, const char *tag, rt_bool_t newline, const char *format, ...);
+#endif
 
 #ifdef __cplusplus
 }
@@ -74,26 +74,41 @@ extern "C" {
     #endif
 #endif /* !defined(LOG_LVL) */
 
+/*
+ * LOG_X API: the level check above is done at compile time, so the suppressed log is removed.
+ * With runtime filter, every call site interns its tag once and then filters by tag id.
+ */
+#ifdef ULOG_USING_FILTER
+    #define ulog_output_tag(level, TAG, ...)                              \
+    do                                                                    \
+    {                                                                     \
+        static rt_uint8_t __ulog_tag_id = 0;                              \
+        ulog_output_id(&__ulog_tag_id, level, TAG, RT_TRUE, __VA_ARGS__); \
+    } while (0)
+#else
+    #define ulog_output_tag(level, TAG, ...)  ulog_output(level, TAG, RT_TRUE, __VA_ARGS__)
+#endif /* ULOG_USING_FILTER */
+
 #if (LOG_LVL >= LOG_LVL_DBG) && (ULOG_OUTPUT_LVL >= LOG_LVL_DBG)
-    #define ulog_d(TAG, ...)           ulog_output(LOG_LVL_DBG, TAG, RT_TRUE, __VA_ARGS__)
+    #define ulog_d(TAG, ...)           ulog_output_tag(LOG_LVL_DBG, TAG, __VA_ARGS__)
 #else
     #define ulog_d(TAG, ...)
 #endif /* (LOG_LVL >= LOG_LVL_DBG) && (ULOG_OUTPUT_LVL >= LOG_LVL_DBG) */
 
 #if (LOG_LVL >= LOG_LVL_INFO) && (ULOG_OUTPUT_LVL >= LOG_LVL_INFO)
-    #define ulog_i(TAG, ...)           ulog_output(LOG_LVL_INFO, TAG, RT_TRUE, __VA_ARGS__)
+    #define ulog_i(TAG, ...)           ulog_output_tag(LOG_LVL_INFO, TAG, __VA_ARGS__)
 #else
     #define ulog_i(TAG, ...)
 #endif /* (LOG_LVL >= LOG_LVL_INFO) && (ULOG_OUTPUT_LVL >= LOG_LVL_INFO) */
 
 #if (LOG_LVL >= LOG_LVL_WARNING) && (ULOG_OUTPUT_LVL >= LOG_LVL_WARNING)
-    #define ulog_w(TAG, ...)           ulog_output(LOG_LVL_WARNING, TAG, RT_TRUE, __VA_ARGS__)
+    #define ulog_w(TAG, ...)           ulog_output_tag(LOG_LVL_WARNING, TAG, __VA_ARGS__)
 #else
     #define ulog_w(TAG, ...)
 #endif /* (LOG_LVL >= LOG_LVL_WARNING) && (ULOG_OUTPUT_LVL >= LOG_LVL_WARNING) */
 
 #if (LOG_LVL >= LOG_LVL_ERROR) && (ULOG_OUTPUT_LVL >= LOG_LVL_ERROR)
-    #define ulog_e(TAG, ...)           ulog_output(LOG_LVL_ERROR, TAG, RT_TRUE, __VA_ARGS__)
+    #define ulog_e(TAG, ...)           ulog_output_tag(LOG_LVL_ERROR, TAG, __VA_ARGS__)
 #else
     #define ulog_e(TAG, ...)
 #endif /* (LOG_LVL >= LOG_LVL_ERROR) && (ULOG_OUTPUT_LVL >= LOG_LVL_ERROR) */
@@ -160,6 +175,65 @@ extern "C" {
 #define ULOG_RBB_BUFSZ                 4096
 #endif
 
+#ifdef ULOG_USING_DEFERRED
+/* buffer size for deferred log records, must be power of 2 */
+#ifndef ULOG_DEFERRED_BUFSZ
+#define ULOG_DEFERRED_BUFSZ            2048
+#endif
+
+/* string arguments buffer size for every deferred log */
+#ifndef ULOG_DEFERRED_STR_MAX
+#define ULOG_DEFERRED_STR_MAX          64
+#endif
+
+/* buffer size for batch output */
+#ifndef ULOG_BATCH_BUFSZ
+#define ULOG_BATCH_BUFSZ               1024
+#endif
+
+/* max log num for batch output */
+#ifndef ULOG_BATCH_NUM
+#define ULOG_BATCH_NUM                 16
+#endif
+#endif /* ULOG_USING_DEFERRED */
+
+#ifdef ULOG_USING_ASYNC_OUTPUT
+#ifndef ULOG_USING_DEFERRED
+#error "async output depends on ULOG_USING_DEFERRED"
+#endif
+
+/* the policy when the async log queue is full */
+#define ULOG_ASYNC_POLICY_DROP         0
+#define ULOG_ASYNC_POLICY_OVERWRITE    1
+#define ULOG_ASYNC_POLICY_BLOCK        2
+
+#ifndef ULOG_ASYNC_OUTPUT_THREAD_STACK
+#define ULOG_ASYNC_OUTPUT_THREAD_STACK 1024
+#endif
+
+#ifndef ULOG_ASYNC_OUTPUT_THREAD_PRIORITY
+#define ULOG_ASYNC_OUTPUT_THREAD_PRIORITY (RT_THREAD_PRIORITY_MAX - 2)
+#endif
+
+/* max block time (ms) of the block policy */
+#ifndef ULOG_ASYNC_BLOCK_TIMEOUT
+#define ULOG_ASYNC_BLOCK_TIMEOUT       100
+#endif
+
+#ifndef ULOG_ASYNC_POLICY_ERROR
+#define ULOG_ASYNC_POLICY_ERROR        ULOG_ASYNC_POLICY_BLOCK
+#endif
+#ifndef ULOG_ASYNC_POLICY_WARNING
+#define ULOG_ASYNC_POLICY_WARNING      ULOG_ASYNC_POLICY_OVERWRITE
+#endif
+#ifndef ULOG_ASYNC_POLICY_INFO
+#define ULOG_ASYNC_POLICY_INFO         ULOG_ASYNC_POLICY_DROP
+#endif
+#ifndef ULOG_ASYNC_POLICY_DEBUG
+#define ULOG_ASYNC_POLICY_DEBUG        ULOG_ASYNC_POLICY_DROP
+#endif
+#endif /* ULOG_USING_ASYNC_OUTPUT */
+
 /* buffer size for every line's log */
 #ifndef ULOG_LINE_BUF_SIZE
 #define ULOG_LINE_BUF_SIZE             128
@@ -180,6 +254,11 @@ extern "C" {
 #define ULOG_FILTER_NUM                10
 #endif
 
+/* max num of interned tags */
+#ifndef ULOG_TAG_NUM
+#define ULOG_TAG_NUM                   16
+#endif
+
 #ifndef ULOG_NEWLINE_SIGN
 #define ULOG_NEWLINE_SIGN              "\r\n"
 #endif
@@ -193,12 +272,55 @@ struct ulog_tag_lvl_filter
 };
 typedef struct ulog_tag_lvl_filter *ulog_tag_lvl_filter_t;
 
+/* one log of the batch output */
+struct ulog_batch_item
+{
+    rt_uint32_t level;
+    const char *tag;
+    rt_bool_t is_raw;
+    char *log;
+    rt_size_t len;
+};
+
+#ifdef ULOG_USING_DEFERRED
+/**
+ * 延后格式化日志记录, 后面依次跟着:
+ * rt_ubase_t args[argc]: 原始参数, %s 参数保存为字符串区偏移
+ * char str[]: %s 参数的字符串拷贝
+ */
+struct ulog_deferred_rec
+{
+    const char *format;
+    const char *tag;
+    rt_tick_t tick;
+#ifdef ULOG_OUTPUT_THREAD_NAME
+    /* RT_NULL 表示在中断中 */
+    const char *thread;
+#endif
+    rt_uint8_t level;
+    rt_uint8_t newline;
+    rt_uint8_t argc;
+    rt_uint8_t reserved;
+};
+#endif /* ULOG_USING_DEFERRED */
+
 struct ulog_backend
 {
     char name[RT_NAME_MAX];
     rt_bool_t support_color;
     void (*init)  (struct ulog_backend *backend);
     void (*output)(struct ulog_backend *backend, rt_uint32_t level, const char *tag, rt_bool_t is_raw, char *log, size_t len);
+    /* optional, output many logs once. The logs of a batch are usually contiguous in memory */
+    void (*output_batch)(struct ulog_backend *backend, const struct ulog_batch_item *items, rt_size_t num);
+#ifdef ULOG_USING_DEFERRED
+    /* optional, when using deferred log, the raw record of the log which level <= capture_lvl is passed to
+     * capture when it is saved, without formatting. The backend keeps the record so that it is not lost on
+     * reset, and formats it later by ulog_capture_format. These logs are not output to the backend again
+     * after deferred formatting */
+    void (*capture)(struct ulog_backend *backend, const struct ulog_deferred_rec *rec, const rt_ubase_t *argv,
+                    const char *str, rt_size_t str_len);
+    rt_uint32_t capture_lvl;
+#endif
     void (*flush) (struct ulog_backend *backend);
     void (*deinit)(struct ulog_backend *backend);
     rt_slist_t list;
@@ -1,6 +1,7 @@
 #include "wifi.h"
 #include "drv_gpio.h"
 #include "drv_usart.h"
+#include "reactor.h"
 #include <string.h>
 #include <stdio.h>
 #include <rthw.h>
@@ -15,14 +16,17 @@
 #define WIFI_NET_TIMEOUT                300
 #define WIFI_SMART_TIMEOUT              180
 #define WIFI_SEND_MAX_SIZE              2048
+#define WIFI_SEND_TIMEOUT               5000
 
-#define WIFI_EVENT_SEND_OK              (1UL << 0)
-#define WIFI_EVENT_SEND_FAIL            (1UL << 1)
+#define WIFI_EVENT_SEND_DONE            (1UL << 0)
+#define WIFI_EVENT_SESSION_READY        (1UL << 1)
 #define WIFI_EVENT_SMARTCONFIG_SUCCESS  (1UL << 2)
 #define WIFI_EVENT_SMARTCONFIG_FAILED   (1UL << 3)
 
+#define WIFI_WHEEL_SIZE                 8
+#define WIFI_WHEEL_TICK                 RT_TICK_PER_SECOND
 
-#define WIFI_SET_EVENT(socket, event)   ((1UL << (socket + 16)) | (event))
+#define WIFI_SESSION_BIT(session)       (1UL << ((session) - wifi_device.sessions))
 
 #define WIFI_AT_SEND_CMD(resp, resp_line, timeout, cmd)                                         \
         at_resp_set_info((resp), (resp_line), rt_tick_from_millisecond(timeout));    \
@@ -33,19 +37,45 @@
 
 ALIGN(RT_ALIGN_SIZE)
 /* 串口 */
-static rt_uint8_t usart_send_buf[AT_CMD_MAX_LEN * 3];
+static rt_uint8_t usart_send_buf[1024];
 static rt_uint8_t usart_read_buf[500];
 
 /* AT组件 */
 static rt_uint8_t at_recv_line_buf[WIFI_RECV_BUFF_LEN];
 static rt_uint8_t at_resp_buf[512];
 static struct at_response at_resp;
-static rt_uint8_t at_parser_stack[1536];
-static struct rt_thread at_parser;
+static struct reactor_source at_parser_source;
+/* 非阻塞解析不等待, 由定时器结束超时的 payload */
+static struct reactor_timer at_payload_timer;
+static wifi_queue_blk_t ipd_block = RT_NULL;
+static int ipd_link_id = -1;
+
+/* 接收块池, 所有会话共享 */
+ALIGN(RT_ALIGN_SIZE)
+static rt_uint8_t recv_pool_buf[WIFI_QUEUE_POOL_BUFSZ(WIFI_QUEUE_SMALL_SIZE, WIFI_RECV_SMALL_NUM,
+                                                     WIFI_QUEUE_LARGE_SIZE, WIFI_RECV_LARGE_NUM)];
+static struct wifi_queue_blk recv_pool_blk[WIFI_RECV_SMALL_NUM + WIFI_RECV_LARGE_NUM];
+static struct wifi_queue_pool recv_pool;
+
+/* 发送块池, 所有会话共享 */
+ALIGN(RT_ALIGN_SIZE)
+static rt_uint8_t send_pool_buf[WIFI_QUEUE_POOL_BUFSZ(WIFI_QUEUE_SMALL_SIZE, WIFI_SEND_SMALL_NUM,
+                                                     WIFI_QUEUE_LARGE_SIZE, WIFI_SEND_LARGE_NUM)];
+static struct wifi_queue_blk send_pool_blk[WIFI_SEND_SMALL_NUM + WIFI_SEND_LARGE_NUM];
+static struct wifi_queue_pool send_pool;
+/* 已发出 AT+CIPSEND 等待 SEND OK 的窗口 */
+static struct wifi_send_slot send_slots[WIFI_SEND_WINDOW];
+static rt_uint8_t send_slot_head = 0;
+static rt_uint8_t send_slot_num = 0;
+static int send_session_index = 0;
+
+/* 会话超时时间轮, 每格 1s */
+static rt_slist_t wifi_wheel[WIFI_WHEEL_SIZE];
+static rt_uint8_t wifi_wheel_index = 0;
+static rt_tick_t wifi_wheel_tick = 0;
 
 /* WIFI */
 static struct usr_device_wifi wifi_device = {0};
-static int cur_socket = -1;
 static rt_uint8_t wifi_thread_stack[2048];
 static struct rt_thread wifi_thread;
 
@@ -91,6 +121,95 @@ static struct wifi_session *wifi_session_get(int link_id)
     return session;
 }
 
+void wifi_session_ready(struct wifi_session *session)
+{
+    rt_base_t level = rt_hw_interrupt_disable();
+    wifi_device.ready_mask |= WIFI_SESSION_BIT(session);
+    rt_hw_interrupt_enable(level);
+
+    wifi_event_send(WIFI_EVENT_SESSION_READY);
+}
+
+/* 按剩余时间放入时间轮, 超出一圈的在到期检查时重新放入 */
+static void wifi_wheel_insert(struct wifi_session *session)
+{
+    rt_tick_t remain = session->timeout - wifi_wheel_tick;
+    if(remain >= (RT_TICK_MAX / 2))
+        remain = 0;
+
+    rt_uint32_t slots = (remain + WIFI_WHEEL_TICK - 1) / WIFI_WHEEL_TICK;
+    if(slots == 0)
+        slots = 1;
+    if(slots >= WIFI_WHEEL_SIZE)
+        slots = WIFI_WHEEL_SIZE - 1;
+
+    session->wheel_slot = (wifi_wheel_index + slots) % WIFI_WHEEL_SIZE;
+    rt_slist_insert(&wifi_wheel[session->wheel_slot], &(session->wheel_node));
+    session->wheel_on = 1;
+}
+
+static void wifi_wheel_remove(struct wifi_session *session)
+{
+    if(!session->wheel_on)
+        return;
+
+    rt_slist_remove(&wifi_wheel[session->wheel_slot], &(session->wheel_node));
+    session->wheel_on = 0;
+}
+
+/* 已在时间轮中时只更新超时时间, 到期检查时再移动 */
+static void wifi_session_refresh(struct wifi_session *session)
+{
+    rt_base_t level = rt_hw_interrupt_disable();
+
+    session->timeout = rt_tick_get() + rt_tick_from_millisecond(WIFI_CLIENT_TIMEOUT * 1000);
+    if(!session->wheel_on)
+        wifi_wheel_insert(session);
+
+    rt_hw_interrupt_enable(level);
+}
+
+/* 推进时间轮, 超时的会话置为就绪, 由 wifi_net_process 关闭 */
+static void wifi_wheel_process(void)
+{
+    rt_base_t level = rt_hw_interrupt_disable();
+
+    while((rt_tick_get() - (wifi_wheel_tick + WIFI_WHEEL_TICK)) < (RT_TICK_MAX / 2))
+    {
+        wifi_wheel_tick += WIFI_WHEEL_TICK;
+        wifi_wheel_index = (wifi_wheel_index + 1) % WIFI_WHEEL_SIZE;
+
+        rt_slist_t *slot = &wifi_wheel[wifi_wheel_index];
+        while(!rt_slist_isempty(slot))
+        {
+            struct wifi_session *session = rt_slist_first_entry(slot, struct wifi_session, wheel_node);
+            rt_slist_remove(slot, &(session->wheel_node));
+            session->wheel_on = 0;
+
+            if((rt_tick_get() - session->timeout) < (RT_TICK_MAX / 2))
+                wifi_device.ready_mask |= WIFI_SESSION_BIT(session);
+            else
+                wifi_wheel_insert(session);
+        }
+    }
+
+    rt_hw_interrupt_enable(level);
+}
+
+static void wifi_wheel_reset(void)
+{
+    rt_base_t level = rt_hw_interrupt_disable();
+
+    for (int i = 0; i < WIFI_WHEEL_SIZE; i++)
+        rt_slist_init(&wifi_wheel[i]);
+    for (int i = 0; i < WIFI_SERVER_MAX_CONN; i++)
+        wifi_device.sessions[i].wheel_on = 0;
+    wifi_wheel_index = 0;
+    wifi_wheel_tick = rt_tick_get();
+
+    rt_hw_interrupt_enable(level);
+}
+
 static void wifi_sessions_clean(struct wifi_session *session)
 {
     rt_base_t level = rt_hw_interrupt_disable();
@@ -101,41 +220,84 @@ static void wifi_sessions_clean(struct wifi_session *session)
         {
             wifi_device.sessions[i].link_id = -1;
             wifi_device.sessions[i].timeout = rt_tick_get();
+            wifi_wheel_remove(&(wifi_device.sessions[i]));
 
-            rt_rbb_blk_t block = RT_NULL;
-            do
-            {
-                block = rt_rbb_blk_get(&(wifi_device.sessions[i].recv_rbb));
-                if (block == RT_NULL)
-                    break;
-
-                rt_rbb_blk_free(&(wifi_device.sessions[i].recv_rbb), block);
-            } while (block != RT_NULL);
+            wifi_queue_clean(&recv_pool, &(wifi_device.sessions[i].recv_queue));
+            wifi_queue_clean(&send_pool, &(wifi_device.sessions[i].send_queue));
+            wifi_device.sessions[i].send_pending = 0;
+            wifi_device.sessions[i].gateway_pending = 0;
+            wifi_device.sessions[i].send_deficit = 0;
 
             wifi_device.sessions[i].state = WIFI_SESSION_STATE_CLOSED;
         }
+
+        wifi_device.active_mask = 0;
+        wifi_device.ready_mask = 0;
+        wifi_device.send_mask = 0;
     }
     else
     {
         session->link_id = -1;
         session->timeout = rt_tick_get();
+        wifi_wheel_remove(session);
 
-        rt_rbb_blk_t block = RT_NULL;
-        do
-        {
-            block = rt_rbb_blk_get(&(session->recv_rbb));
-            if(block == RT_NULL)
-                break;
-
-            rt_rbb_blk_free(&(session->recv_rbb), block);
-        }while(block != RT_NULL);
+        wifi_queue_clean(&recv_pool, &(session->recv_queue));
+        wifi_queue_clean(&send_pool, &(session->send_queue));
+        session->send_pending = 0;
+        session->gateway_pending = 0;
+        session->send_deficit = 0;
 
         session->state = WIFI_SESSION_STATE_CLOSED;
+        wifi_device.active_mask &= ~WIFI_SESSION_BIT(session);
+        wifi_device.ready_mask &= ~WIFI_SESSION_BIT(session);
+        wifi_device.send_mask &= ~WIFI_SESSION_BIT(session);
     }
     
     rt_hw_interrupt_enable(level);
 }
 
+/* 会话未发完的响应超出预算时不再处理它的请求, 避免单个主站占满 AT 链路 */
+static int wifi_session_over_budget(struct wifi_session *session)
+{
+    if((session->send_queue.count + session->send_pending + session->gateway_pending) >= WIFI_SESSION_INFLIGHT_MAX)
+        return 1;
+
+    if(session->send_queue.cap >= WIFI_SESSION_SEND_BUDGET)
+        return 1;
+
+    return 0;
+}
+
+static void wifi_session_open(struct wifi_session *session, int link_id)
+{
+    rt_base_t level = rt_hw_interrupt_disable();
+
+    wifi_sessions_clean(session);
+    session->link_id = link_id;
+    session->generation++;
+    session->state = WIFI_SESSION_STATE_CONNECTED;
+    wifi_device.active_mask |= WIFI_SESSION_BIT(session);
+    wifi_session_refresh(session);
+
+    rt_hw_interrupt_enable(level);
+}
+
+/* 等待发送窗口清空, 其他 AT 命令不能插入到 AT+CIPSEND 与 SEND OK 之间 */
+static int wifi_send_wait_idle(int timeout)
+{
+    rt_tick_t tick_timeout = rt_tick_get() + rt_tick_from_millisecond(timeout);
+
+    while(send_slot_num > 0)
+    {
+        if((rt_tick_get() - tick_timeout) < (RT_TICK_MAX / 2))
+            return -RT_ETIMEOUT;
+
+        wifi_event_recv(WIFI_EVENT_SEND_DONE, 100, RT_EVENT_FLAG_OR);
+    }
+
+    return RT_EOK;
+}
+
 static int wifi_para_init(void)
 {
     int result = -RT_ERROR;
@@ -308,6 +470,9 @@ static int wifi_net_init(void)
 
 static int wifi_get_info(void)
 {
+    if(wifi_send_wait_idle(WIFI_SEND_TIMEOUT) != RT_EOK)
+        return -RT_ERROR;
+
     rt_thread_mdelay(100);
     at_exec_cmd(RT_NULL, "AT+CWJAP_CUR?");
     rt_thread_mdelay(200);
@@ -324,6 +489,9 @@ static int wifi_socket_close(int socket)
 
     int result = -RT_ERROR;
 
+    if(wifi_send_wait_idle(WIFI_SEND_TIMEOUT) != RT_EOK)
+        return result;
+
     at_response_t resp = &at_resp;
     at_resp_set_info(resp, 0, 3000);
     do
@@ -352,88 +520,236 @@ static int wifi_socket_close(int socket)
     return result;
 }
 
-static int wifi_socket_send(int socket, const uint8_t *buf, int buf_len)
+/* 收到 SEND OK / SEND FAIL 或超时, 结束窗口中最早的一次发送 */
+static void wifi_send_complete(int result)
 {
-    if(socket < 0)
-        return -RT_ERROR;
-    
-    if(buf == RT_NULL)
-        return -RT_ERROR;
-    
-    if(buf_len <= 0)
-        return buf_len;
-    
-    int result = -RT_ERROR;
+    rt_base_t level = rt_hw_interrupt_disable();
 
-    at_response_t resp = &at_resp;
-    at_resp_set_info(resp, 2, 3000);
-    cur_socket = -1;
-    do
+    if(send_slot_num == 0)
     {
-        int send_size = 0, cur_pkt_size = 0;
+        rt_hw_interrupt_enable(level);
+        return;
+    }
 
-        int rc = RT_EOK;
-        while(send_size < buf_len)
+    struct wifi_session *session = send_slots[send_slot_head].session;
+    int link_id = send_slots[send_slot_head].link_id;
+    int expired = send_slots[send_slot_head].expired;
+
+    send_slot_head = (send_slot_head + 1) % WIFI_SEND_WINDOW;
+    send_slot_num--;
+
+    if(session->send_pending > 0)
+        session->send_pending--;
+
+    /* 超时时已关闭会话, 只释放窗口 */
+    if(expired)
+        result = RT_EOK;
+
+    if((result != RT_EOK) && (session->link_id == link_id) && (session->state == WIFI_SESSION_STATE_CONNECTED))
+    {
+        session->state = WIFI_SESSION_STATE_CLOSING;
+        wifi_device.ready_mask |= WIFI_SESSION_BIT(session);
+    }
+    else if(session->recv_queue.count > 0)
+    {
+        /* 被预算暂停的会话继续处理请求 */
+        wifi_device.ready_mask |= WIFI_SESSION_BIT(session);
+    }
+
+    rt_hw_interrupt_enable(level);
+
+    if(result != RT_EOK)
+        LOG_E("socket (%d) send failed.", link_id);
+
+    /* 发送窗口空出, 唤醒 wifi 线程继续发送 */
+    wifi_event_send(WIFI_EVENT_SEND_DONE | WIFI_EVENT_SESSION_READY);
+}
+
+/**
+ * 最早一次发送超时未收到 SEND OK, 关闭会话.
+ * 模块的回复按发送顺序返回, 迟到的 SEND OK 会结束下一次发送, 所以窗口先不释放,
+ * 由迟到的回复结束, 再过一个超时仍没有回复时认为模块没有回复这次发送.
+ */
+static void wifi_send_expire(void)
+{
+    rt_base_t level = rt_hw_interrupt_disable();
+
+    struct wifi_send_slot *slot = &send_slots[send_slot_head];
+    struct wifi_session *session = slot->session;
+    int link_id = slot->link_id;
+
+    slot->expired = 1;
+    slot->timeout = rt_tick_get() + rt_tick_from_millisecond(WIFI_SEND_TIMEOUT);
+
+    if((session->link_id == link_id) && (session->state == WIFI_SESSION_STATE_CONNECTED))
+    {
+        session->state = WIFI_SESSION_STATE_CLOSING;
+        wifi_device.ready_mask |= WIFI_SESSION_BIT(session);
+    }
+
+    rt_hw_interrupt_enable(level);
+
+    LOG_E("socket (%d) send timeout.", link_id);
+
+    wifi_event_send(WIFI_EVENT_SESSION_READY);
+}
+
+static int wifi_socket_write(const rt_uint8_t *buf, int buf_len)
+{
+    rt_tick_t tick_timeout = rt_tick_get() + rt_tick_from_millisecond(WIFI_SEND_TIMEOUT);
+    int send_size = 0;
+
+    /* 串口发送缓冲区满时等待 DMA 发送 */
+    while(send_size < buf_len)
+    {
+        int rc = at_client_send((const char *)(buf + send_size), buf_len - send_size);
+        if(rc > 0)
         {
-            if(buf_len - send_size < WIFI_SEND_MAX_SIZE)
-                cur_pkt_size = buf_len - send_size;
-            else
-                cur_pkt_size = WIFI_SEND_MAX_SIZE;
-            
-            wifi_event_recv(WIFI_SET_EVENT(socket, WIFI_EVENT_SEND_OK | WIFI_EVENT_SEND_FAIL), 0, RT_EVENT_FLAG_OR);
-            cur_socket = socket;
-            if(at_exec_cmd(resp, "AT+CIPSEND=%d,%d", socket, cur_pkt_size) < 0)
-            {
-                rc = -RT_ERROR;
-                break;
-            }
+            send_size += rc;
+            continue;
+        }
+
+        if((rt_tick_get() - tick_timeout) < (RT_TICK_MAX / 2))
+            return -RT_ERROR;
+
+        if(wifi_device.client->dev->error)
+            return -RT_ERROR;
+
+        rt_thread_mdelay(1);
+    }
 
-            if(at_client_send((const char *)(buf + send_size), cur_pkt_size) == 0)
+    return RT_EOK;
+}
+
+/*
+ * 按差额轮询 (DRR) 选择会话: 每轮给会话增加 WIFI_SEND_QUANTUM 字节额度,
+ * 额度不足以发送队首数据时轮到下一个会话, 发送的字节数从额度中扣除
+ */
+static struct wifi_session *wifi_send_select(void)
+{
+    rt_uint32_t send_mask = wifi_device.send_mask;
+
+    while(send_mask)
+    {
+        for (int i = 0; i < WIFI_SERVER_MAX_CONN; i++)
+        {
+            int index = (send_session_index + i) % WIFI_SERVER_MAX_CONN;
+            if(!(send_mask & (1UL << index)))
+                continue;
+
+            struct wifi_session *session = &(wifi_device.sessions[index]);
+            wifi_queue_blk_t block = wifi_queue_peek(&send_pool, &(session->send_queue), 0);
+            if((session->state != WIFI_SESSION_STATE_CONNECTED) || (block == RT_NULL))
             {
-                rc = -RT_ERROR;
-                break;
+                send_mask &= ~(1UL << index);
+                continue;
             }
 
-            if(wifi_event_recv(WIFI_SET_EVENT(socket, 0), 5000, RT_EVENT_FLAG_OR) < 0)
+            session->send_deficit += WIFI_SEND_QUANTUM;
+            if(session->send_deficit >= block->size)
             {
-                rc = -RT_ERROR;
-                break;
+                send_session_index = index;
+                return session;
             }
+        }
+    }
 
-            int event_result = 0;
-            if((event_result = wifi_event_recv(WIFI_EVENT_SEND_OK | WIFI_EVENT_SEND_FAIL, 100, RT_EVENT_FLAG_OR)) < 0)
-            {
-                rc = -RT_ERROR;
+    return RT_NULL;
+}
+
+/* 将会话发送队列中的数据合并后通过 AT+CIPSEND 发出, 不等待 SEND OK */
+static int wifi_send_process(void)
+{
+    at_response_t resp = &at_resp;
+
+    while(send_slot_num < WIFI_SEND_WINDOW)
+    {
+        struct wifi_session *session = wifi_send_select();
+        if(session == RT_NULL)
+            break;
+
+        int blk_num = 0;
+        int pkt_size = 0;
+        wifi_queue_blk_t block = RT_NULL;
+        while((block = wifi_queue_peek(&send_pool, &(session->send_queue), blk_num)) != RT_NULL)
+        {
+            if((blk_num > 0) && (pkt_size + block->size > WIFI_SEND_MAX_SIZE))
+                break;
+            if(pkt_size + block->size > session->send_deficit)
                 break;
-            }
 
-            if(event_result & WIFI_EVENT_SEND_FAIL)
-            {
-                rc = -RT_ERROR;
+            pkt_size += block->size;
+            blk_num++;
+        }
+
+        int link_id = session->link_id;
+
+        at_resp_set_info(resp, 2, 3000);
+        if(at_exec_cmd(resp, "AT+CIPSEND=%d,%d", link_id, pkt_size) < 0)
+        {
+            LOG_E("socket (%d) send failed.", link_id);
+            wifi_queue_clean(&send_pool, &(session->send_queue));
+            wifi_device.send_mask &= ~WIFI_SESSION_BIT(session);
+            session->state = WIFI_SESSION_STATE_CLOSING;
+            wifi_session_ready(session);
+            return -RT_ERROR;
+        }
+
+        /* SEND OK 可能在数据写完之前返回, 先占用窗口 */
+        rt_base_t level = rt_hw_interrupt_disable();
+        int slot_index = (send_slot_head + send_slot_num) % WIFI_SEND_WINDOW;
+        send_slots[slot_index].session = session;
+        send_slots[slot_index].link_id = link_id;
+        send_slots[slot_index].timeout = rt_tick_get() + rt_tick_from_millisecond(WIFI_SEND_TIMEOUT);
+        send_slots[slot_index].expired = 0;
+        send_slot_num++;
+        session->send_pending++;
+        rt_hw_interrupt_enable(level);
+
+        /* 数据已拷贝到串口发送缓冲区, 立即释放队列 */
+        int rc = RT_EOK;
+        for (int i = 0; i < blk_num; i++)
+        {
+            block = wifi_queue_take(&send_pool, &(session->send_queue));
+            if(block == RT_NULL)
                 break;
-            }
 
-            send_size += cur_pkt_size;
-            cur_socket = -1;
+            if(rc == RT_EOK)
+                rc = wifi_socket_write(block->buf, block->size);
+
+            wifi_queue_cancel(&send_pool, block);
+        }
+
+        /* 每次只服务一个会话, 下一次从下一个会话开始, 空闲会话不保留额度 */
+        session->send_deficit -= pkt_size;
+        send_session_index = (send_session_index + 1) % WIFI_SERVER_MAX_CONN;
+        if(session->send_queue.count == 0)
+        {
+            session->send_deficit = 0;
+            wifi_device.send_mask &= ~WIFI_SESSION_BIT(session);
         }
 
         if(rc != RT_EOK)
-            break;
+        {
+            LOG_E("socket (%d) write failed.", link_id);
+            return -RT_ERROR;
+        }
 
-        result = RT_EOK;
-    }while(0);
+        LOG_D("socket (%d) send %d bytes.", link_id, pkt_size);
+    }
 
-    if(result != RT_EOK)
-        LOG_E("socket (%d) send failed.", socket);
-    else
+    /* 最早一次发送超时未收到 SEND OK */
+    if((send_slot_num > 0) &&
+       ((rt_tick_get() - send_slots[send_slot_head].timeout) < (RT_TICK_MAX / 2)))
     {
-        LOG_D("socket (%d) send ok.", socket);
+        if(send_slots[send_slot_head].expired)
+            wifi_send_complete(-RT_ETIMEOUT);
+        else
+            wifi_send_expire();
+        return -RT_ERROR;
     }
 
-    rt_thread_mdelay(100);
-    cur_socket = -1;
-
-    return (result == RT_EOK) ? buf_len : result;
+    return RT_EOK;
 }
 
 static int wifi_session_close(struct wifi_session *session)
@@ -478,16 +794,60 @@ int wifi_session_send(struct wifi_session *session, const rt_uint8_t *buf, int b
 {
     if(session->state != WIFI_SESSION_STATE_CONNECTED)
         return -RT_ERROR;
-    
-    return wifi_socket_send(session->link_id, buf, buf_len);
+
+    if(buf == RT_NULL)
+        return -RT_ERROR;
+
+    if(buf_len <= 0)
+        return buf_len;
+
+    /* 只入队, 由 wifi_send_process 合并发送 */
+    wifi_queue_blk_t block = wifi_queue_alloc(&send_pool, buf_len);
+    if(block == RT_NULL)
+    {
+        /* 队列满时先把已缓存的数据发出 */
+        if(wifi_send_wait_idle(WIFI_SEND_TIMEOUT) != RT_EOK)
+            return -RT_ERROR;
+        if(wifi_send_process() != RT_EOK)
+            return -RT_ERROR;
+
+        block = wifi_queue_alloc(&send_pool, buf_len);
+        if(block == RT_NULL)
+            return -RT_ERROR;
+    }
+
+    rt_memcpy(block->buf, buf, buf_len);
+    wifi_queue_push(&send_pool, &(session->send_queue), block);
+    wifi_device.send_mask |= WIFI_SESSION_BIT(session);
+    if(session->send_queue.count > session->send_depth_max)
+        session->send_depth_max = session->send_queue.count;
+
+    return buf_len;
 }
 
 extern int wifi_session_process(struct wifi_session *session, rt_uint8_t *recv_buf, int recv_len);
 
+/* 其他线程中有数据需要 wifi 线程发送时调用 */
+void wifi_net_wakeup(void)
+{
+    wifi_event_send(WIFI_EVENT_SESSION_READY);
+}
+
 static int wifi_net_process(void)
 {
-    for (int i = 0; i < WIFI_SERVER_MAX_CONN; i++)
+    wifi_wheel_process();
+
+    rt_base_t level = rt_hw_interrupt_disable();
+    rt_uint32_t ready_mask = wifi_device.ready_mask;
+    wifi_device.ready_mask = 0;
+    rt_hw_interrupt_enable(level);
+
+    /* 只处理有事件的会话, 每个会话每次处理一个数据块 */
+    for (int i = 0; ready_mask; i++, ready_mask >>= 1)
     {
+        if(!(ready_mask & 0x01))
+            continue;
+
         struct wifi_session *session = &(wifi_device.sessions[i]);
 
         switch(session->state)
@@ -498,7 +858,10 @@ static int wifi_net_process(void)
             case WIFI_SESSION_STATE_CLOSING:
             {
                 if(wifi_session_close(session) != RT_EOK)
+                {
                     wifi_device.error_cnt++;
+                    wifi_session_ready(session);
+                }
             }
             break;
 
@@ -507,22 +870,46 @@ static int wifi_net_process(void)
                 if((rt_tick_get() - session->timeout) < (RT_TICK_MAX / 2))
                 {
                     if(wifi_session_close(session) != RT_EOK)
+                    {
                         wifi_device.error_cnt++;
+                        wifi_session_ready(session);
+                    }
+
+                    break;
+                }
+
+                wifi_queue_blk_t block = wifi_queue_peek(&recv_pool, &(session->recv_queue), 0);
+                if(block == RT_NULL)
+                    break;
 
+                /* 超出预算时请求留在接收队列, SEND OK 或网关回复后重新置为就绪 */
+                if(wifi_session_over_budget(session))
+                {
+                    session->defer_cnt++;
                     break;
                 }
 
-                rt_rbb_blk_t block = rt_rbb_blk_get(&(session->recv_rbb));
+                /* 先从队列中取出, 处理期间 reactor 线程清理会话不会释放这个块 */
+                block = wifi_queue_take(&recv_pool, &(session->recv_queue));
                 if(block == RT_NULL)
                     break;
+
                 int rc = wifi_session_process(session, block->buf, block->size);
-                rt_rbb_blk_free(&(session->recv_rbb), block);
+                wifi_queue_cancel(&recv_pool, block);
                 
                 if(rc != RT_EOK)
                 {
                     if(wifi_session_close(session) != RT_EOK)
+                    {
                         wifi_device.error_cnt++;
+                        wifi_session_ready(session);
+                    }
+
+                    break;
                 }
+
+                if(session->recv_queue.count > 0)
+                    wifi_session_ready(session);
             }
             break;
 
@@ -531,14 +918,15 @@ static int wifi_net_process(void)
         }    
     }
 
-    for (int i = 0; i < WIFI_SERVER_MAX_CONN; i++)
-    {
-        if(wifi_device.sessions[i].state == WIFI_SESSION_STATE_CONNECTED)
-        {
-            wifi_device.wifi_timeout = rt_tick_get() + rt_tick_from_millisecond(WIFI_NET_TIMEOUT * 1000);
-            break;
-        }
-    }
+#ifdef WIFI_GATEWAY_USING
+    wifi_gateway_process();
+#endif
+
+    if(wifi_send_process() != RT_EOK)
+        wifi_device.error_cnt++;
+
+    if(wifi_device.active_mask)
+        wifi_device.wifi_timeout = rt_tick_get() + rt_tick_from_millisecond(WIFI_NET_TIMEOUT * 1000);
 
     if((rt_tick_get() - wifi_device.wifi_timeout) < (RT_TICK_MAX / 2))
         wifi_device.error_cnt = 99;
@@ -549,6 +937,34 @@ static int wifi_net_process(void)
     return RT_EOK;
 }
 
+/* 没有就绪的会话时阻塞, 直到收到数据、发送窗口空出、时间轮下一格或 SEND OK 超时 */
+static void wifi_net_wait(void)
+{
+    rt_base_t level = rt_hw_interrupt_disable();
+
+    if(wifi_device.ready_mask)
+    {
+        rt_hw_interrupt_enable(level);
+        return;
+    }
+
+    rt_tick_t now = rt_tick_get();
+    rt_int32_t timeout = (rt_int32_t)(wifi_wheel_tick + WIFI_WHEEL_TICK - now);
+    if(send_slot_num > 0)
+    {
+        rt_int32_t send_timeout = (rt_int32_t)(send_slots[send_slot_head].timeout - now);
+        if(send_timeout < timeout)
+            timeout = send_timeout;
+    }
+
+    rt_hw_interrupt_enable(level);
+
+    if(timeout <= 0)
+        return;
+
+    wifi_event_recv(WIFI_EVENT_SESSION_READY, timeout, RT_EVENT_FLAG_OR);
+}
+
 static void wifi_process_entry(void *parameter)
 {
     rt_tick_t info_tick_timeout = 0;
@@ -570,6 +986,8 @@ static void wifi_process_entry(void *parameter)
                 LOG_W("Reset wifi.");
                 rt_event_control(&(wifi_device.evt), RT_IPC_CMD_RESET, RT_NULL);
                 wifi_sessions_clean(RT_NULL);
+                send_slot_head = 0;
+                send_slot_num = 0;
                 rt_memset(wifi_device.ssid, 0, sizeof(wifi_device.ssid));
                 wifi_device.rssi = 0;
                 rt_memset(wifi_device.ip, 0, sizeof(wifi_device.ip));
@@ -630,6 +1048,7 @@ static void wifi_process_entry(void *parameter)
                 {
                     LOG_I("wifi net init success.");
                     wifi_device.wifi_state = WIFI_STATE_NET_PROCESS;
+                    wifi_wheel_reset();
                     wifi_device.wifi_timeout = rt_tick_get() + rt_tick_from_millisecond(WIFI_NET_TIMEOUT * 1000);
                 }
             }
@@ -650,7 +1069,10 @@ static void wifi_process_entry(void *parameter)
             break;
         }
 
-        rt_thread_mdelay(10);
+        if(wifi_device.wifi_state == WIFI_STATE_NET_PROCESS)
+            wifi_net_wait();
+        else
+            rt_thread_mdelay(10);
     }
 }
 
@@ -772,10 +1194,7 @@ static void urc_connect_cb(struct at_client *client, const char *data, rt_size_t
         struct wifi_session *session = wifi_session_get(socket);
         if(session)
         {
-            wifi_sessions_clean(session);
-            session->link_id = socket;
-            session->timeout = rt_tick_get() + rt_tick_from_millisecond(WIFI_CLIENT_TIMEOUT * 1000);
-            session->state = WIFI_SESSION_STATE_CONNECTED;
+            wifi_session_open(session, socket);
             break;
         }
 
@@ -793,9 +1212,7 @@ static void urc_connect_cb(struct at_client *client, const char *data, rt_size_t
         if (session == RT_NULL)
             break;
         
-        session->link_id = socket;
-        session->timeout = rt_tick_get() + rt_tick_from_millisecond(WIFI_CLIENT_TIMEOUT * 1000);
-        session->state = WIFI_SESSION_STATE_CONNECTED;
+        wifi_session_open(session, socket);
     }while(0);
 
     rt_hw_interrupt_enable(level);
@@ -810,19 +1227,44 @@ static void urc_wifi_disconnect_cb(struct at_client *client, const char *data, r
     wifi_device.error_cnt = 99;
 }
 
-static void urc_ipd_cb(struct at_client *client, const char *data, rt_size_t size)
+static void urc_ipd_payload_done(struct at_client *client, char *buf, rt_size_t len, void *user_data)
 {
-    if(wifi_device.wifi_state != WIFI_STATE_NET_PROCESS)
+    struct wifi_session *session = (struct wifi_session *)user_data;
+    wifi_queue_blk_t block = ipd_block;
+
+    ipd_block = RT_NULL;
+    if(block == RT_NULL)
         return;
-    
+
+    if((len != block->size) || (session->link_id != ipd_link_id))
+    {
+        LOG_E("socket (%d) recv size (%d) data failed.", ipd_link_id, block->size);
+        wifi_queue_cancel(&recv_pool, block);
+        return;
+    }
+
+    wifi_queue_push(&recv_pool, &(session->recv_queue), block);
+    if(session->recv_queue.count > session->recv_depth_max)
+        session->recv_depth_max = session->recv_queue.count;
+    wifi_session_refresh(session);
+    wifi_session_ready(session);
+}
+
+static void urc_ipd_cb(struct at_client *client, const char *data, rt_size_t size)
+{
     int socket = 0;
     int len = 0;
     if(sscanf(data, "+IPD,%d,%d:", &socket, &len) != 2)
         return;
-    if(socket < 0)
-        return;
     if(len <= 0)
         return;
+
+    /* 负载数据在回调返回后由 AT 组件直接接收, 无法处理时丢弃 */
+    if((wifi_device.wifi_state != WIFI_STATE_NET_PROCESS) || (socket < 0))
+    {
+        at_obj_set_payload(client, RT_NULL, len, 20, RT_NULL, RT_NULL);
+        return;
+    }
     
     struct wifi_session *session = RT_NULL;
 
@@ -849,58 +1291,37 @@ static void urc_ipd_cb(struct at_client *client, const char *data, rt_size_t siz
     if(session == RT_NULL)
     {
         rt_hw_interrupt_enable(level);
+        at_obj_set_payload(client, RT_NULL, len, 20, RT_NULL, RT_NULL);
         return;
     }
 
     if(session->state != WIFI_SESSION_STATE_CONNECTED)
-    {
-        wifi_sessions_clean(session);
-        session->link_id = socket;
-        session->timeout = rt_tick_get() + rt_tick_from_millisecond(WIFI_CLIENT_TIMEOUT * 1000);
-        session->state = WIFI_SESSION_STATE_CONNECTED;
-    }
+        wifi_session_open(session, socket);
 
     rt_hw_interrupt_enable(level);
-    
-    rt_rbb_blk_t block = rt_rbb_blk_alloc(&(session->recv_rbb), len);
-    if(block == RT_NULL)
-        return;
-    rt_memset(block->buf, 0, block->size);
 
-    if(at_client_recv((char *)(block->buf), block->size, 20) != block->size)
+    /* 会话超出配额或共享块池已满时丢弃, 由主站超时重发 */
+    ipd_block = wifi_queue_alloc(&recv_pool, len);
+    if(ipd_block && (session->recv_queue.cap + ipd_block->cap > WIFI_RECV_SESSION_QUOTA))
     {
-        LOG_E("socket (%d) recv size (%d) data failed.", socket, len);
-        rt_rbb_blk_free(&(session->recv_rbb), block);
-        return;
+        wifi_queue_cancel(&recv_pool, ipd_block);
+        ipd_block = RT_NULL;
     }
-
-    rt_rbb_blk_put(block);
-    session->timeout = rt_tick_get() + rt_tick_from_millisecond(WIFI_CLIENT_TIMEOUT * 1000);
+    if(ipd_block == RT_NULL)
+    {
+        session->recv_drop_cnt++;
+        LOG_W("socket (%d) recv queue is full, drop %d bytes.", socket, len);
+    }
+    ipd_link_id = socket;
+    at_obj_set_payload(client, ipd_block ? (char *)(ipd_block->buf) : RT_NULL, len, 20, urc_ipd_payload_done, session);
 }
 
 static void urc_send_cb(struct at_client *client, const char *data, rt_size_t size)
 {
-    if(cur_socket < 0)
-        return;
-    
-    struct wifi_session *session = wifi_session_get(cur_socket);
-    if(session == RT_NULL)
-        return;
-    
-    rt_base_t level = rt_hw_interrupt_disable();
-
-    do
-    {
-        if(session->state != WIFI_SESSION_STATE_CONNECTED)
-            break;
-        
-        if(strstr(data, "SEND OK"))
-            wifi_event_send(WIFI_SET_EVENT(session->link_id, WIFI_EVENT_SEND_OK));
-        else if(strstr(data, "SEND FAIL"))
-            wifi_event_send(WIFI_SET_EVENT(session->link_id, WIFI_EVENT_SEND_FAIL));
-    }while(0);
-
-    rt_hw_interrupt_enable(level);
+    if(strstr(data, "SEND OK"))
+        wifi_send_complete(RT_EOK);
+    else if(strstr(data, "SEND FAIL"))
+        wifi_send_complete(-RT_ERROR);
 }
 
 static struct at_urc urc_table[] = {
@@ -916,6 +1337,35 @@ static struct at_urc urc_table[] = {
     {"SEND FAIL", "\r\n", urc_send_cb},
 };
 
+static void at_parser_run(at_client_t client)
+{
+    rt_int32_t left;
+
+    at_client_obj_parse(client);
+
+    /* 否则超时的 payload 要等到下次收到数据才结束 */
+    left = at_client_obj_payload_left(client);
+    if(left >= 0)
+        reactor_timer_start(&at_payload_timer, left);
+    else
+        reactor_timer_stop(&at_payload_timer);
+}
+
+static void at_parser_handler(reactor_source_t source)
+{
+    at_parser_run((at_client_t)source->user_data);
+}
+
+static void at_payload_timeout_handler(reactor_timer_t timer)
+{
+    at_parser_run((at_client_t)timer->user_data);
+}
+
+static void at_parser_notify(at_client_t client)
+{
+    reactor_source_notify(&at_parser_source);
+}
+
 static rt_err_t _wifi_control(usr_device_t dev, int cmd, void *args)
 {
     rt_err_t result = -RT_ERROR;
@@ -971,17 +1421,20 @@ static int wifi_init(void)
 {
     rt_event_init(&(wifi_device.evt), "wifi", RT_IPC_FLAG_FIFO);
     wifi_device.wifi_state = WIFI_STATE_RESET;
+    wifi_queue_pool_init(&recv_pool, recv_pool_buf, recv_pool_blk,
+                         WIFI_QUEUE_SMALL_SIZE, WIFI_RECV_SMALL_NUM, WIFI_QUEUE_LARGE_SIZE, WIFI_RECV_LARGE_NUM);
+    wifi_queue_pool_init(&send_pool, send_pool_buf, send_pool_blk,
+                         WIFI_QUEUE_SMALL_SIZE, WIFI_SEND_SMALL_NUM, WIFI_QUEUE_LARGE_SIZE, WIFI_SEND_LARGE_NUM);
     for (int i = 0; i < WIFI_SERVER_MAX_CONN; i++)
     {
         wifi_device.sessions[i].link_id = -1;
+        wifi_queue_init(&(wifi_device.sessions[i].send_queue));
+        wifi_queue_init(&(wifi_device.sessions[i].recv_queue));
+        wifi_device.sessions[i].recv_drop_cnt = 0;
         wifi_device.sessions[i].timeout = rt_tick_get();
-        rt_rbb_init(&(wifi_device.sessions[i].recv_rbb),
-                    wifi_device.sessions[i].recv_rbb_buf,
-                    WIFI_CLIENT_RBB_BUFSZ,
-                    wifi_device.sessions[i].recv_rbb_blk,
-                    WIFI_CLIENT_RBB_BLKNUM);
         wifi_device.sessions[i].state = WIFI_SESSION_STATE_CLOSED;
     }
+    wifi_wheel_reset();
 
     usr_device_t dev = usr_device_find(WIFI_CLIENT_DEVICE_NAME);
     RT_ASSERT(dev);
@@ -1004,15 +1457,11 @@ static int wifi_init(void)
     RT_ASSERT(wifi_device.client);
     /* register URC data execution function  */
     at_set_urc_table(urc_table, sizeof(urc_table) / sizeof(urc_table[0]));
-    rt_thread_init(&at_parser,
-                   "wifi_clnt",
-                   (void (*)(void *parameter))client_parser,
-                   wifi_device.client,
-                   &at_parser_stack[0],
-                   sizeof(at_parser_stack),
-                   1,
-                   100);
-    rt_thread_startup(&at_parser);
+    /* AT 数据在 reactor 线程中解析 */
+    reactor_source_register(&at_parser_source, at_parser_handler, wifi_device.client);
+    reactor_timer_init(&at_payload_timer, at_payload_timeout_handler, wifi_device.client);
+    at_obj_set_rx_notify(wifi_device.client, at_parser_notify);
+    reactor_source_notify(&at_parser_source);
 
     drv_pin_mode(WIFI_POWER_PIN, PIN_MODE_OUTPUT);
     drv_pin_mode(WIFI_RESET_PIN, PIN_MODE_OUTPUT);
@@ -1066,11 +1515,15 @@ static int print_wifi_param(void)
 {
     LOG_I("ssid:%s, rssi:%d, ip:%s, gateway:%s, netmask:%s", wifi_device.ssid, wifi_device.rssi, wifi_device.ip, wifi_device.gateway, wifi_device.netmask);
     
-    LOG_I("|link_id|state|");
-    LOG_I("|-------|-----|");
+    LOG_I("|link_id|state|recv blk|recv bytes|recv max|recv drop|send blk|send max|pending|defer|");
+    LOG_I("|-------|-----|--------|----------|--------|---------|--------|--------|-------|-----|");
     for (int i = 0; i < WIFI_SERVER_MAX_CONN; i++)
     {
-        LOG_I("|  %d  |  %d  |", wifi_device.sessions[i].link_id, wifi_device.sessions[i].state);
+        struct wifi_session *session = &(wifi_device.sessions[i]);
+        LOG_I("|  %d  |  %d  |   %d   |   %d   |   %d   |   %d   |   %d   |   %d   |   %d   |   %d   |",
+              session->link_id, session->state,
+              session->recv_queue.count, session->recv_queue.bytes, session->recv_depth_max, session->recv_drop_cnt,
+              session->send_queue.count, session->send_depth_max, session->send_pending, session->defer_cnt);
     }
 
     return RT_EOK;
@@ -4,10 +4,91 @@
 #include "ringblk_buf.h"
 #include "usr_device.h"
 #include "at.h"
+#include "wifi_queue.h"
 
+#ifdef ESP_SIM_USING
+#include "esp_sim.h"
+#undef WIFI_CLIENT_DEVICE_NAME
+#define WIFI_CLIENT_DEVICE_NAME         ESP_SIM_DEVICE_NAME
+#endif
+
+#ifndef WIFI_SERVER_MAX_CONN
 #define WIFI_SERVER_MAX_CONN            5
-#define WIFI_CLIENT_RBB_BUFSZ           512
-#define WIFI_CLIENT_RBB_BLKNUM          10
+#endif
+
+/* 会话就绪状态按位存放 */
+#if WIFI_SERVER_MAX_CONN > 32
+#error "WIFI_SERVER_MAX_CONN must be less than or equal to 32"
+#endif
+
+/* 收发队列的块大小, 大块放得下最长的 modbus TCP 帧 */
+#ifndef WIFI_QUEUE_SMALL_SIZE
+#define WIFI_QUEUE_SMALL_SIZE           64
+#endif
+
+#ifndef WIFI_QUEUE_LARGE_SIZE
+#define WIFI_QUEUE_LARGE_SIZE           260
+#endif
+
+/* 接收块池由所有会话共享 */
+#ifndef WIFI_RECV_SMALL_NUM
+#define WIFI_RECV_SMALL_NUM             16
+#endif
+
+#ifndef WIFI_RECV_LARGE_NUM
+#define WIFI_RECV_LARGE_NUM             4
+#endif
+
+/* 单个会话最多占用的接收块字节数, 超出后丢弃该会话的数据 */
+#ifndef WIFI_RECV_SESSION_QUOTA
+#define WIFI_RECV_SESSION_QUOTA         512
+#endif
+
+#ifndef WIFI_SEND_SMALL_NUM
+#define WIFI_SEND_SMALL_NUM             8
+#endif
+
+#ifndef WIFI_SEND_LARGE_NUM
+#define WIFI_SEND_LARGE_NUM             2
+#endif
+
+/* 发送调度每轮给会话增加的字节额度 */
+#ifndef WIFI_SEND_QUANTUM
+#define WIFI_SEND_QUANTUM               256
+#endif
+
+/* 单个会话未发完的响应数 (含未回复的网关请求) 及占用发送块池的字节数上限, 超出后暂停处理该会话的请求 */
+#ifndef WIFI_SESSION_INFLIGHT_MAX
+#define WIFI_SESSION_INFLIGHT_MAX       2
+#endif
+
+#ifndef WIFI_SESSION_SEND_BUDGET
+#define WIFI_SESSION_SEND_BUDGET        512
+#endif
+
+/* 网关: 单元标识不是本机的请求转发到 RS485 总线 */
+#ifndef WIFI_GATEWAY_REQUEST_NUM
+#define WIFI_GATEWAY_REQUEST_NUM        4
+#endif
+
+#ifndef WIFI_GATEWAY_CACHE_NUM
+#define WIFI_GATEWAY_CACHE_NUM          4
+#endif
+
+/* 读响应缓存有效时间(ms), 0 为不缓存 */
+#ifndef WIFI_GATEWAY_CACHE_TTL
+#define WIFI_GATEWAY_CACHE_TTL          200
+#endif
+
+/* 单条缓存的最大 PDU 长度 */
+#ifndef WIFI_GATEWAY_CACHE_SIZE
+#define WIFI_GATEWAY_CACHE_SIZE         64
+#endif
+
+/* 同时等待 SEND OK 的 AT+CIPSEND 数量 */
+#ifndef WIFI_SEND_WINDOW
+#define WIFI_SEND_WINDOW                1
+#endif
 
 #define USR_DEVICE_WIFI_CMD_SMART       0x01
 
@@ -30,13 +111,35 @@ typedef enum
 struct wifi_session
 {
     int link_id;
+    /* 每次建立连接加 1, 区分复用同一 link_id 的前后两个连接 */
+    rt_uint32_t generation;
     rt_tick_t timeout;
-    rt_uint8_t recv_rbb_buf[WIFI_CLIENT_RBB_BUFSZ];
-    struct rt_rbb_blk recv_rbb_blk[WIFI_CLIENT_RBB_BLKNUM];
-    struct rt_rbb recv_rbb;
+    rt_slist_t wheel_node;
+    rt_uint8_t wheel_slot;
+    rt_uint8_t wheel_on;
+    struct wifi_queue recv_queue;
+    rt_uint32_t recv_drop_cnt;
+    struct wifi_queue send_queue;
+    /* 已发出 AT+CIPSEND 等待 SEND OK 的数量 */
+    rt_uint8_t send_pending;
+    /* 已转发到 RS485 还未回复的网关请求数 */
+    rt_uint8_t gateway_pending;
+    rt_int32_t send_deficit;
+    rt_uint32_t defer_cnt;
+    rt_uint16_t recv_depth_max;
+    rt_uint16_t send_depth_max;
     wifi_session_state state;
 };
 
+struct wifi_send_slot
+{
+    struct wifi_session *session;
+    int link_id;
+    rt_tick_t timeout;
+    /* 已超时, 仍占用窗口等待迟到的 SEND OK, 避免它结束下一次发送 */
+    rt_uint8_t expired;
+};
+
 struct usr_device_wifi
 {
     struct usr_device parent;
@@ -47,6 +150,12 @@ struct usr_device_wifi
     struct rt_event evt;
     wifi_state_t wifi_state;
     struct wifi_session sessions[WIFI_SERVER_MAX_CONN];
+    /* 已连接的会话 */
+    rt_uint32_t active_mask;
+    /* 有接收数据、需要关闭或已超时的会话 */
+    rt_uint32_t ready_mask;
+    /* 发送队列非空的会话 */
+    rt_uint32_t send_mask;
     
     rt_uint16_t error_cnt;
     rt_tick_t wifi_timeout;
@@ -59,5 +168,12 @@ struct usr_device_wifi
 };
 
 int wifi_session_send(struct wifi_session *session, const rt_uint8_t *buf, int buf_len);
+void wifi_session_ready(struct wifi_session *session);
+void wifi_net_wakeup(void);
+
+#ifdef WIFI_GATEWAY_USING
+int wifi_gateway_request(struct wifi_session *session, const rt_uint8_t *adu, int adu_len);
+void wifi_gateway_process(void);
+#endif
 
 #endif
@@ -0,0 +1,446 @@
+#include "wifi.h"
+#include "rtu_master.h"
+#include <rthw.h>
+#include <string.h>
+
+#ifdef WIFI_GATEWAY_USING
+
+#define DBG_ENABLE
+#define DBG_COLOR
+#define DBG_SECTION_NAME    "wifi_gw"
+#define DBG_LEVEL           DBG_INFO
+#include <rtdbg.h>
+
+#define MBAP_HEADER_LENGTH                  7
+/* 从机地址 + 功能码 + 地址 + 数量 */
+#define GATEWAY_KEY_LENGTH                  6
+
+#define GATEWAY_EXCEPTION_PATH_UNAVAILABLE  0x0A
+#define GATEWAY_EXCEPTION_TARGET_FAILED     0x0B
+#define GATEWAY_EXCEPTION_BUSY              0x06
+
+typedef enum
+{
+    GATEWAY_REQUEST_FREE = 0,
+    /* 已提交到 RS485 总线 */
+    GATEWAY_REQUEST_QUEUED,
+    /* 与正在执行的读请求相同, 等待其结果 */
+    GATEWAY_REQUEST_WAIT,
+    GATEWAY_REQUEST_DONE
+} gateway_request_state_t;
+
+/* TCP 单元标识 unit_min ~ unit_max 转发到 RS485 从机 slave, slave 为 0 时使用单元标识 */
+struct gateway_route
+{
+    rt_uint8_t unit_min;
+    rt_uint8_t unit_max;
+    rt_uint8_t slave;
+};
+
+struct gateway_request
+{
+    gateway_request_state_t state;
+    struct wifi_session *session;
+    int link_id;
+    rt_uint32_t generation;
+    rt_uint16_t tid;
+    rt_uint8_t unit_id;
+    rt_uint8_t slave;
+    rt_uint8_t function;
+    /* 读请求提交时该从机的写代数, 结果只在其间没有写操作时缓存 */
+    rt_uint8_t write_gen;
+    /* 读请求的缓存键, 请求缓冲区在完成后会被响应覆盖 */
+    rt_uint8_t is_read;
+    rt_uint8_t key[GATEWAY_KEY_LENGTH];
+    struct gateway_request *leader;
+    struct rtu_master_xfer xfer;
+};
+
+struct gateway_cache
+{
+    rt_uint8_t valid;
+    rt_uint8_t key[GATEWAY_KEY_LENGTH];
+    rt_tick_t tick;
+    int len;
+    rt_uint8_t rsp[WIFI_GATEWAY_CACHE_SIZE];
+};
+
+static const struct gateway_route route_table[] = {
+    {2, 247, 0},
+};
+
+static struct gateway_request requests[WIFI_GATEWAY_REQUEST_NUM] = {0};
+static struct gateway_cache caches[WIFI_GATEWAY_CACHE_NUM] = {0};
+static int cache_victim = 0;
+/**
+ * 每个从机的写代数, 写请求提交和完成时各加一.
+ * 请求数有限且总线按顺序执行, 一个读请求期间的增加次数远小于回绕周期
+ */
+static rt_uint8_t slave_write_gen[256] = {0};
+static rt_uint8_t rsp_buf[AGILE_MODBUS_TCP_MAX_ADU_LENGTH];
+
+static rt_uint32_t request_cnt = 0;
+static rt_uint32_t cache_hit_cnt = 0;
+static rt_uint32_t merge_cnt = 0;
+static rt_uint32_t fail_cnt = 0;
+
+static int gateway_route_get(int unit_id)
+{
+    for (int i = 0; i < sizeof(route_table) / sizeof(route_table[0]); i++)
+    {
+        if((unit_id >= route_table[i].unit_min) && (unit_id <= route_table[i].unit_max))
+            return route_table[i].slave ? route_table[i].slave : unit_id;
+    }
+
+    return -1;
+}
+
+static int gateway_is_read(int function)
+{
+    switch(function)
+    {
+        case AGILE_MODBUS_FC_READ_COILS:
+        case AGILE_MODBUS_FC_READ_DISCRETE_INPUTS:
+        case AGILE_MODBUS_FC_READ_HOLDING_REGISTERS:
+        case AGILE_MODBUS_FC_READ_INPUT_REGISTERS:
+            return 1;
+
+        default:
+        break;
+    }
+
+    return 0;
+}
+
+static struct gateway_cache *gateway_cache_find(const rt_uint8_t *key)
+{
+    if(WIFI_GATEWAY_CACHE_TTL <= 0)
+        return RT_NULL;
+
+    for (int i = 0; i < WIFI_GATEWAY_CACHE_NUM; i++)
+    {
+        struct gateway_cache *cache = &caches[i];
+
+        if(!cache->valid || memcmp(cache->key, key, GATEWAY_KEY_LENGTH))
+            continue;
+
+        if((rt_tick_get() - cache->tick) >= rt_tick_from_millisecond(WIFI_GATEWAY_CACHE_TTL))
+        {
+            cache->valid = 0;
+            continue;
+        }
+
+        return cache;
+    }
+
+    return RT_NULL;
+}
+
+static void gateway_cache_store(const rt_uint8_t *key, rt_uint8_t write_gen, const rt_uint8_t *rsp, int len)
+{
+    if((WIFI_GATEWAY_CACHE_TTL <= 0) || (len > WIFI_GATEWAY_CACHE_SIZE))
+        return;
+
+    /* 读请求执行期间有写操作提交或完成, 结果可能是写之前的值 */
+    if(slave_write_gen[key[0]] != write_gen)
+        return;
+
+    struct gateway_cache *cache = RT_NULL;
+
+    for (int i = 0; i < WIFI_GATEWAY_CACHE_NUM; i++)
+    {
+        if(!caches[i].valid || !memcmp(caches[i].key, key, GATEWAY_KEY_LENGTH))
+        {
+            cache = &caches[i];
+            break;
+        }
+    }
+
+    if(cache == RT_NULL)
+    {
+        cache = &caches[cache_victim];
+        cache_victim = (cache_victim + 1) % WIFI_GATEWAY_CACHE_NUM;
+    }
+
+    cache->valid = 1;
+    rt_memcpy(cache->key, key, GATEWAY_KEY_LENGTH);
+    cache->tick = rt_tick_get();
+    cache->len = len;
+    rt_memcpy(cache->rsp, rsp, len);
+}
+
+/* 写操作后该从机的缓存全部失效 */
+static void gateway_cache_invalidate(int slave)
+{
+    slave_write_gen[slave]++;
+
+    for (int i = 0; i < WIFI_GATEWAY_CACHE_NUM; i++)
+    {
+        if(caches[i].key[0] == slave)
+            caches[i].valid = 0;
+    }
+}
+
+/* pdu 为 功能码 + 数据, 请求所在的连接已关闭时丢弃 (link_id 可能已被新连接复用) */
+static int gateway_reply(struct wifi_session *session, int link_id, rt_uint32_t generation, int tid, int unit_id,
+                         const rt_uint8_t *pdu, int pdu_len)
+{
+    if((session->link_id != link_id) || (session->generation != generation) ||
+       (session->state != WIFI_SESSION_STATE_CONNECTED))
+        return RT_EOK;
+
+    int len = 0;
+    rsp_buf[len++] = tid >> 8;
+    rsp_buf[len++] = tid & 0xFF;
+    rsp_buf[len++] = 0x00;
+    rsp_buf[len++] = 0x00;
+    rsp_buf[len++] = (pdu_len + 1) >> 8;
+    rsp_buf[len++] = (pdu_len + 1) & 0xFF;
+    rsp_buf[len++] = unit_id;
+    rt_memcpy(rsp_buf + len, pdu, pdu_len);
+    len += pdu_len;
+
+    if(wifi_session_send(session, rsp_buf, len) != len)
+        return -RT_ERROR;
+
+    return RT_EOK;
+}
+
+static int gateway_reply_exception(struct wifi_session *session, int link_id, rt_uint32_t generation, int tid,
+                                   int unit_id, int function, int code)
+{
+    rt_uint8_t pdu[2];
+
+    pdu[0] = function | 0x80;
+    pdu[1] = code;
+
+    return gateway_reply(session, link_id, generation, tid, unit_id, pdu, sizeof(pdu));
+}
+
+/**
+ * 未回复的请求计入会话的在途数量, 连接在 reactor 线程中建立或关闭时清零,
+ * 只处理请求所在的连接
+ */
+static void gateway_pending_inc(struct gateway_request *request)
+{
+    struct wifi_session *session = request->session;
+
+    rt_base_t level = rt_hw_interrupt_disable();
+    if(session->generation == request->generation)
+        session->gateway_pending++;
+    rt_hw_interrupt_enable(level);
+}
+
+static void gateway_pending_dec(struct gateway_request *request)
+{
+    struct wifi_session *session = request->session;
+    int resume = 0;
+
+    rt_base_t level = rt_hw_interrupt_disable();
+    if((session->generation == request->generation) && (session->gateway_pending > 0))
+    {
+        session->gateway_pending--;
+        resume = (session->recv_queue.count > 0);
+    }
+    rt_hw_interrupt_enable(level);
+
+    /* 被预算暂停的会话继续处理请求 */
+    if(resume)
+        wifi_session_ready(session);
+}
+
+/* reactor 线程中调用, 回复在 wifi 线程中发送 */
+static void gateway_xfer_done(rtu_master_xfer_t xfer)
+{
+    struct gateway_request *request = (struct gateway_request *)xfer->user_data;
+
+    request->state = GATEWAY_REQUEST_DONE;
+    wifi_net_wakeup();
+}
+
+static struct gateway_request *gateway_request_alloc(void)
+{
+    for (int i = 0; i < WIFI_GATEWAY_REQUEST_NUM; i++)
+    {
+        if(requests[i].state == GATEWAY_REQUEST_FREE)
+            return &requests[i];
+    }
+
+    return RT_NULL;
+}
+
+/* 在同一从机的写请求之前提交的读请求不能合并, 其结果可能是写之前的值 */
+static struct gateway_request *gateway_request_find_leader(const rt_uint8_t *key)
+{
+    for (int i = 0; i < WIFI_GATEWAY_REQUEST_NUM; i++)
+    {
+        struct gateway_request *request = &requests[i];
+
+        if((request->state == GATEWAY_REQUEST_QUEUED) && request->is_read &&
+           (request->write_gen == slave_write_gen[key[0]]) &&
+           !memcmp(request->key, key, GATEWAY_KEY_LENGTH))
+            return request;
+    }
+
+    return RT_NULL;
+}
+
+int wifi_gateway_request(struct wifi_session *session, const rt_uint8_t *adu, int adu_len)
+{
+    if(adu_len < MBAP_HEADER_LENGTH + 1)
+        return -RT_ERROR;
+
+    int tid = (adu[0] << 8) | adu[1];
+    int protocol = (adu[2] << 8) | adu[3];
+    int length = (adu[4] << 8) | adu[5];
+    int unit_id = adu[6];
+    int function = adu[7];
+    int pdu_len = adu_len - MBAP_HEADER_LENGTH;
+
+    if((protocol != 0) || (length != adu_len - 6) || (pdu_len > AGILE_MODBUS_MAX_PDU_LENGTH))
+        return -RT_ERROR;
+
+    request_cnt++;
+
+    int slave = gateway_route_get(unit_id);
+    if(slave < 0)
+        return gateway_reply_exception(session, session->link_id, session->generation, tid, unit_id, function,
+                                       GATEWAY_EXCEPTION_PATH_UNAVAILABLE);
+
+    rt_uint8_t key[GATEWAY_KEY_LENGTH];
+    int is_read = gateway_is_read(function) && (pdu_len == GATEWAY_KEY_LENGTH - 1);
+    if(is_read)
+    {
+        key[0] = slave;
+        rt_memcpy(key + 1, adu + MBAP_HEADER_LENGTH, GATEWAY_KEY_LENGTH - 1);
+
+        struct gateway_cache *cache = gateway_cache_find(key);
+        if(cache)
+        {
+            cache_hit_cnt++;
+            return gateway_reply(session, session->link_id, session->generation, tid, unit_id, cache->rsp, cache->len);
+        }
+    }
+    else if(slave != AGILE_MODBUS_BROADCAST_ADDRESS)
+    {
+        gateway_cache_invalidate(slave);
+    }
+
+    struct gateway_request *request = gateway_request_alloc();
+    if(request == RT_NULL)
+        return gateway_reply_exception(session, session->link_id, session->generation, tid, unit_id, function,
+                                       GATEWAY_EXCEPTION_BUSY);
+
+    request->session = session;
+    request->link_id = session->link_id;
+    request->generation = session->generation;
+    request->tid = tid;
+    request->unit_id = unit_id;
+    request->slave = slave;
+    request->function = function;
+    request->is_read = is_read;
+    request->write_gen = slave_write_gen[slave];
+    if(is_read)
+        rt_memcpy(request->key, key, GATEWAY_KEY_LENGTH);
+    request->leader = RT_NULL;
+
+    /* 相同的读请求只在总线上执行一次 */
+    if(is_read)
+    {
+        struct gateway_request *leader = gateway_request_find_leader(key);
+        if(leader)
+        {
+            merge_cnt++;
+            request->leader = leader;
+            request->state = GATEWAY_REQUEST_WAIT;
+            gateway_pending_inc(request);
+            return RT_EOK;
+        }
+    }
+
+    request->xfer.buf[0] = slave;
+    rt_memcpy(request->xfer.buf + 1, adu + MBAP_HEADER_LENGTH, pdu_len);
+    request->xfer.len = pdu_len + 1;
+    request->xfer.done = gateway_xfer_done;
+    request->xfer.user_data = request;
+    request->state = GATEWAY_REQUEST_QUEUED;
+
+    if(rtu_master_xfer_submit(&(request->xfer)) != RT_EOK)
+    {
+        request->state = GATEWAY_REQUEST_FREE;
+        return gateway_reply_exception(session, session->link_id, session->generation, tid, unit_id, function,
+                                       GATEWAY_EXCEPTION_PATH_UNAVAILABLE);
+    }
+
+    gateway_pending_inc(request);
+
+    return RT_EOK;
+}
+
+static void gateway_request_complete(struct gateway_request *request, int result, const rt_uint8_t *rsp)
+{
+    struct wifi_session *session = request->session;
+    int rc = RT_EOK;
+
+    if(result > 1)
+        rc = gateway_reply(session, request->link_id, request->generation, request->tid, request->unit_id,
+                           rsp + 1, result - 1);
+    else if(result < 0)
+        rc = gateway_reply_exception(session, request->link_id, request->generation, request->tid, request->unit_id,
+                                     request->function, GATEWAY_EXCEPTION_TARGET_FAILED);
+
+    if(rc != RT_EOK)
+        LOG_W("socket (%d) reply failed.", request->link_id);
+
+    request->state = GATEWAY_REQUEST_FREE;
+    gateway_pending_dec(request);
+}
+
+/* wifi 线程中调用, 发送已完成的请求的回复 */
+void wifi_gateway_process(void)
+{
+    for (int i = 0; i < WIFI_GATEWAY_REQUEST_NUM; i++)
+    {
+        struct gateway_request *leader = &requests[i];
+        if(leader->state != GATEWAY_REQUEST_DONE)
+            continue;
+
+        int result = leader->xfer.result;
+        const rt_uint8_t *rsp = leader->xfer.buf;
+
+        if(result < 0)
+        {
+            fail_cnt++;
+            LOG_W("unit (%d) function (%d) failed (%d).", leader->unit_id, leader->function, result);
+        }
+        else if(leader->is_read && (result > 1) && (rsp[1] == leader->function))
+        {
+            /* 只缓存正常响应 */
+            gateway_cache_store(leader->key, leader->write_gen, rsp + 1, result - 1);
+        }
+
+        /* 写请求完成时再次失效, 写执行期间提交的读请求结果不缓存 */
+        if(!leader->is_read && (leader->slave != AGILE_MODBUS_BROADCAST_ADDRESS))
+            gateway_cache_invalidate(leader->slave);
+
+        for (int j = 0; j < WIFI_GATEWAY_REQUEST_NUM; j++)
+        {
+            struct gateway_request *request = &requests[j];
+
+            if((request->state == GATEWAY_REQUEST_WAIT) && (request->leader == leader))
+                gateway_request_complete(request, result, rsp);
+        }
+
+        gateway_request_complete(leader, result, rsp);
+    }
+}
+
+static int wifi_gateway_info(void)
+{
+    LOG_I("request:%u, cache hit:%u, merge:%u, fail:%u", request_cnt, cache_hit_cnt, merge_cnt, fail_cnt);
+
+    return RT_EOK;
+}
+MSH_CMD_EXPORT(wifi_gateway_info, wifi modbus gateway statistics);
+
+#endif /* WIFI_GATEWAY_USING */
@@ -0,0 +1,202 @@
+#include "wifi_queue.h"
+#include <rthw.h>
+
+void wifi_queue_pool_init(wifi_queue_pool_t pool, rt_uint8_t *buf, wifi_queue_blk_t blk_set,
+                          rt_size_t small_size, rt_size_t small_num, rt_size_t large_size, rt_size_t large_num)
+{
+    RT_ASSERT(pool);
+    RT_ASSERT(buf);
+    RT_ASSERT(blk_set);
+    RT_ASSERT(small_num + large_num < WIFI_QUEUE_BLK_NONE);
+    RT_ASSERT(small_size <= large_size);
+
+    small_size = RT_ALIGN(small_size, RT_ALIGN_SIZE);
+    large_size = RT_ALIGN(large_size, RT_ALIGN_SIZE);
+
+    pool->blk_set = blk_set;
+    pool->small_num = small_num;
+    pool->blk_num = small_num + large_num;
+    pool->free_small = small_num ? 0 : WIFI_QUEUE_BLK_NONE;
+    pool->free_large = large_num ? small_num : WIFI_QUEUE_BLK_NONE;
+
+    for (int i = 0; i < pool->blk_num; i++)
+    {
+        int last = (i < small_num) ? (small_num - 1) : (pool->blk_num - 1);
+
+        blk_set[i].buf = buf;
+        blk_set[i].size = 0;
+        blk_set[i].cap = (i < small_num) ? small_size : large_size;
+        blk_set[i].next = (i == last) ? WIFI_QUEUE_BLK_NONE : (i + 1);
+        buf += blk_set[i].cap;
+    }
+}
+
+void wifi_queue_init(wifi_queue_t queue)
+{
+    RT_ASSERT(queue);
+
+    queue->head = WIFI_QUEUE_BLK_NONE;
+    queue->tail = WIFI_QUEUE_BLK_NONE;
+    queue->count = 0;
+    queue->bytes = 0;
+    queue->cap = 0;
+}
+
+static wifi_queue_blk_t _wifi_queue_take(wifi_queue_pool_t pool, rt_uint8_t *free_head)
+{
+    wifi_queue_blk_t block = &(pool->blk_set[*free_head]);
+
+    *free_head = block->next;
+    block->next = WIFI_QUEUE_BLK_NONE;
+
+    return block;
+}
+
+/* 需关中断调用 */
+static void _wifi_queue_free(wifi_queue_pool_t pool, wifi_queue_blk_t block)
+{
+    rt_uint8_t index = block - pool->blk_set;
+    rt_uint8_t *free_head = (index < pool->small_num) ? &(pool->free_small) : &(pool->free_large);
+
+    block->size = 0;
+    block->next = *free_head;
+    *free_head = index;
+}
+
+/* 可在中断中调用 */
+wifi_queue_blk_t wifi_queue_alloc(wifi_queue_pool_t pool, rt_size_t size)
+{
+    RT_ASSERT(pool);
+
+    wifi_queue_blk_t block = RT_NULL;
+
+    if(size == 0)
+        return RT_NULL;
+
+    rt_base_t level = rt_hw_interrupt_disable();
+
+    if((pool->free_small != WIFI_QUEUE_BLK_NONE) && (size <= pool->blk_set[pool->free_small].cap))
+        block = _wifi_queue_take(pool, &(pool->free_small));
+    else if((pool->free_large != WIFI_QUEUE_BLK_NONE) && (size <= pool->blk_set[pool->free_large].cap))
+        block = _wifi_queue_take(pool, &(pool->free_large));
+
+    if(block)
+        block->size = size;
+
+    rt_hw_interrupt_enable(level);
+
+    return block;
+}
+
+/* 释放已申请但未入队的块 */
+void wifi_queue_cancel(wifi_queue_pool_t pool, wifi_queue_blk_t block)
+{
+    RT_ASSERT(pool);
+    RT_ASSERT(block);
+
+    rt_base_t level = rt_hw_interrupt_disable();
+    _wifi_queue_free(pool, block);
+    rt_hw_interrupt_enable(level);
+}
+
+void wifi_queue_push(wifi_queue_pool_t pool, wifi_queue_t queue, wifi_queue_blk_t block)
+{
+    RT_ASSERT(pool);
+    RT_ASSERT(queue);
+    RT_ASSERT(block);
+
+    rt_uint8_t index = block - pool->blk_set;
+
+    rt_base_t level = rt_hw_interrupt_disable();
+
+    block->next = WIFI_QUEUE_BLK_NONE;
+    if(queue->tail == WIFI_QUEUE_BLK_NONE)
+        queue->head = index;
+    else
+        pool->blk_set[queue->tail].next = index;
+    queue->tail = index;
+    queue->count++;
+    queue->bytes += block->size;
+    queue->cap += block->cap;
+
+    rt_hw_interrupt_enable(level);
+}
+
+wifi_queue_blk_t wifi_queue_peek(wifi_queue_pool_t pool, wifi_queue_t queue, rt_size_t index)
+{
+    RT_ASSERT(pool);
+    RT_ASSERT(queue);
+
+    wifi_queue_blk_t block = RT_NULL;
+
+    rt_base_t level = rt_hw_interrupt_disable();
+
+    rt_uint8_t blk_index = queue->head;
+    while((blk_index != WIFI_QUEUE_BLK_NONE) && index)
+    {
+        blk_index = pool->blk_set[blk_index].next;
+        index--;
+    }
+
+    if(blk_index != WIFI_QUEUE_BLK_NONE)
+        block = &(pool->blk_set[blk_index]);
+
+    rt_hw_interrupt_enable(level);
+
+    return block;
+}
+
+/* 取出队首块, 块不再属于队列, 处理完后由调用者 wifi_queue_cancel 释放 */
+wifi_queue_blk_t wifi_queue_take(wifi_queue_pool_t pool, wifi_queue_t queue)
+{
+    RT_ASSERT(pool);
+    RT_ASSERT(queue);
+
+    wifi_queue_blk_t block = RT_NULL;
+
+    rt_base_t level = rt_hw_interrupt_disable();
+
+    if(queue->head != WIFI_QUEUE_BLK_NONE)
+    {
+        block = &(pool->blk_set[queue->head]);
+
+        queue->head = block->next;
+        if(queue->head == WIFI_QUEUE_BLK_NONE)
+            queue->tail = WIFI_QUEUE_BLK_NONE;
+        queue->count--;
+        queue->bytes -= block->size;
+        queue->cap -= block->cap;
+        block->next = WIFI_QUEUE_BLK_NONE;
+    }
+
+    rt_hw_interrupt_enable(level);
+
+    return block;
+}
+
+void wifi_queue_pop(wifi_queue_pool_t pool, wifi_queue_t queue)
+{
+    RT_ASSERT(pool);
+    RT_ASSERT(queue);
+
+    rt_base_t level = rt_hw_interrupt_disable();
+
+    wifi_queue_blk_t block = wifi_queue_take(pool, queue);
+    if(block)
+        _wifi_queue_free(pool, block);
+
+    rt_hw_interrupt_enable(level);
+}
+
+void wifi_queue_clean(wifi_queue_pool_t pool, wifi_queue_t queue)
+{
+    RT_ASSERT(pool);
+    RT_ASSERT(queue);
+
+    rt_base_t level = rt_hw_interrupt_disable();
+
+    while(queue->head != WIFI_QUEUE_BLK_NONE)
+        wifi_queue_pop(pool, queue);
+
+    rt_hw_interrupt_enable(level);
+}
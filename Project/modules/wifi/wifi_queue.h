@@ -0,0 +1,63 @@
+#ifndef __WIFI_QUEUE_H
+#define __WIFI_QUEUE_H
+#include <rtthread.h>
+
+#define WIFI_QUEUE_BLK_NONE             0xFF
+
+/**
+ * 多个队列共享的定长块池.
+ * 块分大小两种, 小块放一般的请求和响应, 小块用完或数据放不下时用大块.
+ * 块按任意顺序释放都能立即重新使用, 单个队列积压不会占住其他队列的空间.
+ */
+struct wifi_queue_blk
+{
+    rt_uint8_t *buf;
+    /* 数据长度 */
+    rt_uint16_t size;
+    /* 块大小 */
+    rt_uint16_t cap;
+    /* 同一队列或空闲链表中的下一个块 */
+    rt_uint8_t next;
+};
+typedef struct wifi_queue_blk *wifi_queue_blk_t;
+
+struct wifi_queue_pool
+{
+    /* 前 small_num 个为小块 */
+    struct wifi_queue_blk *blk_set;
+    rt_uint8_t small_num;
+    rt_uint8_t blk_num;
+    rt_uint8_t free_small;
+    rt_uint8_t free_large;
+};
+typedef struct wifi_queue_pool *wifi_queue_pool_t;
+
+struct wifi_queue
+{
+    rt_uint8_t head;
+    rt_uint8_t tail;
+    rt_uint16_t count;
+    /* 数据字节数 */
+    rt_size_t bytes;
+    /* 占用块池的字节数, 用于配额 */
+    rt_size_t cap;
+};
+typedef struct wifi_queue *wifi_queue_t;
+
+/* 块池缓冲区大小 */
+#define WIFI_QUEUE_POOL_BUFSZ(small_size, small_num, large_size, large_num) \
+    (RT_ALIGN(small_size, RT_ALIGN_SIZE) * (small_num) + RT_ALIGN(large_size, RT_ALIGN_SIZE) * (large_num))
+
+void wifi_queue_pool_init(wifi_queue_pool_t pool, rt_uint8_t *buf, wifi_queue_blk_t blk_set,
+                          rt_size_t small_size, rt_size_t small_num, rt_size_t large_size, rt_size_t large_num);
+void wifi_queue_init(wifi_queue_t queue);
+
+wifi_queue_blk_t wifi_queue_alloc(wifi_queue_pool_t pool, rt_size_t size);
+void wifi_queue_cancel(wifi_queue_pool_t pool, wifi_queue_blk_t block);
+void wifi_queue_push(wifi_queue_pool_t pool, wifi_queue_t queue, wifi_queue_blk_t block);
+wifi_queue_blk_t wifi_queue_peek(wifi_queue_pool_t pool, wifi_queue_t queue, rt_size_t index);
+wifi_queue_blk_t wifi_queue_take(wifi_queue_pool_t pool, wifi_queue_t queue);
+void wifi_queue_pop(wifi_queue_pool_t pool, wifi_queue_t queue);
+void wifi_queue_clean(wifi_queue_pool_t pool, wifi_queue_t queue);
+
+#endif
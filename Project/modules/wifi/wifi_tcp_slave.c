@@ -3,9 +3,80 @@
 
 #define SLAVE_ADDR  1
 
+/* 非法数据地址 */
+#define EXCEPTION_ILLEGAL_DATA_ADDRESS  0x02
+
+/* 读响应缓存, 只缓存不超过 RSP_CACHE_ADU_SIZE 的响应 */
+#define RSP_CACHE_NUM       4
+#define RSP_CACHE_ADU_SIZE  64
+
+struct rsp_cache
+{
+    rt_uint8_t valid;
+    rt_uint8_t slave;
+    rt_uint8_t function;
+    rt_uint16_t address;
+    rt_uint16_t nb;
+    rt_uint32_t generation;
+    int rsp_len;
+    rt_uint8_t rsp[RSP_CACHE_ADU_SIZE];
+};
+
 static rt_uint8_t ctx_send_buf[AGILE_MODBUS_MAX_ADU_LENGTH];
 static rt_uint8_t ctx_read_buf[AGILE_MODBUS_MAX_ADU_LENGTH];
 static rt_uint16_t hold_registers[10] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+/* 寄存器每次修改后加 1, 旧的缓存随之失效 */
+static rt_uint32_t hold_registers_generation = 0;
+static struct rsp_cache rsp_caches[RSP_CACHE_NUM] = {0};
+static int rsp_cache_victim = 0;
+
+static struct rsp_cache *rsp_cache_find(int slave, int function, int address, int nb)
+{
+    for (int i = 0; i < RSP_CACHE_NUM; i++)
+    {
+        struct rsp_cache *cache = &rsp_caches[i];
+
+        if(cache->valid && (cache->generation == hold_registers_generation) &&
+           (cache->slave == slave) && (cache->function == function) &&
+           (cache->address == address) && (cache->nb == nb))
+            return cache;
+    }
+
+    return RT_NULL;
+}
+
+static void rsp_cache_store(int slave, int function, int address, int nb, const rt_uint8_t *rsp, int rsp_len)
+{
+    if(rsp_len > RSP_CACHE_ADU_SIZE)
+        return;
+
+    struct rsp_cache *cache = RT_NULL;
+
+    /* 优先使用已失效的缓存 */
+    for (int i = 0; i < RSP_CACHE_NUM; i++)
+    {
+        if(!rsp_caches[i].valid || (rsp_caches[i].generation != hold_registers_generation))
+        {
+            cache = &rsp_caches[i];
+            break;
+        }
+    }
+
+    if(cache == RT_NULL)
+    {
+        cache = &rsp_caches[rsp_cache_victim];
+        rsp_cache_victim = (rsp_cache_victim + 1) % RSP_CACHE_NUM;
+    }
+
+    cache->valid = 1;
+    cache->slave = slave;
+    cache->function = function;
+    cache->address = address;
+    cache->nb = nb;
+    cache->generation = hold_registers_generation;
+    cache->rsp_len = rsp_len;
+    rt_memcpy(cache->rsp, rsp, rsp_len);
+}
 
 static int _modbus_slave_process(agile_modbus_t *ctx, int msg_length)
 {
@@ -41,6 +112,16 @@ static int _modbus_slave_process(agile_modbus_t *ctx, int msg_length)
                 return -1;
             if ((address + nb) > 0x10000)
                 return -1;
+
+            /* 命中时只替换 MBAP 中的事务号 */
+            struct rsp_cache *cache = rsp_cache_find(slave, function, address, nb);
+            if(cache)
+            {
+                rt_memcpy(ctx->send_buf, cache->rsp, cache->rsp_len);
+                ctx->send_buf[0] = sft.t_id >> 8;
+                ctx->send_buf[1] = sft.t_id & 0xFF;
+                return cache->rsp_len;
+            }
             
             rsp_length = ctx->backend->build_response_basis(&sft, ctx->send_buf);
             ctx->send_buf[rsp_length++] = nb << 1;
@@ -57,6 +138,36 @@ static int _modbus_slave_process(agile_modbus_t *ctx, int msg_length)
             }
 
             rsp_length = ctx->backend->send_msg_pre(ctx->send_buf, rsp_length);
+            rsp_cache_store(slave, function, address, nb, ctx->send_buf, rsp_length);
+        }
+        break;
+
+        case AGILE_MODBUS_FC_WRITE_SINGLE_REGISTER:
+        {
+            uint16_t data = (ctx->read_buf[offset + 3] << 8) + ctx->read_buf[offset + 4];
+
+            /* 没有存储的地址回显会让主站认为写入成功 */
+            if(address >= sizeof(hold_registers) / sizeof(hold_registers[0]))
+            {
+                sft.function = function | 0x80;
+                rsp_length = ctx->backend->build_response_basis(&sft, ctx->send_buf);
+                ctx->send_buf[rsp_length++] = EXCEPTION_ILLEGAL_DATA_ADDRESS;
+                rsp_length = ctx->backend->send_msg_pre(ctx->send_buf, rsp_length);
+                break;
+            }
+
+            if(hold_registers[address] != data)
+            {
+                hold_registers[address] = data;
+                hold_registers_generation++;
+            }
+
+            rsp_length = ctx->backend->build_response_basis(&sft, ctx->send_buf);
+            ctx->send_buf[rsp_length++] = address >> 8;
+            ctx->send_buf[rsp_length++] = address & 0xFF;
+            ctx->send_buf[rsp_length++] = data >> 8;
+            ctx->send_buf[rsp_length++] = data & 0xFF;
+            rsp_length = ctx->backend->send_msg_pre(ctx->send_buf, rsp_length);
         }
         break;
 
@@ -71,6 +182,12 @@ int wifi_session_process(struct wifi_session *session, rt_uint8_t *recv_buf, int
 {
     if((recv_len <= 0) || (recv_len > sizeof(ctx_read_buf)))
         return -RT_ERROR;
+
+#ifdef WIFI_GATEWAY_USING
+    /* 其他单元标识的请求由网关转发 */
+    if((recv_len > 6) && (recv_buf[6] != SLAVE_ADDR))
+        return wifi_gateway_request(session, recv_buf, recv_len);
+#endif
     
     agile_modbus_tcp_t ctx_tcp;
     agile_modbus_tcp_init(&ctx_tcp, ctx_send_buf, sizeof(ctx_send_buf), ctx_read_buf, sizeof(ctx_read_buf));
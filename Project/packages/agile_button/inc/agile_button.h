@@ -2,6 +2,7 @@
 #define __PKG_AGILE_BUTTON_H
 #include <rtthread.h>
 #include "drv_gpio.h"
+#include "reactor.h"
 #include <stdint.h>
 
 #ifdef __cplusplus
@@ -32,6 +33,7 @@ typedef struct agile_btn agile_btn_t;
 struct agile_btn
 {
     uint8_t active;                                            // 激活标志
+    uint8_t irq_mode;                                          // 使用引脚中断检测电平变化, 否则定时扫描
     uint8_t repeat_cnt;                                        // 按键重按计数
     uint8_t elimination_time;                                  // 按键消抖时间(单位ms,默认15ms)
     enum agile_btn_event event;                                // 按键对象事件
@@ -44,7 +46,7 @@ struct agile_btn
     rt_tick_t tick_timeout;                                    // 超时时间
     void (*event_cb[BTN_EVENT_SUM])(agile_btn_t *btn);         // 按键对象事件回调函数
     void (*hook)(agile_btn_t *btn);                            // 按键钩子回调函数
-    rt_slist_t slist;                                          // 单向链表节点
+    struct reactor_timer timer;                                // 扫描和消抖定时器
 };
 
 // 初始化按键对象
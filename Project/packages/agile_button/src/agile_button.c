@@ -10,14 +10,9 @@
 #endif
 #include <rtdbg.h>
 
-// agile_button 线程堆栈大小
-#ifndef PKG_AGILE_BUTTON_THREAD_STACK_SIZE
-#define PKG_AGILE_BUTTON_THREAD_STACK_SIZE 512
-#endif
-
-// agile_button 线程优先级
-#ifndef PKG_AGILE_BUTTON_THREAD_PRIORITY
-#define PKG_AGILE_BUTTON_THREAD_PRIORITY RT_THREAD_PRIORITY_MAX - 2
+// 按键扫描周期 5ms, 引脚不支持中断时使用
+#ifndef PKG_AGILE_BUTTON_SCAN_TIME
+#define PKG_AGILE_BUTTON_SCAN_TIME 5
 #endif
 
 // 按键消抖默认时间 15ms
@@ -40,17 +35,19 @@
     } \
 } while(0)
 
-ALIGN(RT_ALIGN_SIZE)
-// agile_button 线程
-static rt_uint8_t agile_button_stack[PKG_AGILE_BUTTON_THREAD_STACK_SIZE];
-static struct rt_thread agile_button_thread;
-// agile_button 单向链表
-static rt_slist_t agile_btn_list = RT_SLIST_OBJECT_INIT(agile_btn_list);
 // agile_button 互斥锁
 static struct rt_mutex lock_mtx;
 // agile_button 初始化完成标志
 static uint8_t is_initialized = 0;
 
+static void btn_timer_handler(reactor_timer_t timer);
+
+// 每次电平变化重新开始消抖, 消抖结束后处理
+static void btn_pin_irq_handler(void *args)
+{
+    agile_btn_t *btn = args;
+    reactor_timer_start(&(btn->timer), btn->elimination_time);
+}
 
 int agile_btn_init(agile_btn_t *btn, rt_base_t pin, rt_base_t active_logic, rt_base_t pin_mode)
 {
@@ -72,7 +69,7 @@ int agile_btn_init(agile_btn_t *btn, rt_base_t pin, rt_base_t active_logic, rt_b
     btn->pin = pin;
     btn->active_logic = active_logic;
     btn->tick_timeout = rt_tick_get();
-    rt_slist_init(&(btn->slist));
+    reactor_timer_init(&(btn->timer), btn_timer_handler, btn);
 
     drv_pin_mode(pin, pin_mode);
 
@@ -94,8 +91,16 @@ int agile_btn_start(agile_btn_t *btn)
     btn->hold_time = 0;
     btn->prev_hold_time = 0;
     btn->tick_timeout = rt_tick_get();
-    rt_slist_append(&(agile_btn_list), &(btn->slist));
     btn->active = 1;
+    btn->irq_mode = 0;
+    if(drv_pin_attach_irq(btn->pin, PIN_IRQ_MODE_RISING_FALLING, btn_pin_irq_handler, btn) == RT_EOK)
+    {
+        if(drv_pin_irq_enable(btn->pin, PIN_IRQ_ENABLE) == RT_EOK)
+            btn->irq_mode = 1;
+        else
+            drv_pin_detach_irq(btn->pin);
+    }
+    reactor_timer_start(&(btn->timer), btn->irq_mode ? btn->elimination_time : 0);
     rt_mutex_release(&lock_mtx);
     return RT_EOK;
 }
@@ -109,8 +114,13 @@ int agile_btn_stop(agile_btn_t *btn)
         rt_mutex_release(&lock_mtx);
         return RT_EOK;
     }
-    rt_slist_remove(&(agile_btn_list), &(btn->slist));
-    btn->slist.next = RT_NULL;
+    if(btn->irq_mode)
+    {
+        drv_pin_irq_enable(btn->pin, PIN_IRQ_DISABLE);
+        drv_pin_detach_irq(btn->pin);
+        btn->irq_mode = 0;
+    }
+    reactor_timer_stop(&(btn->timer));
     btn->active = 0;
     rt_mutex_release(&lock_mtx);
     return RT_EOK;
@@ -168,103 +178,117 @@ static void agile_btn_cal_hold_time(agile_btn_t *btn)
     btn->hold_time = btn->hold_time * (1000 / RT_TICK_PER_SECOND);
 }
 
-static void btn_process(void *parameter)
+static void agile_btn_press_down(agile_btn_t *btn)
+{
+    btn->hold_time = 0;
+    btn->prev_hold_time = 0;
+    btn->repeat_cnt++;
+    btn->event = BTN_PRESS_DOWN_EVENT;
+    AGILE_BUTTON_EVENT_CB(btn, btn->event);
+
+    btn->tick_timeout = rt_tick_get();
+    btn->state = BTN_STATE_PRESS_HOLD;
+}
+
+// 按键状态机, 在 reactor 线程中运行.
+// 中断模式下只在电平变化消抖结束和按住期间的 BTN_HOLD_EVENT 时运行, 否则按扫描周期检测引脚
+static void btn_timer_handler(reactor_timer_t timer)
 {
-    rt_slist_t *node;
-    while (1)
+    agile_btn_t *btn = timer->user_data;
+    rt_int32_t next_time;
+
+    rt_mutex_take(&lock_mtx, RT_WAITING_FOREVER);
+    if(!btn->active)
     {
-        rt_mutex_take(&lock_mtx, RT_WAITING_FOREVER);
-        rt_slist_for_each(node, &(agile_btn_list))
-        {
-            agile_btn_t *btn = rt_slist_entry(node, agile_btn_t, slist);
-            if(btn->hook)
-                btn->hook(btn);
+        rt_mutex_release(&lock_mtx);
+        return;
+    }
 
-            switch (btn->state)
-            {
-            case BTN_STATE_NONE_PRESS:
-            {
-                if (AGILE_BUTTON_PIN_STATE(btn) == btn->active_logic)
-                {
-                    btn->tick_timeout = rt_tick_get() + rt_tick_from_millisecond(btn->elimination_time);
-                    btn->state = BTN_STATE_CHECK_PRESS;
-                }
-                else
-                {
-                    // 2次按下中间间隔过大，清零重按计数
-                    if (btn->repeat_cnt)
-                    {
-                        if ((rt_tick_get() - btn->tick_timeout) < (RT_TICK_MAX / 2))
-                        {
-                            btn->repeat_cnt = 0;
-                        }
-                    }
-                }
-            }
-            break;
-            case BTN_STATE_CHECK_PRESS:
+    next_time = btn->irq_mode ? -1 : PKG_AGILE_BUTTON_SCAN_TIME;
+
+    if(btn->hook)
+        btn->hook(btn);
+
+    switch (btn->state)
+    {
+    case BTN_STATE_NONE_PRESS:
+    {
+        // 2次按下中间间隔过大，清零重按计数
+        if (btn->repeat_cnt)
+        {
+            if ((rt_tick_get() - btn->tick_timeout) < (RT_TICK_MAX / 2))
             {
-                if (AGILE_BUTTON_PIN_STATE(btn) == btn->active_logic)
-                {
-                    if ((rt_tick_get() - btn->tick_timeout) < (RT_TICK_MAX / 2))
-                    {
-                        btn->state = BTN_STATE_PRESS_DOWN;
-                    }
-                }
-                else
-                {
-                    btn->state = BTN_STATE_NONE_PRESS;
-                }
+                btn->repeat_cnt = 0;
             }
-            break;
-            case BTN_STATE_PRESS_DOWN:
-            {
-                btn->hold_time = 0;
-                btn->prev_hold_time = 0;
-                btn->repeat_cnt++;
-                btn->event = BTN_PRESS_DOWN_EVENT;
-                AGILE_BUTTON_EVENT_CB(btn, btn->event);
+        }
 
-                btn->tick_timeout = rt_tick_get();
-                btn->state = BTN_STATE_PRESS_HOLD;
-            }
+        if (AGILE_BUTTON_PIN_STATE(btn) != btn->active_logic)
             break;
-            case BTN_STATE_PRESS_HOLD:
-            {
-                if (AGILE_BUTTON_PIN_STATE(btn) == btn->active_logic)
-                {
-                    agile_btn_cal_hold_time(btn);
-                    if (btn->hold_time - btn->prev_hold_time >= btn->hold_cycle_time)
-                    {
-                        btn->event = BTN_HOLD_EVENT;
-                        AGILE_BUTTON_EVENT_CB(btn, btn->event);
-                        btn->prev_hold_time = btn->hold_time;
-                    }
-                }
-                else
-                {
-                    btn->state = BTN_STATE_PRESS_UP;
-                }
-            }
+
+        if (btn->irq_mode)
+        {
+            // 电平变化后已经过消抖时间
+            agile_btn_press_down(btn);
+            next_time = btn->hold_cycle_time;
+        }
+        else
+        {
+            btn->tick_timeout = rt_tick_get() + rt_tick_from_millisecond(btn->elimination_time);
+            btn->state = BTN_STATE_CHECK_PRESS;
+            next_time = btn->elimination_time;
+        }
+    }
+    break;
+    case BTN_STATE_CHECK_PRESS:
+    {
+        if (AGILE_BUTTON_PIN_STATE(btn) != btn->active_logic)
+        {
+            btn->state = BTN_STATE_NONE_PRESS;
             break;
-            case BTN_STATE_PRESS_UP:
+        }
+
+        // 消抖结束仍为按下
+        agile_btn_press_down(btn);
+    }
+    break;
+    case BTN_STATE_PRESS_HOLD:
+    {
+        if (AGILE_BUTTON_PIN_STATE(btn) == btn->active_logic)
+        {
+            agile_btn_cal_hold_time(btn);
+            if (btn->hold_time - btn->prev_hold_time >= btn->hold_cycle_time)
             {
-                btn->event = BTN_PRESS_UP_EVENT;
+                btn->event = BTN_HOLD_EVENT;
                 AGILE_BUTTON_EVENT_CB(btn, btn->event);
-                btn->event = BTN_CLICK_EVENT;
-                AGILE_BUTTON_EVENT_CB(btn, btn->event);
-
-                btn->tick_timeout = rt_tick_get() + rt_tick_from_millisecond(AGILE_BUTTON_TWO_INTERVAL_TIME_DEFAULT);
-                btn->state = BTN_STATE_NONE_PRESS;
+                btn->prev_hold_time = btn->hold_time;
             }
+            // 定时到下一次 BTN_HOLD_EVENT
+            if (btn->irq_mode)
+                next_time = btn->hold_cycle_time - (btn->hold_time - btn->prev_hold_time);
             break;
-            default:
-                break;
-            }
         }
-        rt_mutex_release(&lock_mtx);
-        rt_thread_mdelay(5);
+
+        // 中断模式下按住期间不一定更新过按下时间
+        agile_btn_cal_hold_time(btn);
+        btn->state = BTN_STATE_PRESS_UP;
+        btn->event = BTN_PRESS_UP_EVENT;
+        AGILE_BUTTON_EVENT_CB(btn, btn->event);
+        btn->event = BTN_CLICK_EVENT;
+        AGILE_BUTTON_EVENT_CB(btn, btn->event);
+
+        btn->tick_timeout = rt_tick_get() + rt_tick_from_millisecond(AGILE_BUTTON_TWO_INTERVAL_TIME_DEFAULT);
+        btn->state = BTN_STATE_NONE_PRESS;
     }
+    break;
+    default:
+        btn->state = BTN_STATE_NONE_PRESS;
+        break;
+    }
+
+    // 回调中可能停止了按键
+    if(btn->active && (next_time >= 0))
+        reactor_timer_start(&(btn->timer), next_time);
+    rt_mutex_release(&lock_mtx);
 }
 
 
@@ -272,16 +296,6 @@ static int agile_btn_env_init(void)
 {
     rt_mutex_init(&lock_mtx, "btn_mtx", RT_IPC_FLAG_FIFO);
 
-    rt_thread_init(&agile_button_thread,
-                   "agile_btn",
-                   btn_process,
-                   RT_NULL,
-                   &agile_button_stack[0],
-                   sizeof(agile_button_stack),
-                   PKG_AGILE_BUTTON_THREAD_PRIORITY,
-                   100);
-    rt_thread_startup(&agile_button_thread);
-    
     is_initialized = 1;
     return RT_EOK;
 }
@@ -2,6 +2,7 @@
 #define __PKG_AGILE_LED_H
 #include <rtthread.h>
 #include "drv_gpio.h"
+#include "reactor.h"
 #include <stdint.h>
 
 #ifdef __cplusplus
@@ -21,9 +22,11 @@ struct agile_led
     uint32_t arr_index;                              // 数组索引
     int32_t loop_init;                               // 循环次数
     int32_t loop_cnt;                                // 循环次数计数
-    rt_tick_t tick_timeout;                          // 超时时间
     void (*compelete)(agile_led_t *led);             // 操作完成回调函数
-    rt_slist_t slist;                                // 单向链表节点
+    struct reactor_timer timer;                      // 下一步的定时器
+    uint8_t hw;                                      // 由定时器硬件输出, 此时 on/off/toggle 无效
+    uint32_t start_gen;                              // 每次启动加 1
+    uint32_t hw_done_gen;                            // 硬件输出完成时的启动序号
 };
 
 // 初始化led对象
@@ -1,4 +1,5 @@
 #include <agile_led.h>
+#include "drv_led_tim.h"
 #include <stdlib.h>
 #include <string.h>
 
@@ -12,28 +13,22 @@
 #endif
 #include <rtdbg.h>
 
-// agile_led 线程堆栈大小
-#ifndef PKG_AGILE_LED_THREAD_STACK_SIZE
-#define PKG_AGILE_LED_THREAD_STACK_SIZE 256
-#endif
-
-// agile_led 线程优先级
-#ifndef PKG_AGILE_LED_THREAD_PRIORITY
-#define PKG_AGILE_LED_THREAD_PRIORITY RT_THREAD_PRIORITY_MAX - 2
-#endif
-
-ALIGN(RT_ALIGN_SIZE)
-// agile_led 线程
-static rt_uint8_t agile_led_stack[PKG_AGILE_LED_THREAD_STACK_SIZE];
-static struct rt_thread agile_led_thread;
-// agile_led 单向链表
-static rt_slist_t agile_led_list = RT_SLIST_OBJECT_INIT(agile_led_list);
 // agile_led 互斥锁
 static struct rt_mutex lock_mtx;
 // agile_led 初始化完成标志
 static uint8_t is_initialized = 0;
 
 
+static void led_timer_handler(reactor_timer_t timer);
+
+// 定时器输出完成, 在中断中调用, 转到 reactor 线程中处理
+static void led_hw_compelete(void *args)
+{
+    agile_led_t *led = args;
+    led->hw_done_gen = led->start_gen;
+    reactor_timer_start(&(led->timer), 0);
+}
+
 static void agile_led_default_compelete_callback(agile_led_t *led)
 {
     RT_ASSERT(led);
@@ -57,9 +52,8 @@ int agile_led_init(agile_led_t *led, rt_base_t pin, rt_base_t active_logic, cons
     led->arr_index = 0;
     led->loop_init = loop_cnt;
     led->loop_cnt = led->loop_init;
-    led->tick_timeout = rt_tick_get();
     led->compelete = agile_led_default_compelete_callback;
-    rt_slist_init(&(led->slist));
+    reactor_timer_init(&(led->timer), led_timer_handler, led);
 
     drv_pin_mode(pin, PIN_MODE_OUTPUT);
     drv_pin_write(pin, !active_logic);
@@ -83,9 +77,18 @@ int agile_led_start(agile_led_t *led)
     }
     led->arr_index = 0;
     led->loop_cnt = led->loop_init;
-    led->tick_timeout = rt_tick_get();
-    rt_slist_append(&(agile_led_list), &(led->slist));
     led->active = 1;
+    led->start_gen++;
+    // 引脚有定时器通道时由硬件输出, 否则按步骤软件定时
+    if((led->loop_cnt != 0) &&
+       (drv_led_tim_start(led->pin, led->active_logic, led->light_arr, led->arr_num, led->loop_cnt, led_hw_compelete, led) == RT_EOK))
+    {
+        led->hw = 1;
+    }
+    else
+    {
+        reactor_timer_start(&(led->timer), 0);
+    }
     rt_mutex_release(&lock_mtx);
     return RT_EOK;
 }
@@ -99,8 +102,14 @@ int agile_led_stop(agile_led_t *led)
         rt_mutex_release(&lock_mtx);
         return RT_EOK;
     }
-    rt_slist_remove(&(agile_led_list), &(led->slist));
-    led->slist.next = RT_NULL;
+    if(led->hw)
+    {
+        drv_led_tim_stop(led->pin);
+        led->hw = 0;
+        drv_pin_mode(led->pin, PIN_MODE_OUTPUT);
+        agile_led_off(led);
+    }
+    reactor_timer_stop(&(led->timer));
     led->active = 0;
     rt_mutex_release(&lock_mtx);
     return RT_EOK;
@@ -115,7 +124,11 @@ int agile_led_set_light_mode(agile_led_t *led, const uint32_t *light_array, int
     led->arr_index = 0;
     led->loop_init = loop_cnt;
     led->loop_cnt = led->loop_init;
-    led->tick_timeout = rt_tick_get();
+    if(led->active)
+    {
+        agile_led_stop(led);
+        agile_led_start(led);
+    }
     rt_mutex_release(&lock_mtx);
     return RT_EOK;
 }
@@ -147,57 +160,60 @@ void agile_led_off(agile_led_t *led)
     drv_pin_write(led->pin, !led->active_logic);
 }
 
-static void led_process(void *parameter)
+// 执行到下一个非 0 的步骤并定时, 在 reactor 线程中运行
+static void led_timer_handler(reactor_timer_t timer)
 {
-    rt_slist_t *node;
-    while (1)
+    agile_led_t *led = timer->user_data;
+    int wrap_cnt = 0;
+
+    rt_mutex_take(&lock_mtx, RT_WAITING_FOREVER);
+    // 硬件输出只在完成时触发. 等待锁期间可能已重新启动, 上一次的完成不能结束新的输出
+    if(led->active && led->hw)
+    {
+        if(led->hw_done_gen != led->start_gen)
+        {
+            rt_mutex_release(&lock_mtx);
+            return;
+        }
+        led->loop_cnt = 0;
+    }
+    while(led->active)
     {
-        rt_mutex_take(&lock_mtx, RT_WAITING_FOREVER);
-        rt_slist_for_each(node, &(agile_led_list))
+        // 数组全为 0 时没有可执行的步骤, 按完成处理
+        if((led->loop_cnt == 0) || (wrap_cnt > 1))
+        {
+            agile_led_stop(led);
+            if(led->compelete)
+            {
+                led->compelete(led);
+            }
+            break;
+        }
+        if(led->arr_index < led->arr_num)
         {
-            agile_led_t *led = rt_slist_entry(node, agile_led_t, slist);
-            if(led->loop_cnt == 0)
+            if (led->light_arr[led->arr_index] == 0)
             {
-                agile_led_stop(led);
-                if(led->compelete)
-                {
-                    led->compelete(led);
-                }
-                node = &agile_led_list;
+                led->arr_index++;
                 continue;
             }
-        __repeat:
-            if((rt_tick_get() - led->tick_timeout) < (RT_TICK_MAX / 2))
+            if(led->arr_index % 2)
+            {
+                agile_led_off(led);
+            }
+            else
             {
-                if(led->arr_index < led->arr_num)
-                {
-                    if (led->light_arr[led->arr_index] == 0)
-                    {
-                        led->arr_index++;
-                        goto __repeat;
-                    }
-                    if(led->arr_index % 2)
-                    {
-                        agile_led_off(led);
-                    }
-                    else
-                    {
-                        agile_led_on(led);
-                    }
-                    led->tick_timeout = rt_tick_get() + rt_tick_from_millisecond(led->light_arr[led->arr_index]);
-                    led->arr_index++;
-                }
-                else
-                {
-                    led->arr_index = 0;
-                    if(led->loop_cnt > 0)
-                        led->loop_cnt--;
-                }
+                agile_led_on(led);
             }
+            reactor_timer_start(&(led->timer), led->light_arr[led->arr_index]);
+            led->arr_index++;
+            break;
         }
-        rt_mutex_release(&lock_mtx);
-        rt_thread_mdelay(5);
+        led->arr_index = 0;
+        if(led->loop_cnt > 0)
+            led->loop_cnt--;
+        wrap_cnt++;
     }
+    rt_mutex_release(&lock_mtx);
 }
 
 
@@ -205,16 +221,6 @@ static int agile_led_env_init(void)
 {
     rt_mutex_init(&lock_mtx, "led_mtx", RT_IPC_FLAG_FIFO);
 
-    rt_thread_init(&agile_led_thread,
-                   "agile_led",
-                   led_process,
-                   RT_NULL,
-                   &agile_led_stack[0],
-                   sizeof(agile_led_stack),
-                   PKG_AGILE_LED_THREAD_PRIORITY,
-                   100);
-    rt_thread_startup(&agile_led_thread);
-
     is_initialized = 1;
     return RT_EOK;
 }
@@ -0,0 +1,235 @@
+/*
+ * ulog 日志头格式化对比
+ *
+ * 直接包含 ulog.c, 按工程默认配置 (颜色 + tick + 等级 + 标签) 编译.
+ * ulog_formater_ref 为加入日志头缓存前的格式化方式: 每条日志用除法转换 tick,
+ * 颜色、等级和标签逐个 ulog_strcpy.
+ * 先检查两者在 tick 边界、超长标签、各等级以及同一缓冲区中的标签内容改变时输出一致,
+ * 再分别统计每秒格式化的行数.
+ *
+ * 参数: 统计的行数, 默认 200000
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <rtthread.h>
+
+/* 与目标板一致, rt_memcpy 和 rt_strlen 为 kservice.c 中的函数, 不由编译器内联 */
+#undef rt_memcpy
+#undef rt_strlen
+void *rt_memcpy(void *dst, const void *src, rt_ubase_t count);
+rt_size_t rt_strlen(const char *s);
+
+#define RT_USING_ULOG
+#define ULOG_OUTPUT_LVL                 LOG_LVL_DBG
+#define ULOG_RBB_BUFSZ                  4096
+#define ULOG_LINE_BUF_SIZE              256
+#define ULOG_USING_COLOR
+#define ULOG_OUTPUT_TIME
+#define ULOG_OUTPUT_LEVEL
+#define ULOG_OUTPUT_TAG
+#define ULOG_HDR_CACHE_NUM              8
+
+#include "ulog.c"
+
+static rt_tick_t now = 0;
+static char line[ULOG_LINE_BUF_SIZE + 1];
+static char line_ref[ULOG_LINE_BUF_SIZE + 1];
+
+rt_tick_t rt_tick_get(void)
+{
+    return now;
+}
+
+rt_uint8_t rt_interrupt_get_nest(void)
+{
+    return 0;
+}
+
+__attribute__((noinline)) void *rt_memcpy(void *dst, const void *src, rt_ubase_t count)
+{
+    char *tmp = (char *)dst, *s = (char *)src;
+
+    while (count--)
+        *tmp++ = *s++;
+
+    return dst;
+}
+
+__attribute__((noinline)) rt_size_t rt_strlen(const char *s)
+{
+    const char *sc;
+
+    for (sc = s; *sc != '\0'; ++sc)
+        ;
+
+    return sc - s;
+}
+
+static size_t ulog_ultoa_ref(char *s, unsigned long int n)
+{
+    size_t i = 0, j = 0, len = 0;
+    char swap;
+
+    do
+    {
+        s[len++] = n % 10 + '0';
+    } while (n /= 10);
+    s[len] = '\0';
+    /* reverse string */
+    for (i = 0, j = len - 1; i < j; ++i, --j)
+    {
+        swap = s[i];
+        s[i] = s[j];
+        s[j] = swap;
+    }
+    return len;
+}
+
+static rt_size_t ulog_formater_ref(char *log_buf, rt_uint32_t level, const char *tag, rt_bool_t newline,
+        const char *format, va_list args)
+{
+    rt_size_t log_len, newline_len, tick_len;
+    int fmt_result;
+
+    log_len = 0;
+    newline_len = rt_strlen(ULOG_NEWLINE_SIGN);
+
+    if (color_output_info[level])
+    {
+        log_len += ulog_strcpy(log_len, log_buf + log_len, CSI_START);
+        log_len += ulog_strcpy(log_len, log_buf + log_len, color_output_info[level]);
+    }
+
+    log_buf[log_len] = '[';
+    tick_len = ulog_ultoa_ref(log_buf + log_len + 1, rt_tick_get());
+    log_buf[log_len + 1 + tick_len] = ']';
+    log_buf[log_len + 1 + tick_len + 1] = '\0';
+    log_len += rt_strlen(log_buf + log_len);
+
+    log_len += ulog_strcpy(log_len, log_buf + log_len, " ");
+    log_len += ulog_strcpy(log_len, log_buf + log_len, level_output_info[level]);
+    log_len += ulog_strcpy(log_len, log_buf + log_len, tag);
+    log_len += ulog_strcpy(log_len, log_buf + log_len, ": ");
+
+    fmt_result = rt_vsnprintf(log_buf + log_len, ULOG_LINE_BUF_SIZE - log_len, format, args);
+    if ((log_len + fmt_result <= ULOG_LINE_BUF_SIZE) && (fmt_result > -1))
+        log_len += fmt_result;
+    else
+        log_len = ULOG_LINE_BUF_SIZE;
+
+    if (log_len + (sizeof(CSI_END) - 1) + newline_len > ULOG_LINE_BUF_SIZE)
+        log_len = ULOG_LINE_BUF_SIZE - (sizeof(CSI_END) - 1) - newline_len;
+
+    if (newline)
+        log_len += ulog_strcpy(log_len, log_buf + log_len, ULOG_NEWLINE_SIGN);
+
+    if (color_output_info[level])
+        log_len += ulog_strcpy(log_len, log_buf + log_len, CSI_END);
+
+    return log_len;
+}
+
+static rt_size_t format_line(int ref, rt_uint32_t level, const char *tag, const char *format, ...)
+{
+    va_list args;
+    rt_size_t len;
+
+    va_start(args, format);
+    if (ref)
+        len = ulog_formater_ref(line_ref, level, tag, RT_TRUE, format, args);
+    else
+        len = ulog_formater(line, level, tag, RT_TRUE, format, args);
+    va_end(args);
+
+    return len;
+}
+
+static int compare(const char *tag, rt_uint32_t level, int arg)
+{
+    rt_size_t len = format_line(0, level, tag, "v=%d", arg);
+    rt_size_t len_ref = format_line(1, level, tag, "v=%d", arg);
+
+    if ((len != len_ref) || memcmp(line, line_ref, len))
+    {
+        printf("tick %u, level %u, tag %s:\n  %.*s  %.*s", now, level, tag, (int)len, line, (int)len_ref, line_ref);
+        return -1;
+    }
+
+    return 0;
+}
+
+static double bench(int ref, long num)
+{
+    static const char *tags[] = {"wifi", "rtu_master", "reactor", "console"};
+    struct timespec t0, t1;
+    volatile rt_size_t sink = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (long i = 0; i < num; i++)
+    {
+        /* 每毫秒 8 条日志 */
+        now = 123456 + i / 8;
+        sink += format_line(ref, LOG_LVL_INFO + (i & 1), tags[i & 3], "x");
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    return num / ((t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9);
+}
+
+int main(int argc, char **argv)
+{
+    static const char *tags[] = {"wifi", "a_very_long_tag_name_that_exceeds_the_cache_segment", "r", ""};
+    static const rt_tick_t ticks[] = {0, 1, 9, 10, 999, 1000, 1001, 1010, 1100, 9999, 10000, 123456,
+                                      4294967295u, 4294967000u, 1000000000u};
+    static const rt_uint32_t levels[] = {LOG_LVL_ASSERT, LOG_LVL_ERROR, LOG_LVL_WARNING, LOG_LVL_INFO, LOG_LVL_DBG};
+    static const char *tag_texts[] = {"abc", "xyz", "abcd", "ab", "abc"};
+    long num = (argc > 1) ? strtol(argv[1], RT_NULL, 0) : 200000;
+    double before, after;
+    char tag_buf[16];
+
+    ulog_init();
+
+    for (int i = 0; i < sizeof(ticks) / sizeof(ticks[0]); i++)
+    {
+        for (int t = 0; t < 4; t++)
+        {
+            for (int l = 0; l < sizeof(levels) / sizeof(levels[0]); l++)
+            {
+                now = ticks[i];
+                if (compare(tags[t], levels[l], i))
+                    return 1;
+            }
+        }
+    }
+
+    for (now = 0; now < 300000; now += 7)
+    {
+        if (compare(tags[now & 3], LOG_LVL_INFO, now))
+            return 1;
+    }
+
+    /* 标签缓冲区地址不变, 内容改变 */
+    for (int i = 0; i < sizeof(tag_texts) / sizeof(tag_texts[0]); i++)
+    {
+        strcpy(tag_buf, tag_texts[i]);
+        if (compare(tag_buf, LOG_LVL_INFO, i))
+            return 1;
+    }
+
+    /* 交替运行, 各取最好的一次 */
+    before = after = 0;
+    for (int i = 0; i < 5; i++)
+    {
+        double v = bench(1, num);
+        if (v > before)
+            before = v;
+        v = bench(0, num);
+        if (v > after)
+            after = v;
+    }
+    printf("before: %.0f lines/s\nafter:  %.0f lines/s\n", before, after);
+
+    return 0;
+}
@@ -0,0 +1,316 @@
+/*
+ * wifi 收发路径压力测试
+ *
+ * 直接包含 esp_sim.c, 与 wifi、at_client、reactor、usr_device 一起在主机上运行:
+ * wifi 线程按原流程复位、初始化 ESP8266 并监听, esp_sim 的客户端连接后闭环发送 Modbus TCP 请求.
+ * 等到第一个事务完成后清零统计, 运行指定时间, 输出每秒事务数和延时分位数.
+ *
+ * RT-Thread 的线程用 pthread 模拟, 同一时刻只有一个线程持有 cpu_lock 运行,
+ * 只在等待事件、信号量和延时时让出, 因此关中断可以为空操作.
+ * 与目标板不同, 高优先级线程不会抢占, reactor 在 wifi 线程阻塞时才处理收发,
+ * 结果只用于对比 wifi 路径修改前后的差异, 不代表板上的数值.
+ *
+ * 参数: 统计的时间(ms), 默认 2000
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "esp_sim.c"
+#include "drv_gpio.h"
+#include "init_module.h"
+#include "main_hook.h"
+
+#define CONNECT_TIMEOUT     20000
+
+static pthread_mutex_t cpu_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cpu_cond;
+static struct timespec start_ts;
+static __thread rt_thread_t cur_thread = RT_NULL;
+static struct rt_thread main_thread = {"main"};
+
+static struct init_module *app_module = RT_NULL;
+static struct main_hook_module *hook_module = RT_NULL;
+
+extern const init_fn_t __start_rti_fn_1[] __attribute__((weak));
+extern const init_fn_t __stop_rti_fn_1[] __attribute__((weak));
+extern const init_fn_t __start_rti_fn_2[] __attribute__((weak));
+extern const init_fn_t __stop_rti_fn_2[] __attribute__((weak));
+
+rt_tick_t rt_tick_get(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (ts.tv_sec - start_ts.tv_sec) * 1000 + (ts.tv_nsec - start_ts.tv_nsec) / 1000000;
+}
+
+rt_tick_t rt_tick_from_millisecond(rt_int32_t ms)
+{
+    return ms;
+}
+
+rt_uint8_t rt_interrupt_get_nest(void)
+{
+    return 0;
+}
+
+rt_thread_t rt_thread_self(void)
+{
+    return cur_thread;
+}
+
+/* 让出 cpu_lock 直到被唤醒或到达 deadline, timeout 小于 0 时一直等待 */
+static void cpu_wait(rt_tick_t deadline, rt_int32_t timeout)
+{
+    struct timespec ts = start_ts;
+
+    if (timeout < 0)
+    {
+        pthread_cond_wait(&cpu_cond, &cpu_lock);
+        return;
+    }
+
+    ts.tv_sec += deadline / 1000;
+    ts.tv_nsec += (deadline % 1000) * 1000000;
+    if (ts.tv_nsec >= 1000000000)
+    {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000;
+    }
+    pthread_cond_timedwait(&cpu_cond, &cpu_lock, &ts);
+}
+
+static int tick_reached(rt_tick_t deadline)
+{
+    return (rt_tick_get() - deadline) < (RT_TICK_MAX / 2);
+}
+
+rt_err_t rt_thread_mdelay(rt_int32_t ms)
+{
+    rt_tick_t deadline = rt_tick_get() + ms;
+
+    do
+    {
+        cpu_wait(deadline, ms);
+    } while (!tick_reached(deadline));
+
+    return RT_EOK;
+}
+
+rt_err_t rt_sem_init(rt_sem_t sem, const char *name, rt_uint32_t value, rt_uint8_t flag)
+{
+    sem->value = value;
+    return RT_EOK;
+}
+
+rt_err_t rt_sem_take(rt_sem_t sem, rt_int32_t time)
+{
+    rt_tick_t deadline = rt_tick_get() + time;
+
+    while (sem->value == 0)
+    {
+        if ((time == 0) || ((time > 0) && tick_reached(deadline)))
+            return -RT_ETIMEOUT;
+
+        cpu_wait(deadline, time);
+    }
+
+    sem->value--;
+    return RT_EOK;
+}
+
+rt_err_t rt_sem_release(rt_sem_t sem)
+{
+    sem->value++;
+    pthread_cond_broadcast(&cpu_cond);
+    return RT_EOK;
+}
+
+rt_err_t rt_sem_control(rt_sem_t sem, int cmd, void *arg)
+{
+    if (cmd == RT_IPC_CMD_RESET)
+        sem->value = 0;
+
+    return RT_EOK;
+}
+
+rt_err_t rt_event_init(rt_event_t event, const char *name, rt_uint8_t flag)
+{
+    event->set = 0;
+    return RT_EOK;
+}
+
+rt_err_t rt_event_send(rt_event_t event, rt_uint32_t set)
+{
+    event->set |= set;
+    pthread_cond_broadcast(&cpu_cond);
+    return RT_EOK;
+}
+
+rt_err_t rt_event_recv(rt_event_t event, rt_uint32_t set, rt_uint8_t option, rt_int32_t timeout, rt_uint32_t *recved)
+{
+    rt_tick_t deadline = rt_tick_get() + timeout;
+
+    while (1)
+    {
+        rt_uint32_t match = event->set & set;
+
+        if ((option & RT_EVENT_FLAG_AND) ? (match == set) : (match != 0))
+        {
+            if (recved)
+                *recved = match;
+            if (option & RT_EVENT_FLAG_CLEAR)
+                event->set &= ~match;
+            return RT_EOK;
+        }
+
+        if ((timeout == 0) || ((timeout > 0) && tick_reached(deadline)))
+            return -RT_ETIMEOUT;
+
+        cpu_wait(deadline, timeout);
+    }
+}
+
+rt_err_t rt_event_control(rt_event_t event, int cmd, void *arg)
+{
+    if (cmd == RT_IPC_CMD_RESET)
+        event->set = 0;
+
+    return RT_EOK;
+}
+
+static void *thread_entry(void *parameter)
+{
+    rt_thread_t thread = (rt_thread_t)parameter;
+
+    pthread_mutex_lock(&cpu_lock);
+    cur_thread = thread;
+    thread->entry(thread->parameter);
+    pthread_mutex_unlock(&cpu_lock);
+
+    return NULL;
+}
+
+rt_err_t rt_thread_init(rt_thread_t thread, const char *name, void (*entry)(void *parameter), void *parameter,
+                        void *stack_start, rt_uint32_t stack_size, rt_uint8_t priority, rt_uint32_t tick)
+{
+    rt_strncpy(thread->name, name, RT_NAME_MAX);
+    thread->entry = entry;
+    thread->parameter = parameter;
+    return RT_EOK;
+}
+
+rt_err_t rt_thread_startup(rt_thread_t thread)
+{
+    pthread_t tid;
+
+    if (pthread_create(&tid, NULL, thread_entry, thread))
+        return -RT_ERROR;
+
+    pthread_detach(tid);
+    return RT_EOK;
+}
+
+/* 只有重新配网时使用, 测试中不会调用 */
+rt_err_t rt_thread_detach(rt_thread_t thread)
+{
+    return -RT_ENOSYS;
+}
+
+void drv_pin_mode(rt_base_t pin, rt_base_t mode)
+{
+}
+
+void drv_pin_write(rt_base_t pin, rt_base_t value)
+{
+}
+
+void init_module_app_register(struct init_module *module)
+{
+    app_module = module;
+}
+
+void main_hook_module_register(struct main_hook_module *module)
+{
+    hook_module = module;
+}
+
+static void init_level_run(const init_fn_t *start, const init_fn_t *stop)
+{
+    for (const init_fn_t *fn = start; fn < stop; fn++)
+        (*fn)();
+}
+
+/* 与 main 线程一样定期调用钩子, 直到 deadline 或 cond 成立 */
+static int main_run(rt_tick_t deadline, int (*cond)(void))
+{
+    while (!tick_reached(deadline))
+    {
+        if (cond && cond())
+            return 1;
+
+        if (hook_module)
+            hook_module->hook();
+        rt_thread_mdelay(10);
+    }
+
+    return 0;
+}
+
+static int trans_started(void)
+{
+    return esp_sim.stat.trans_cnt > 0;
+}
+
+int main(int argc, char **argv)
+{
+    long duration = (argc > 1) ? strtol(argv[1], RT_NULL, 0) : 2000;
+    pthread_condattr_t attr;
+    struct esp_sim_stat stat;
+    rt_tick_t elapsed;
+
+    clock_gettime(CLOCK_MONOTONIC, &start_ts);
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&cpu_cond, &attr);
+
+    pthread_mutex_lock(&cpu_lock);
+    cur_thread = &main_thread;
+
+    init_level_run(__start_rti_fn_1, __stop_rti_fn_1);
+    init_level_run(__start_rti_fn_2, __stop_rti_fn_2);
+    if (app_module == RT_NULL)
+    {
+        printf("wifi module is not registered\n");
+        return 1;
+    }
+    app_module->init();
+
+    if (!main_run(rt_tick_get() + CONNECT_TIMEOUT, trans_started))
+    {
+        printf("no transaction in %d ms\n", CONNECT_TIMEOUT);
+        return 1;
+    }
+
+    esp_sim_stat_reset();
+    main_run(rt_tick_get() + duration, RT_NULL);
+
+    stat = esp_sim.stat;
+    elapsed = rt_tick_get() - stat.start_tick;
+
+    printf("clients: %d, time: %u ms, trans: %u, timeout: %u, error: %u\n", ESP_SIM_CLIENT_NUM, elapsed,
+           stat.trans_cnt, stat.timeout_cnt, stat.error_cnt);
+    printf("tps: %.1f\n", stat.trans_cnt * 1000.0 / (elapsed ? elapsed : 1));
+    if (stat.trans_cnt > 0)
+    {
+        printf("latency(ms) p50: %u, p90: %u, p99: %u (%u means >= %u)\n",
+               esp_sim_percentile(stat.trans_cnt, 50), esp_sim_percentile(stat.trans_cnt, 90),
+               esp_sim_percentile(stat.trans_cnt, 99), ESP_SIM_HIST_SIZE - 1, ESP_SIM_HIST_SIZE - 1);
+    }
+
+    /* 其他线程一直阻塞在 cpu_lock 上, 直接退出 */
+    return ((stat.trans_cnt > 0) && (stat.timeout_cnt == 0) && (stat.error_cnt == 0)) ? 0 : 1;
+}
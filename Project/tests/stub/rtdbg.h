@@ -0,0 +1,9 @@
+#ifndef RT_DBG_H__
+#define RT_DBG_H__
+
+#define LOG_D(...)
+#define LOG_I(...)
+#define LOG_W(...)
+#define LOG_E(...)
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef __RT_HW_H__
+#define __RT_HW_H__
+#include <rtthread.h>
+
+/* 主机测试单线程运行或同一时刻只有一个线程运行, 中断由测试直接调用处理函数模拟 */
+static inline rt_base_t rt_hw_interrupt_disable(void)
+{
+    return 0;
+}
+
+static inline void rt_hw_interrupt_enable(rt_base_t level)
+{
+    (void)level;
+}
+
+#endif
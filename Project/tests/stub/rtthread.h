@@ -0,0 +1,304 @@
+/*
+ * 主机测试用的 rtthread.h, 只提供被测模块用到的类型和函数
+ */
+#ifndef __RT_THREAD_H__
+#define __RT_THREAD_H__
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+typedef int8_t                          rt_int8_t;
+typedef int16_t                         rt_int16_t;
+typedef int32_t                         rt_int32_t;
+typedef uint8_t                         rt_uint8_t;
+typedef uint16_t                        rt_uint16_t;
+typedef uint32_t                        rt_uint32_t;
+typedef uint64_t                        rt_uint64_t;
+typedef long                            rt_base_t;
+typedef unsigned long                   rt_ubase_t;
+typedef int                             rt_bool_t;
+typedef rt_base_t                       rt_err_t;
+typedef rt_ubase_t                      rt_size_t;
+typedef rt_uint32_t                     rt_tick_t;
+typedef rt_base_t                       rt_off_t;
+
+#define RT_TICK_MAX                     UINT32_MAX
+#define RT_WAITING_FOREVER              -1
+#define RT_WAITING_NO                   0
+
+#define RT_IPC_FLAG_FIFO                0x00
+#define RT_IPC_FLAG_PRIO                0x01
+#define RT_IPC_CMD_RESET                0x01
+
+#define RT_EVENT_FLAG_AND               0x01
+#define RT_EVENT_FLAG_OR                0x02
+#define RT_EVENT_FLAG_CLEAR             0x04
+
+#define RT_TRUE                         1
+#define RT_FALSE                        0
+#define RT_NULL                         0
+
+#define RT_NAME_MAX                     8
+#define RT_TICK_PER_SECOND              1000
+
+#define RT_EOK                          0
+#define RT_ERROR                        1
+#define RT_ETIMEOUT                     2
+#define RT_EFULL                        3
+#define RT_EEMPTY                       4
+#define RT_ENOMEM                       5
+#define RT_ENOSYS                       6
+#define RT_EBUSY                        7
+#define RT_EIO                          8
+#define RT_EINTR                        9
+#define RT_EINVAL                       10
+
+#define RT_ALIGN_SIZE                   4
+#define RT_ALIGN(size, align)           (((size) + (align) - 1) & ~((align) - 1))
+#define RT_ALIGN_DOWN(size, align)      ((size) & ~((align) - 1))
+
+#define RT_ASSERT(EX)                   assert(EX)
+
+#define ALIGN(n)                        __attribute__((aligned(n)))
+#define RT_WEAK                         __attribute__((weak))
+#define rt_inline                       static inline
+
+/* 与 RT-Thread 一样按等级放入段中, 需要时由测试按 __start_/__stop_ 符号依次调用 */
+typedef int (*init_fn_t)(void);
+#define INIT_EXPORT(fn, level) \
+    __attribute__((used, section("rti_fn_" level))) static const init_fn_t __rt_init_##fn = fn
+#define INIT_BOARD_EXPORT(fn)           INIT_EXPORT(fn, "1")
+#define INIT_PREV_EXPORT(fn)            INIT_EXPORT(fn, "2")
+#define INIT_DEVICE_EXPORT(fn)          INIT_EXPORT(fn, "3")
+#define INIT_COMPONENT_EXPORT(fn)       INIT_EXPORT(fn, "4")
+#define INIT_ENV_EXPORT(fn)             INIT_EXPORT(fn, "5")
+#define INIT_APP_EXPORT(fn)             INIT_EXPORT(fn, "6")
+#define RTM_EXPORT(symbol)
+#define MSH_CMD_EXPORT(command, desc) \
+    __attribute__((used)) static const void *__rt_msh_##command = command
+
+#define rt_memset                       memset
+#define rt_memcpy                       memcpy
+#define rt_memmove                      memmove
+#define rt_memcmp                       memcmp
+#define rt_malloc                       malloc
+#define rt_free                         free
+#define rt_strlen                       strlen
+#define rt_strnlen                      strnlen
+#define rt_strstr                       strstr
+#define rt_strcmp                       strcmp
+#define rt_strncmp                      strncmp
+#define rt_vsnprintf                    vsnprintf
+
+/* RT-Thread 的 rt_snprintf 和 rt_kprintf 不做格式检查, 模块中 %X 输出 rt_size_t 不会告警 */
+static inline rt_int32_t rt_snprintf(char *buf, rt_size_t size, const char *fmt, ...)
+{
+    va_list args;
+    rt_int32_t n;
+
+    va_start(args, fmt);
+    n = vsnprintf(buf, size, fmt, args);
+    va_end(args);
+
+    return n;
+}
+
+static inline void rt_kprintf(const char *fmt, ...)
+{
+    va_list args;
+
+    va_start(args, fmt);
+    vprintf(fmt, args);
+    va_end(args);
+}
+
+static inline char *rt_strncpy(char *dst, const char *src, rt_ubase_t n)
+{
+    char *d = dst;
+
+    while (n && *src)
+    {
+        *d++ = *src++;
+        n--;
+    }
+    while (n--)
+        *d++ = 0;
+
+    return dst;
+}
+
+struct rt_list_node
+{
+    struct rt_list_node *next;
+    struct rt_list_node *prev;
+};
+typedef struct rt_list_node rt_list_t;
+
+#define rt_container_of(ptr, type, member) \
+    ((type *)((char *)(ptr) - (unsigned long)(&((type *)0)->member)))
+#define rt_list_entry(node, type, member) \
+    rt_container_of(node, type, member)
+
+static inline void rt_list_init(rt_list_t *l)
+{
+    l->next = l->prev = l;
+}
+
+static inline void rt_list_insert_after(rt_list_t *l, rt_list_t *n)
+{
+    l->next->prev = n;
+    n->next = l->next;
+    l->next = n;
+    n->prev = l;
+}
+
+static inline void rt_list_insert_before(rt_list_t *l, rt_list_t *n)
+{
+    l->prev->next = n;
+    n->prev = l->prev;
+    l->prev = n;
+    n->next = l;
+}
+
+static inline void rt_list_remove(rt_list_t *n)
+{
+    n->next->prev = n->prev;
+    n->prev->next = n->next;
+    n->next = n->prev = n;
+}
+
+static inline int rt_list_isempty(const rt_list_t *l)
+{
+    return l->next == l;
+}
+
+struct rt_slist_node
+{
+    struct rt_slist_node *next;
+};
+typedef struct rt_slist_node rt_slist_t;
+
+#define RT_SLIST_OBJECT_INIT(object)    { RT_NULL }
+
+#define rt_slist_entry(node, type, member) \
+    ((type *)((char *)(node) - offsetof(type, member)))
+
+static inline void rt_slist_init(rt_slist_t *l)
+{
+    l->next = RT_NULL;
+}
+
+static inline void rt_slist_append(rt_slist_t *l, rt_slist_t *n)
+{
+    while (l->next)
+        l = l->next;
+
+    l->next = n;
+    n->next = RT_NULL;
+}
+
+static inline void rt_slist_insert(rt_slist_t *l, rt_slist_t *n)
+{
+    n->next = l->next;
+    l->next = n;
+}
+
+static inline rt_slist_t *rt_slist_remove(rt_slist_t *l, rt_slist_t *n)
+{
+    while (l->next && l->next != n)
+        l = l->next;
+
+    if (l->next)
+        l->next = l->next->next;
+
+    return l;
+}
+
+static inline rt_slist_t *rt_slist_first(rt_slist_t *l)
+{
+    return l->next;
+}
+
+static inline rt_slist_t *rt_slist_next(rt_slist_t *n)
+{
+    return n->next;
+}
+
+static inline rt_slist_t *rt_slist_tail(rt_slist_t *l)
+{
+    while (l->next)
+        l = l->next;
+
+    return l;
+}
+
+static inline int rt_slist_isempty(rt_slist_t *l)
+{
+    return l->next == RT_NULL;
+}
+
+static inline unsigned int rt_slist_len(const rt_slist_t *l)
+{
+    unsigned int len = 0;
+
+    for (l = l->next; l; l = l->next)
+        len++;
+
+    return len;
+}
+
+#define rt_slist_for_each(pos, head) \
+    for (pos = (head)->next; pos != RT_NULL; pos = pos->next)
+
+#define rt_slist_first_entry(ptr, type, member) \
+    rt_slist_entry((ptr)->next, type, member)
+
+#define rt_slist_tail_entry(ptr, type, member) \
+    rt_slist_entry(rt_slist_tail(ptr), type, member)
+
+struct rt_thread
+{
+    char name[RT_NAME_MAX];
+    void (*entry)(void *parameter);
+    void *parameter;
+};
+typedef struct rt_thread *rt_thread_t;
+
+struct rt_event
+{
+    rt_uint32_t set;
+};
+typedef struct rt_event *rt_event_t;
+
+struct rt_semaphore
+{
+    rt_uint16_t value;
+};
+typedef struct rt_semaphore *rt_sem_t;
+
+/* 以下由使用到的测试实现 */
+rt_tick_t rt_tick_get(void);
+rt_tick_t rt_tick_from_millisecond(rt_int32_t ms);
+rt_err_t rt_thread_mdelay(rt_int32_t ms);
+rt_thread_t rt_thread_self(void);
+void rt_interrupt_enter(void);
+void rt_interrupt_leave(void);
+rt_uint8_t rt_interrupt_get_nest(void);
+rt_err_t rt_sem_init(rt_sem_t sem, const char *name, rt_uint32_t value, rt_uint8_t flag);
+rt_err_t rt_sem_take(rt_sem_t sem, rt_int32_t time);
+rt_err_t rt_sem_release(rt_sem_t sem);
+rt_err_t rt_sem_control(rt_sem_t sem, int cmd, void *arg);
+rt_err_t rt_event_init(rt_event_t event, const char *name, rt_uint8_t flag);
+rt_err_t rt_event_send(rt_event_t event, rt_uint32_t set);
+rt_err_t rt_event_recv(rt_event_t event, rt_uint32_t set, rt_uint8_t option, rt_int32_t timeout, rt_uint32_t *recved);
+rt_err_t rt_event_control(rt_event_t event, int cmd, void *arg);
+rt_err_t rt_thread_init(rt_thread_t thread, const char *name, void (*entry)(void *parameter), void *parameter,
+                        void *stack_start, rt_uint32_t stack_size, rt_uint8_t priority, rt_uint32_t tick);
+rt_err_t rt_thread_startup(rt_thread_t thread);
+rt_err_t rt_thread_detach(rt_thread_t thread);
+
+#endif
@@ -0,0 +1,75 @@
+/*
+ * 主机测试用的 HAL, 只有外设句柄和用到的常量, 函数由测试实现
+ */
+#ifndef __STM32F1xx_HAL_H
+#define __STM32F1xx_HAL_H
+#include <stdint.h>
+
+typedef enum
+{
+    HAL_OK = 0,
+    HAL_ERROR,
+    HAL_BUSY,
+    HAL_TIMEOUT
+} HAL_StatusTypeDef;
+
+typedef struct
+{
+    uint32_t Mode;
+    uint32_t Direction;
+    uint32_t DataSize;
+    uint32_t CLKPolarity;
+    uint32_t CLKPhase;
+    uint32_t NSS;
+    uint32_t BaudRatePrescaler;
+    uint32_t FirstBit;
+    uint32_t TIMode;
+    uint32_t CRCCalculation;
+    uint32_t CRCPolynomial;
+} SPI_InitTypeDef;
+
+typedef struct
+{
+    void *Instance;
+    SPI_InitTypeDef Init;
+} SPI_HandleTypeDef;
+
+typedef struct
+{
+    void *Instance;
+} DMA_HandleTypeDef;
+
+typedef struct
+{
+    void *Instance;
+} UART_HandleTypeDef;
+
+typedef struct
+{
+    uint32_t SR;
+} USART_TypeDef;
+
+#define SPI3                            ((void *)3)
+
+#define UART_PARITY_NONE                0
+#define UART_WORDLENGTH_8B              0
+#define UART_STOPBITS_1                 0
+
+#define SPI_MODE_MASTER                 0
+#define SPI_DIRECTION_2LINES            0
+#define SPI_DATASIZE_8BIT               0
+#define SPI_POLARITY_LOW                0
+#define SPI_PHASE_1EDGE                 0
+#define SPI_NSS_SOFT                    0
+#define SPI_BAUDRATEPRESCALER_4         0
+#define SPI_FIRSTBIT_MSB                0
+#define SPI_TIMODE_DISABLE              0
+#define SPI_CRCCALCULATION_DISABLE      0
+
+HAL_StatusTypeDef HAL_SPI_Init(SPI_HandleTypeDef *hspi);
+HAL_StatusTypeDef HAL_SPI_DeInit(SPI_HandleTypeDef *hspi);
+HAL_StatusTypeDef HAL_SPI_Abort(SPI_HandleTypeDef *hspi);
+HAL_StatusTypeDef HAL_SPI_Transmit_DMA(SPI_HandleTypeDef *hspi, uint8_t *pData, uint16_t Size);
+void HAL_DMA_IRQHandler(DMA_HandleTypeDef *hdma);
+
+#endif
@@ -0,0 +1,364 @@
+/*
+ * AT URC 匹配测试
+ *
+ * 直接包含 at_client.c, 用随机生成的 URC 表和数据流对比两种匹配:
+ * at_client_obj_parse (停止字节位图 + 按结束字节分桶的预编译表),
+ * 以及预编译之前的方式: 每收到一个字节按表顺序线性比较所有 URC 的前缀和后缀.
+ * 两者匹配到的 URC 序号及行内容需完全一致.
+ *
+ * URC 表包含 wifi 的 ESP8266 表, 再加上随机的条目, 字符取自小字母表,
+ * 使前缀互相包含、前缀或后缀为空、多个结束字节落在同一个桶中的情况都能出现.
+ * 数据流由 URC 片段和随机字符组成, 每次设备读取返回随机长度.
+ *
+ * 参数: 随机数种子
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#define AT_USING_CLIENT
+#include "at_client.c"
+
+#define ROUND_NUM           200
+#define STREAM_SIZE         20000
+#define EVENT_MAX           (STREAM_SIZE / 2)
+#define LINE_BUFSZ          128
+#define STR_POOL_SIZE       4096
+
+struct urc_event
+{
+    int index;
+    int len;
+    char data[LINE_BUFSZ];
+};
+
+static const struct at_urc wifi_urc[] = {
+    {"+CIPSTA_CUR:", "\r\n", RT_NULL},
+    {"+CWJAP_CUR:", "\r\n", RT_NULL},
+    {"smartconfig connected wifi", "\r\n", RT_NULL},
+    {"smartconfig connect fail", "\r\n", RT_NULL},
+    {"", ",CLOSED\r\n", RT_NULL},
+    {"", ",CONNECT\r\n", RT_NULL},
+    {"", "WIFI DISCONNECT\r\n", RT_NULL},
+    {"+IPD", ":", RT_NULL},
+    {"SEND OK", "\r\n", RT_NULL},
+    {"SEND FAIL", "\r\n", RT_NULL},
+};
+
+static struct at_urc urc_table[AT_URC_TABLE_MAX];
+static int urc_num = 0;
+static char str_pool[STR_POOL_SIZE];
+static int str_pool_len = 0;
+
+static char stream[STREAM_SIZE];
+static int stream_len = 0;
+static int stream_pos = 0;
+
+static struct urc_event events[EVENT_MAX];
+static int event_num = 0;
+static struct urc_event events_ref[EVENT_MAX];
+static int event_ref_num = 0;
+
+static struct usr_device at_dev = {"at"};
+static char recv_line_buf[LINE_BUFSZ];
+
+rt_tick_t rt_tick_get(void)
+{
+    return 0;
+}
+
+rt_tick_t rt_tick_from_millisecond(rt_int32_t ms)
+{
+    return ms;
+}
+
+rt_err_t rt_sem_init(rt_sem_t sem, const char *name, rt_uint32_t value, rt_uint8_t flag)
+{
+    sem->value = value;
+    return RT_EOK;
+}
+
+rt_err_t rt_sem_take(rt_sem_t sem, rt_int32_t time)
+{
+    if (sem->value == 0)
+        return -RT_ETIMEOUT;
+
+    sem->value--;
+    return RT_EOK;
+}
+
+rt_err_t rt_sem_release(rt_sem_t sem)
+{
+    sem->value++;
+    return RT_EOK;
+}
+
+rt_err_t rt_sem_control(rt_sem_t sem, int cmd, void *arg)
+{
+    if (cmd == RT_IPC_CMD_RESET)
+        sem->value = 0;
+
+    return RT_EOK;
+}
+
+rt_size_t at_vprintfln(usr_device_t dev, const char *format, va_list args)
+{
+    return 0;
+}
+
+void at_print_raw_cmd(const char *type, const char *cmd, rt_size_t size)
+{
+}
+
+const char *at_get_last_cmd(rt_size_t *cmd_size)
+{
+    *cmd_size = 0;
+    return "";
+}
+
+rt_err_t usr_device_set_rx_indicate(usr_device_t dev, rt_err_t (*rx_indicate)(usr_device_t dev, rt_size_t size))
+{
+    dev->rx_indicate = rx_indicate;
+    return RT_EOK;
+}
+
+rt_size_t usr_device_read(usr_device_t dev, rt_off_t pos, void *buffer, rt_size_t size)
+{
+    rt_size_t len = 1 + rand() % size;
+
+    if (len > stream_len - stream_pos)
+        len = stream_len - stream_pos;
+
+    memcpy(buffer, &stream[stream_pos], len);
+    stream_pos += len;
+
+    return len;
+}
+
+rt_size_t usr_device_write(usr_device_t dev, rt_off_t pos, const void *buffer, rt_size_t size)
+{
+    return size;
+}
+
+static void event_add(struct urc_event *list, int *num, int index, const char *data, rt_size_t size)
+{
+    struct urc_event *event = &list[*num];
+
+    assert(*num < EVENT_MAX);
+
+    event->index = index;
+    event->len = size;
+    memcpy(event->data, data, size);
+    (*num)++;
+}
+
+static void urc_func(struct at_client *client, const char *data, rt_size_t size)
+{
+    event_add(events, &event_num, client->recv_urc - urc_table, data, size);
+}
+
+/* 预编译之前的匹配方式 */
+static int urc_match_linear(const char *buffer, rt_size_t bufsz)
+{
+    for (int i = 0; i < urc_num; i++)
+    {
+        const struct at_urc *urc = &urc_table[i];
+        rt_size_t prefix_len = strlen(urc->cmd_prefix);
+        rt_size_t suffix_len = strlen(urc->cmd_suffix);
+
+        if (bufsz < prefix_len + suffix_len)
+            continue;
+
+        if ((prefix_len ? !strncmp(buffer, urc->cmd_prefix, prefix_len) : 1) &&
+            (suffix_len ? !strncmp(buffer + bufsz - suffix_len, urc->cmd_suffix, suffix_len) : 1))
+            return i;
+    }
+
+    return -1;
+}
+
+/* 逐字节读取一行, 每个字节后都做一次线性匹配 */
+static void parse_linear(void)
+{
+    char line[LINE_BUFSZ];
+    rt_size_t len = 0;
+    char last_ch = 0;
+
+    for (int i = 0; i < stream_len; i++)
+    {
+        char ch = stream[i];
+        int index;
+
+        line[len++] = ch;
+        index = urc_match_linear(line, len);
+
+        if ((ch == '\n' && last_ch == '\r') || (index >= 0))
+        {
+            if (index >= 0)
+                event_add(events_ref, &event_ref_num, index, line, len);
+
+            len = 0;
+            last_ch = 0;
+            continue;
+        }
+        last_ch = ch;
+
+        /* 生成的数据不会超出行缓冲区 */
+        assert(len < LINE_BUFSZ - 1);
+    }
+}
+
+static const char *str_random(int min, int max, const char *charset)
+{
+    int len = min + rand() % (max - min + 1);
+    char *str = &str_pool[str_pool_len];
+
+    assert(str_pool_len + len + 1 <= STR_POOL_SIZE);
+
+    for (int i = 0; i < len; i++)
+        str[i] = charset[rand() % strlen(charset)];
+    str[len] = '\0';
+    str_pool_len += len + 1;
+
+    return str;
+}
+
+static void table_build(void)
+{
+    static const char charset[] = "ab:,+\r\n";
+    int extra = rand() % (AT_URC_TABLE_MAX - sizeof(wifi_urc) / sizeof(wifi_urc[0]) + 1);
+
+    urc_num = 0;
+    str_pool_len = 0;
+
+    for (int i = 0; i < sizeof(wifi_urc) / sizeof(wifi_urc[0]); i++)
+        urc_table[urc_num++] = wifi_urc[i];
+
+    for (int i = 0; i < extra; i++)
+    {
+        struct at_urc *urc = &urc_table[urc_num++];
+
+        do
+        {
+            urc->cmd_prefix = str_random(0, 4, charset);
+            urc->cmd_suffix = str_random(0, 3, charset);
+        } while (strlen(urc->cmd_prefix) + strlen(urc->cmd_suffix) == 0);
+    }
+
+    /* 打乱顺序, 表顺序决定同时满足时匹配哪一个 */
+    for (int i = urc_num - 1; i > 0; i--)
+    {
+        int j = rand() % (i + 1);
+        struct at_urc tmp = urc_table[i];
+
+        urc_table[i] = urc_table[j];
+        urc_table[j] = tmp;
+    }
+
+    for (int i = 0; i < urc_num; i++)
+        urc_table[i].func = urc_func;
+}
+
+static void stream_append(const char *str, int len)
+{
+    if (len > STREAM_SIZE - stream_len)
+        len = STREAM_SIZE - stream_len;
+
+    memcpy(&stream[stream_len], str, len);
+    stream_len += len;
+}
+
+/* 由 URC 片段和随机字符组成, 每行不超过 LINE_BUFSZ / 2 后补 "\r\n" */
+static void stream_build(void)
+{
+    static const char charset[] = "ab:,+ \r\nSEND OK";
+    int line_len = 0;
+
+    stream_len = 0;
+    stream_pos = 0;
+
+    while (stream_len < STREAM_SIZE - LINE_BUFSZ)
+    {
+        const struct at_urc *urc = &urc_table[rand() % urc_num];
+        int r = rand() % 8;
+
+        if (r < 3)
+        {
+            stream_append(urc->cmd_prefix, strlen(urc->cmd_prefix));
+            line_len += strlen(urc->cmd_prefix);
+        }
+        else if (r < 5)
+        {
+            stream_append(urc->cmd_suffix, strlen(urc->cmd_suffix));
+            line_len += strlen(urc->cmd_suffix);
+        }
+        else
+        {
+            char ch = charset[rand() % strlen(charset)];
+
+            stream_append(&ch, 1);
+            line_len++;
+        }
+
+        if (line_len > LINE_BUFSZ / 2)
+        {
+            stream_append("\r\n", 2);
+            line_len = 0;
+        }
+    }
+
+    stream_append("\r\n", 2);
+}
+
+int main(int argc, char **argv)
+{
+    unsigned int seed = (argc > 1) ? strtoul(argv[1], RT_NULL, 0) : 1;
+    at_client_t client;
+    long total = 0;
+
+    srand(seed);
+
+    client = at_client_init(&at_dev, recv_line_buf, sizeof(recv_line_buf));
+    assert(client);
+
+    for (int round = 0; round < ROUND_NUM; round++)
+    {
+        table_build();
+        stream_build();
+
+        event_num = 0;
+        event_ref_num = 0;
+
+        if (at_obj_set_urc_table(client, urc_table, urc_num) != RT_EOK)
+        {
+            printf("seed %u round %d: set table failed\n", seed, round);
+            return 1;
+        }
+
+        while (stream_pos < stream_len)
+            at_client_obj_parse(client);
+        /* 最后的 "\r\n" 可能被后缀为 "\r" 的 URC 分开, 剩下的半行留给下一轮 */
+        at_recv_line_reset(client);
+
+        parse_linear();
+
+        for (int i = 0; i < event_num || i < event_ref_num; i++)
+        {
+            if ((i >= event_num) || (i >= event_ref_num) || (events[i].index != events_ref[i].index) ||
+                (events[i].len != events_ref[i].len) || memcmp(events[i].data, events_ref[i].data, events[i].len))
+            {
+                printf("seed %u round %d: URC %d differs, %d / %d matched\n", seed, round, i, event_num, event_ref_num);
+                if (i < event_num)
+                    printf("  matcher: %d \"%.*s\"\n", events[i].index, events[i].len, events[i].data);
+                if (i < event_ref_num)
+                    printf("  linear:  %d \"%.*s\"\n", events_ref[i].index, events_ref[i].len, events_ref[i].data);
+                return 1;
+            }
+        }
+
+        total += event_num;
+    }
+
+    printf("seed %u: %ld URCs matched\n", seed, total);
+
+    return 0;
+}
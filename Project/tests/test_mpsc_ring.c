@@ -0,0 +1,108 @@
+/*
+ * mpsc_ring 多生产者压力测试
+ *
+ * 多个线程同时写入变长记录, 单个消费者检查每条记录的长度、内容
+ * 以及同一生产者记录的顺序, 全部记录都读出后通过.
+ */
+#define _GNU_SOURCE
+#include <sched.h>
+#include <pthread.h>
+#include <stdio.h>
+#include "mpsc_ring.h"
+
+#define PRODUCER_NUM        4
+#define RECORD_NUM          20000
+#define RING_SIZE           1024
+
+static rt_uint8_t ring_buf[RING_SIZE] __attribute__((aligned(4)));
+static struct mpsc_ring ring;
+static volatile int done_num = 0;
+static unsigned int last_seq[PRODUCER_NUM];
+
+/* 记录: id | (len << 8), seq, 之后按 seq 填充 */
+static void *producer_entry(void *parameter)
+{
+    unsigned int id = (unsigned int)(long)parameter;
+
+    for (unsigned int seq = 1; seq <= RECORD_NUM; seq++)
+    {
+        unsigned int len = 8 + (seq * 7 + id) % 60;
+        rt_uint8_t *rec;
+
+        while ((rec = mpsc_ring_reserve(&ring, len)) == RT_NULL)
+            sched_yield();
+
+        ((rt_uint32_t *)rec)[0] = id | (len << 8);
+        ((rt_uint32_t *)rec)[1] = seq;
+        for (unsigned int i = 8; i < len; i++)
+            rec[i] = (rt_uint8_t)(seq + i);
+
+        mpsc_ring_commit(&ring, rec);
+    }
+
+    __atomic_add_fetch(&done_num, 1, __ATOMIC_SEQ_CST);
+
+    return NULL;
+}
+
+int main(void)
+{
+    pthread_t threads[PRODUCER_NUM];
+    unsigned long total = 0;
+
+    mpsc_ring_init(&ring, ring_buf, sizeof(ring_buf));
+
+    for (long i = 0; i < PRODUCER_NUM; i++)
+        pthread_create(&threads[i], NULL, producer_entry, (void *)i);
+
+    while (1)
+    {
+        rt_uint32_t rec_len;
+        rt_uint8_t *rec = mpsc_ring_peek(&ring, &rec_len);
+
+        if (rec == RT_NULL)
+        {
+            if (__atomic_load_n(&done_num, __ATOMIC_SEQ_CST) == PRODUCER_NUM && mpsc_ring_data_len(&ring) == 0)
+                break;
+
+            sched_yield();
+            continue;
+        }
+
+        unsigned int id = ((rt_uint32_t *)rec)[0] & 0xFF;
+        unsigned int len = ((rt_uint32_t *)rec)[0] >> 8;
+        unsigned int seq = ((rt_uint32_t *)rec)[1];
+
+        if (id >= PRODUCER_NUM || RT_ALIGN(len, 4) != rec_len)
+        {
+            printf("bad length: id %u, len %u, record %u\n", id, len, rec_len);
+            return 1;
+        }
+
+        if (seq != last_seq[id] + 1)
+        {
+            printf("bad order: id %u, seq %u after %u\n", id, seq, last_seq[id]);
+            return 1;
+        }
+        last_seq[id] = seq;
+
+        for (unsigned int i = 8; i < len; i++)
+        {
+            if (rec[i] != (rt_uint8_t)(seq + i))
+            {
+                printf("bad data: id %u, seq %u\n", id, seq);
+                return 1;
+            }
+        }
+
+        total++;
+        mpsc_ring_release(&ring);
+    }
+
+    for (int i = 0; i < PRODUCER_NUM; i++)
+        pthread_join(threads[i], NULL);
+
+    printf("records %lu, reserve fail %u\n", total, ring.drop_cnt);
+
+    return (total == (unsigned long)PRODUCER_NUM * RECORD_NUM) ? 0 : 1;
+}
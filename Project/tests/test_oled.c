@@ -0,0 +1,504 @@
+/*
+ * oled 刷新测试
+ *
+ * 直接包含 oled.c, SPI DMA 发送由测试模拟: 每段记录 D/C 电平后交给 SSD1306 模型解析,
+ * 模型按水平寻址模式执行 0x21 / 0x22 寻址命令和数据写入.
+ * 每次刷新后检查模型显存与 oled_gram 一致, 并统计发送的命令和数据字节数:
+ * 数据字节只能是改变的列, 寻址命令每个窗口 6 字节.
+ *
+ * 参数: 随机数种子
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "oled.c"
+
+#define OP_NUM              20000
+
+/* 模拟的时间和外设 */
+static rt_tick_t now = 0;
+static rt_uint8_t pin_level[16];
+static const rt_uint8_t *dma_buf = RT_NULL;
+static rt_uint16_t dma_len = 0;
+static rt_uint8_t dma_dc = 0;
+static rt_tick_t timer_due = 0;
+
+/* 发送统计 */
+static long cmd_bytes = 0;
+static long data_bytes = 0;
+static long chain_num = 0;
+
+/* SSD1306 模型 */
+static rt_uint8_t panel[OLED_PAGE_NUM][OLED_WIDTH];
+static rt_uint8_t panel_col_start = 0, panel_col_end = OLED_WIDTH - 1;
+static rt_uint8_t panel_page_start = 0, panel_page_end = OLED_PAGE_NUM - 1;
+static rt_uint8_t panel_col = 0, panel_page = 0;
+static rt_uint8_t panel_contrast = 0;
+static rt_uint8_t panel_cmd[3];
+static int panel_cmd_len = 0;
+
+/* 测试记录的显存和上次刷新后改变的列 */
+static rt_uint8_t shadow[OLED_PAGE_NUM][OLED_WIDTH];
+static int dirty_start[OLED_PAGE_NUM];
+static int dirty_end[OLED_PAGE_NUM];
+
+rt_tick_t rt_tick_get(void)
+{
+    return now;
+}
+
+rt_tick_t rt_tick_from_millisecond(rt_int32_t ms)
+{
+    return ms * RT_TICK_PER_SECOND / 1000;
+}
+
+rt_err_t rt_thread_mdelay(rt_int32_t ms)
+{
+    now += rt_tick_from_millisecond(ms);
+    return RT_EOK;
+}
+
+void rt_interrupt_enter(void)
+{
+}
+
+void rt_interrupt_leave(void)
+{
+}
+
+void drv_pin_mode(rt_base_t pin, rt_base_t mode)
+{
+}
+
+void drv_pin_write(rt_base_t pin, rt_base_t value)
+{
+    pin_level[pin] = value;
+    if ((pin == OLED_CS_PIN) && (value == PIN_LOW))
+        chain_num++;
+}
+
+rt_err_t usr_device_register(usr_device_t dev, const char *name)
+{
+    return RT_EOK;
+}
+
+void reactor_timer_init(reactor_timer_t timer, void (*handler)(reactor_timer_t timer), void *user_data)
+{
+    timer->active = 0;
+    timer->handler = handler;
+    timer->user_data = user_data;
+}
+
+void reactor_timer_start(reactor_timer_t timer, rt_int32_t ms)
+{
+    timer->active = 1;
+    timer_due = now + rt_tick_from_millisecond(ms);
+}
+
+HAL_StatusTypeDef HAL_SPI_Init(SPI_HandleTypeDef *hspi)
+{
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_SPI_DeInit(SPI_HandleTypeDef *hspi)
+{
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_SPI_Abort(SPI_HandleTypeDef *hspi)
+{
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_SPI_Transmit_DMA(SPI_HandleTypeDef *hspi, uint8_t *pData, uint16_t Size)
+{
+    assert(dma_len == 0);
+    assert(pin_level[OLED_CS_PIN] == PIN_LOW);
+    assert(Size > 0);
+
+    dma_buf = pData;
+    dma_len = Size;
+    dma_dc = pin_level[OLED_DC_PIN];
+
+    return HAL_OK;
+}
+
+void HAL_DMA_IRQHandler(DMA_HandleTypeDef *hdma)
+{
+}
+
+static void panel_command(rt_uint8_t byte)
+{
+    int need;
+
+    panel_cmd[panel_cmd_len++] = byte;
+
+    switch (panel_cmd[0])
+    {
+        case 0x21:
+        case 0x22:
+            need = 3;
+            break;
+        case 0x20:
+        case 0x81:
+        case 0x8D:
+        case 0xA8:
+        case 0xD3:
+        case 0xD5:
+        case 0xD9:
+        case 0xDA:
+        case 0xDB:
+            need = 2;
+            break;
+        default:
+            need = 1;
+            break;
+    }
+
+    if (panel_cmd_len < need)
+        return;
+
+    if (panel_cmd[0] == 0x21)
+    {
+        panel_col_start = panel_col = panel_cmd[1];
+        panel_col_end = panel_cmd[2];
+    }
+    else if (panel_cmd[0] == 0x22)
+    {
+        panel_page_start = panel_page = panel_cmd[1];
+        panel_page_end = panel_cmd[2];
+    }
+    else if (panel_cmd[0] == 0x81)
+    {
+        panel_contrast = panel_cmd[1];
+    }
+
+    panel_cmd_len = 0;
+}
+
+static void panel_data(rt_uint8_t byte)
+{
+    panel[panel_page][panel_col] = byte;
+
+    if (panel_col++ < panel_col_end)
+        return;
+
+    panel_col = panel_col_start;
+    if (panel_page++ >= panel_page_end)
+        panel_page = panel_page_start;
+}
+
+/* 依次完成所有 DMA 段, 每段结束后调用发送完成中断 */
+static void dma_run(void)
+{
+    while (dma_len > 0)
+    {
+        const rt_uint8_t *buf = dma_buf;
+        rt_uint16_t len = dma_len;
+
+        for (int i = 0; i < len; i++)
+        {
+            if (dma_dc == PIN_LOW)
+                panel_command(buf[i]);
+            else
+                panel_data(buf[i]);
+        }
+
+        if (dma_dc == PIN_LOW)
+            cmd_bytes += len;
+        else
+            data_bytes += len;
+
+        dma_len = 0;
+        HAL_SPI_TxCpltCallback(&hspi3);
+    }
+}
+
+/* 推进时间到定时器到期并执行 */
+static void timer_run(void)
+{
+    dma_run();
+
+    while (oled_device.timer.active)
+    {
+        if ((rt_int32_t)(timer_due - now) > 0)
+            now = timer_due;
+
+        oled_device.timer.active = 0;
+        oled_device.timer.handler(&(oled_device.timer));
+        dma_run();
+    }
+}
+
+static void stat_reset(void)
+{
+    cmd_bytes = 0;
+    data_bytes = 0;
+    chain_num = 0;
+}
+
+static void dirty_reset(void)
+{
+    for (int page = 0; page < OLED_PAGE_NUM; page++)
+    {
+        dirty_start[page] = OLED_WIDTH;
+        dirty_end[page] = -1;
+    }
+}
+
+static void dirty_mark(int page, int start, int end)
+{
+    if (start < dirty_start[page])
+        dirty_start[page] = start;
+    if (end > dirty_end[page])
+        dirty_end[page] = end;
+}
+
+static void shadow_write(int pos, const rt_uint8_t *buf, int len)
+{
+    rt_size_t size = oled_device.parent.write(&(oled_device.parent), pos, buf, len);
+
+    assert(size == len);
+
+    for (int i = 0; i < len; i++)
+    {
+        int page = (pos + i) / OLED_WIDTH;
+        int col = (pos + i) % OLED_WIDTH;
+
+        if (shadow[page][col] == buf[i])
+            continue;
+
+        shadow[page][col] = buf[i];
+        dirty_mark(page, col, col);
+    }
+}
+
+/* 按改变的列计算应发送的字节数: 相邻且列范围相同的页共用一个窗口 */
+static void expect_bytes(long *cmd, long *data)
+{
+    int page = 0;
+
+    *cmd = 0;
+    *data = 0;
+
+    while (page < OLED_PAGE_NUM)
+    {
+        if (dirty_start[page] > dirty_end[page])
+        {
+            page++;
+            continue;
+        }
+
+        int last = page;
+        while ((last + 1 < OLED_PAGE_NUM) && (dirty_start[last + 1] == dirty_start[page]) &&
+               (dirty_end[last + 1] == dirty_end[page]))
+            last++;
+
+        *cmd += OLED_WINDOW_CMD_SIZE;
+        *data += (long)(last - page + 1) * (dirty_end[page] - dirty_start[page] + 1);
+        page = last + 1;
+    }
+}
+
+static int check_panel(const char *step)
+{
+    if (memcmp(panel, oled_gram, sizeof(panel)) || memcmp(shadow, oled_gram, sizeof(shadow)))
+    {
+        printf("%s: panel differs from gram\n", step);
+        return -1;
+    }
+
+    return 0;
+}
+
+/* 刷新并检查发送的字节数, rect 不为空时同时标记该区域 */
+static int refresh_check(const char *step, struct usr_device_oled_rect *rect)
+{
+    long cmd, data;
+
+    if (rect)
+    {
+        int end = rect->x + rect->width - 1;
+        int last = (rect->y + rect->height - 1) / 8;
+
+        if (end >= OLED_WIDTH)
+            end = OLED_WIDTH - 1;
+        if (last >= OLED_PAGE_NUM)
+            last = OLED_PAGE_NUM - 1;
+
+        for (int page = rect->y / 8; page <= last; page++)
+            dirty_mark(page, rect->x, end);
+    }
+
+    expect_bytes(&cmd, &data);
+    stat_reset();
+
+    oled_device.parent.control(&(oled_device.parent), USR_DEVICE_OLED_CMD_RECT_UPDATE, rect);
+    timer_run();
+
+    if ((cmd_bytes != cmd) || (data_bytes != data))
+    {
+        printf("%s: sent %ld cmd + %ld data bytes, expected %ld + %ld\n", step, cmd_bytes, data_bytes, cmd, data);
+        return -1;
+    }
+
+    dirty_reset();
+
+    return check_panel(step);
+}
+
+int main(int argc, char **argv)
+{
+    unsigned int seed = (argc > 1) ? strtoul(argv[1], RT_NULL, 0) : 1;
+    long full_bytes = sizeof(oled_gram);
+    long total = 0;
+    rt_uint8_t buf[OLED_WIDTH * 3];
+
+    srand(seed);
+
+    /* 上电时屏幕显存为随机内容 */
+    for (int page = 0; page < OLED_PAGE_NUM; page++)
+    {
+        for (int col = 0; col < OLED_WIDTH; col++)
+            panel[page][col] = rand();
+    }
+
+    _hw_oled_init();
+    oled_device.parent.init(&(oled_device.parent));
+    timer_run();
+
+    /* 初始化: 初始化命令立即发送, 之后一个全屏窗口 */
+    if ((cmd_bytes != sizeof(oled_init_cmd) + OLED_WINDOW_CMD_SIZE) || (data_bytes != full_bytes) || (chain_num != 2))
+    {
+        printf("init: sent %ld cmd + %ld data bytes in %ld chains\n", cmd_bytes, data_bytes, chain_num);
+        return 1;
+    }
+    dirty_reset();
+    if (check_panel("init"))
+        return 1;
+
+    /* 改变一个字节: 一个窗口 + 1 字节数据 */
+    buf[0] = 0x5A;
+    shadow_write(3 * OLED_WIDTH + 10, buf, 1);
+    if (refresh_check("one byte", RT_NULL))
+        return 1;
+    if ((cmd_bytes != OLED_WINDOW_CMD_SIZE) || (data_bytes != 1))
+    {
+        printf("one byte: sent %ld bytes\n", cmd_bytes + data_bytes);
+        return 1;
+    }
+
+    /* 写入相同内容不需要发送 */
+    shadow_write(3 * OLED_WIDTH + 10, buf, 1);
+    if (refresh_check("same byte", RT_NULL) || (cmd_bytes + data_bytes != 0) || (chain_num != 0))
+    {
+        printf("same byte: sent %ld bytes in %ld chains\n", cmd_bytes + data_bytes, chain_num);
+        return 1;
+    }
+
+    /* 相邻页列范围相同时合并成一个窗口 */
+    for (int page = 2; page < 6; page++)
+    {
+        memset(buf, page, 16);
+        shadow_write(page * OLED_WIDTH + 40, buf, 16);
+    }
+    if (refresh_check("merge", RT_NULL) || (cmd_bytes != OLED_WINDOW_CMD_SIZE) || (data_bytes != 4 * 16))
+    {
+        printf("merge: sent %ld cmd + %ld data bytes\n", cmd_bytes, data_bytes);
+        return 1;
+    }
+
+    /* 间隔内的多次更新合并到一次刷新 */
+    stat_reset();
+    buf[0] = 0x11;
+    shadow_write(0, buf, 1);
+    oled_device.parent.control(&(oled_device.parent), USR_DEVICE_OLED_CMD_RECT_UPDATE, RT_NULL);
+    buf[0] = 0x22;
+    shadow_write(7 * OLED_WIDTH + 127, buf, 1);
+    oled_device.parent.control(&(oled_device.parent), USR_DEVICE_OLED_CMD_RECT_UPDATE, RT_NULL);
+    if (chain_num != 0)
+    {
+        printf("coalesce: refreshed before the interval\n");
+        return 1;
+    }
+    timer_run();
+    if ((chain_num != 1) || (cmd_bytes != 2 * OLED_WINDOW_CMD_SIZE) || (data_bytes != 2))
+    {
+        printf("coalesce: sent %ld cmd + %ld data bytes in %ld chains\n", cmd_bytes, data_bytes, chain_num);
+        return 1;
+    }
+    dirty_reset();
+    if (check_panel("coalesce"))
+        return 1;
+
+    /* 发送期间排队的命令在 DMA 链结束后发送 */
+    now += rt_tick_from_millisecond(OLED_REFRESH_INTERVAL);
+    buf[0] = 0x33;
+    shadow_write(OLED_WIDTH + 64, buf, 1);
+    oled_device.parent.control(&(oled_device.parent), USR_DEVICE_OLED_CMD_RECT_UPDATE, RT_NULL);
+    if (dma_len == 0)
+    {
+        printf("cmd: refresh not started\n");
+        return 1;
+    }
+    {
+        static const rt_uint8_t contrast[] = {0x81, 0x7F};
+        struct usr_device_oled_cmd cmd = {contrast, sizeof(contrast)};
+
+        if (oled_device.parent.control(&(oled_device.parent), USR_DEVICE_OLED_CMD_WRITE_CMD, &cmd) != RT_EOK)
+        {
+            printf("cmd: queue failed\n");
+            return 1;
+        }
+    }
+    timer_run();
+    dirty_reset();
+    if ((panel_contrast != 0x7F) || check_panel("cmd"))
+    {
+        printf("cmd: contrast 0x%02X\n", panel_contrast);
+        return 1;
+    }
+
+    /* 随机写入和区域刷新 */
+    for (long op = 0; op < OP_NUM; op++)
+    {
+        int writes = rand() % 4;
+
+        now += rand() % (2 * OLED_REFRESH_INTERVAL);
+
+        for (int i = 0; i < writes; i++)
+        {
+            int pos = rand() % sizeof(oled_gram);
+            int len = 1 + rand() % ((rand() % 8 == 0) ? sizeof(buf) : 8);
+
+            if (len > sizeof(oled_gram) - pos)
+                len = sizeof(oled_gram) - pos;
+
+            for (int j = 0; j < len; j++)
+                buf[j] = (rand() % 4 == 0) ? rand() : shadow[(pos + j) / OLED_WIDTH][(pos + j) % OLED_WIDTH];
+
+            shadow_write(pos, buf, len);
+        }
+
+        struct usr_device_oled_rect rect;
+
+        rect.x = rand() % OLED_WIDTH;
+        rect.y = rand() % (OLED_PAGE_NUM * 8);
+        rect.width = 1 + rand() % OLED_WIDTH;
+        rect.height = 1 + rand() % (OLED_PAGE_NUM * 8);
+
+        char step[32];
+        snprintf(step, sizeof(step), "op %ld", op);
+        if (refresh_check(step, (rand() % 8 == 0) ? &rect : RT_NULL))
+        {
+            printf("seed %u failed\n", seed);
+            return 1;
+        }
+
+        total += cmd_bytes + data_bytes;
+    }
+
+    printf("seed %u: %ld bytes for %d refreshes, %ld for full refreshes\n", seed, total, OP_NUM,
+           (long)OP_NUM * (OLED_WINDOW_CMD_SIZE + full_bytes));
+
+    return 0;
+}
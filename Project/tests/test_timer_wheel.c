@@ -0,0 +1,143 @@
+/*
+ * timer_wheel 随机操作测试
+ *
+ * 用虚拟时间随机添加、删除定时器并推进时间, 起始时间靠近 tick 回绕.
+ * 每次推进前检查 timer_wheel_next 不晚于最早的定时器,
+ * 推进后检查到期的定时器都已取出, 且没有提前取出或取出已删除的定时器.
+ *
+ * 参数: 随机数种子
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "timer_wheel.h"
+
+#define TIMER_NUM           300
+#define OP_NUM              200000
+
+struct test_timer
+{
+    struct timer_wheel_node node;
+    int active;
+    rt_tick_t timeout;
+};
+
+static struct test_timer timers[TIMER_NUM];
+static struct timer_wheel tw;
+
+static rt_tick_t random_delay(void)
+{
+    int r = rand() % 100;
+
+    if (r < 40)
+        return rand() % 64;
+    if (r < 70)
+        return rand() % 5000;
+    if (r < 95)
+        return rand() % 400000;
+
+    return rand() % 3000000;
+}
+
+/* 线性扫描得到最早的定时器距 now 的时间 */
+static rt_tick_t reference_next(rt_tick_t now)
+{
+    rt_tick_t next = TIMER_WHEEL_FOREVER;
+
+    for (int i = 0; i < TIMER_NUM; i++)
+    {
+        if (!timers[i].active)
+            continue;
+
+        rt_tick_t remain = timers[i].timeout - now;
+        if (remain >= RT_TICK_MAX / 2)
+            remain = 0;
+        if (remain < next)
+            next = remain;
+    }
+
+    return next;
+}
+
+int main(int argc, char **argv)
+{
+    unsigned int seed = (argc > 1) ? atoi(argv[1]) : 1;
+    long fired = 0;
+
+    srand(seed);
+
+    rt_tick_t now = 0xFFFF0000UL - (rand() % 100000);
+    timer_wheel_init(&tw, now);
+    for (int i = 0; i < TIMER_NUM; i++)
+        timer_wheel_node_init(&timers[i].node);
+
+    for (int op = 0; op < OP_NUM; op++)
+    {
+        int action = rand() % 10;
+        struct test_timer *timer = &timers[rand() % TIMER_NUM];
+
+        if (action < 4)
+        {
+            rt_tick_t timeout = now + random_delay();
+
+            timer_wheel_remove(&tw, &timer->node);
+            timer_wheel_add(&tw, &timer->node, timeout);
+            timer->active = 1;
+            timer->timeout = timeout;
+            continue;
+        }
+
+        if (action < 5)
+        {
+            timer_wheel_remove(&tw, &timer->node);
+            timer->active = 0;
+            continue;
+        }
+
+        rt_tick_t next = timer_wheel_next(&tw, now);
+        rt_tick_t ref = reference_next(now);
+        if ((ref == TIMER_WHEEL_FOREVER) ? (next != TIMER_WHEEL_FOREVER) : (next > ref))
+        {
+            printf("seed %u: next %u, reference %u\n", seed, next, ref);
+            return 1;
+        }
+
+        /* 有时正好推进到 next, 有时随机推进 */
+        if (rand() % 3 == 0)
+            now += (next == TIMER_WHEEL_FOREVER) ? 1000 : next;
+        else
+            now += rand() % 2000;
+
+        timer_wheel_node_t node;
+        while ((node = timer_wheel_expire(&tw, now)) != RT_NULL)
+        {
+            timer = rt_list_entry(node, struct test_timer, node);
+            if (!timer->active)
+            {
+                printf("seed %u: removed timer %d expired\n", seed, (int)(timer - timers));
+                return 1;
+            }
+            if ((now - timer->timeout) >= RT_TICK_MAX / 2)
+            {
+                printf("seed %u: timer %d expired early, timeout %u, now %u\n", seed, (int)(timer - timers),
+                       timer->timeout, now);
+                return 1;
+            }
+
+            timer->active = 0;
+            fired++;
+        }
+
+        for (int i = 0; i < TIMER_NUM; i++)
+        {
+            if (timers[i].active && (now - timers[i].timeout) < RT_TICK_MAX / 2)
+            {
+                printf("seed %u: timer %d missed, timeout %u, now %u\n", seed, i, timers[i].timeout, now);
+                return 1;
+            }
+        }
+    }
+
+    printf("seed %u: %ld timers expired\n", seed, fired);
+
+    return 0;
+}
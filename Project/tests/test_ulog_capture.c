@@ -0,0 +1,292 @@
+/*
+ * ulog 原始记录捕获测试
+ *
+ * 直接包含 ulog.c, 注册两个后端:
+ * ref 不捕获, 收到所有延后格式化的日志; cap 设置 capture, capture_lvl 以内的日志只保存原始记录.
+ * 随机输出各种格式和等级的日志, 检查 cap 保存的记录用 ulog_capture_format 格式化后
+ * 与 ref 收到的同一条日志一致, 高于 capture_lvl 的日志仍按原来的方式输出到 cap.
+ * capture_lvl 取 LOG_LVL_ASSERT 时不捕获任何延后的日志.
+ *
+ * 参数: 随机数种子, 同时决定 capture_lvl
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <rtthread.h>
+
+#define RT_USING_ULOG
+#define ULOG_OUTPUT_LVL                 LOG_LVL_DBG
+#define ULOG_RBB_BUFSZ                  4096
+#define ULOG_LINE_BUF_SIZE              256
+#define ULOG_OUTPUT_TIME
+#define ULOG_OUTPUT_LEVEL
+#define ULOG_OUTPUT_TAG
+#define ULOG_USING_DEFERRED
+#define ULOG_DEFERRED_BUFSZ             2048
+#define ULOG_DEFERRED_STR_MAX           64
+#define ULOG_BATCH_BUFSZ                1024
+#define ULOG_BATCH_NUM                  16
+
+#include "ulog.c"
+
+#define LOG_NUM             5000
+#define REC_SIZE_MAX        (sizeof(struct ulog_deferred_rec) + ULOG_DEFERRED_ARG_MAX * sizeof(rt_ubase_t) + ULOG_DEFERRED_STR_MAX)
+
+struct test_line
+{
+    rt_uint32_t level;
+    int len;
+    char buf[ULOG_LINE_BUF_SIZE + 1];
+};
+
+struct test_rec
+{
+    rt_size_t size;
+    rt_ubase_t buf[REC_SIZE_MAX / sizeof(rt_ubase_t) + 1];
+};
+
+static rt_tick_t now = 0;
+static struct rt_thread main_thread = {"main"};
+
+static struct ulog_backend ref = {0};
+static struct ulog_backend cap = {0};
+static struct test_line ref_lines[LOG_NUM];
+static int ref_num = 0;
+static struct test_line cap_lines[LOG_NUM];
+static int cap_num = 0;
+static struct test_rec cap_recs[LOG_NUM];
+static int cap_rec_num = 0;
+static rt_uint32_t log_levels[LOG_NUM];
+
+rt_tick_t rt_tick_get(void)
+{
+    return now;
+}
+
+rt_uint8_t rt_interrupt_get_nest(void)
+{
+    return 0;
+}
+
+rt_thread_t rt_thread_self(void)
+{
+    return &main_thread;
+}
+
+void main_hook_module_register(struct main_hook_module *module)
+{
+}
+
+static void line_add(struct test_line *list, int *num, rt_uint32_t level, const char *log, size_t len)
+{
+    struct test_line *line = &list[*num];
+
+    assert(*num < LOG_NUM);
+    assert(len <= ULOG_LINE_BUF_SIZE);
+
+    line->level = level;
+    line->len = len;
+    memcpy(line->buf, log, len);
+    (*num)++;
+}
+
+static void ref_output(struct ulog_backend *backend, rt_uint32_t level, const char *tag, rt_bool_t is_raw, char *log, size_t len)
+{
+    line_add(ref_lines, &ref_num, level, log, len);
+}
+
+static void cap_output(struct ulog_backend *backend, rt_uint32_t level, const char *tag, rt_bool_t is_raw, char *log, size_t len)
+{
+    line_add(cap_lines, &cap_num, level, log, len);
+}
+
+static void cap_capture(struct ulog_backend *backend, const struct ulog_deferred_rec *rec, const rt_ubase_t *argv,
+                        const char *str, rt_size_t str_len)
+{
+    struct test_rec *r = &cap_recs[cap_rec_num++];
+    rt_uint8_t *p = (rt_uint8_t *)r->buf;
+
+    assert(cap_rec_num <= LOG_NUM);
+
+    r->size = sizeof(*rec) + rec->argc * sizeof(rt_ubase_t) + str_len;
+    assert(r->size <= sizeof(r->buf));
+
+    memcpy(p, rec, sizeof(*rec));
+    memcpy(p + sizeof(*rec), argv, rec->argc * sizeof(rt_ubase_t));
+    memcpy(p + sizeof(*rec) + rec->argc * sizeof(rt_ubase_t), str, str_len);
+}
+
+static const char *str_random(char *buf)
+{
+    static const char charset[] = "abcdefghij %:";
+    int len = rand() % 41;
+
+    for (int i = 0; i < len; i++)
+        buf[i] = charset[rand() % (sizeof(charset) - 1)];
+    buf[len] = '\0';
+
+    return buf;
+}
+
+/* 调用者的字符串在格式化前被改写, 记录中应是保存时的拷贝 */
+static void log_random(rt_uint32_t level)
+{
+    static const char *tags[] = {"wifi", "rtu_master", "reactor", "a_very_long_tag_name_that_exceeds_the_cache"};
+    const char *tag = tags[rand() % 4];
+    char s1[48], s2[48], s3[48];
+    int v = rand() - RAND_MAX / 2;
+
+    switch (rand() % 8)
+    {
+    case 0:
+        ulog_output(level, tag, RT_TRUE, "plain text");
+        break;
+    case 1:
+        ulog_output(level, tag, RT_TRUE, "v=%d", v);
+        break;
+    case 2:
+        ulog_output(level, tag, RT_TRUE, "%s=%u", str_random(s1), (unsigned int)v);
+        break;
+    case 3:
+        ulog_output(level, tag, RT_TRUE, "%x %X %c", v, v, 'a' + rand() % 26);
+        break;
+    case 4:
+        ulog_output(level, tag, RT_TRUE, "[%5s] [%-6s]", str_random(s1), str_random(s2));
+        break;
+    case 5:
+        ulog_output(level, tag, RT_TRUE, "%.*s|%d", rand() % 10, str_random(s1), v);
+        break;
+    case 6:
+        ulog_output(level, tag, RT_TRUE, "%s %s %s", str_random(s1), str_random(s2), str_random(s3));
+        break;
+    default:
+        ulog_output(level, tag, rand() & 1, "100%% %08x", v);
+        break;
+    }
+
+    memset(s1, 'x', sizeof(s1) - 1);
+    memset(s2, 'y', sizeof(s2) - 1);
+    memset(s3, 'z', sizeof(s3) - 1);
+}
+
+static int check_invalid(void)
+{
+    static char buf[ULOG_LINE_BUF_SIZE + 1];
+    struct test_rec r = cap_recs[0];
+    struct ulog_deferred_rec *rec = (struct ulog_deferred_rec *)r.buf;
+
+    if (ulog_capture_format(buf, rec, sizeof(*rec) - 1) != 0)
+        return -1;
+
+    rec->argc = ULOG_DEFERRED_ARG_MAX + 1;
+    if (ulog_capture_format(buf, rec, r.size) != 0)
+        return -1;
+
+    r = cap_recs[0];
+    rec->level = LOG_LVL_DBG + 1;
+    if (ulog_capture_format(buf, rec, r.size) != 0)
+        return -1;
+
+    /* 正在输出延后日志 */
+    r = cap_recs[0];
+    ulog.deferred.draining = 1;
+    if (ulog_capture_format(buf, rec, r.size) != -RT_EBUSY)
+        return -1;
+    ulog.deferred.draining = 0;
+
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    static const rt_uint32_t capture_levels[] = {LOG_LVL_ASSERT, LOG_LVL_ERROR, LOG_LVL_WARNING, LOG_LVL_INFO, LOG_LVL_DBG};
+    static const rt_uint32_t levels[] = {LOG_LVL_ERROR, LOG_LVL_WARNING, LOG_LVL_INFO, LOG_LVL_DBG};
+    unsigned int seed = (argc > 1) ? strtoul(argv[1], RT_NULL, 0) : 1;
+    rt_uint32_t capture_lvl = capture_levels[seed % 5];
+    char buf[ULOG_LINE_BUF_SIZE + 1];
+    int cap_rec_index = 0, cap_line_index = 0;
+
+    srand(seed);
+    ulog_init();
+
+    ref.output = ref_output;
+    ulog_backend_register(&ref, "ref", RT_FALSE);
+    cap.output = cap_output;
+    cap.capture = cap_capture;
+    cap.capture_lvl = capture_lvl;
+    ulog_backend_register(&cap, "cap", RT_FALSE);
+
+    for (int i = 0; i < LOG_NUM; i++)
+    {
+        now += rand() % 300;
+        log_levels[i] = levels[rand() % 4];
+        log_random(log_levels[i]);
+
+        if ((i & 7) == 7)
+            ulog_deferred_flush();
+    }
+    ulog_deferred_flush();
+
+    if (ref_num != LOG_NUM)
+    {
+        printf("seed %u: %d / %d logs output\n", seed, ref_num, LOG_NUM);
+        return 1;
+    }
+
+    for (int i = 0; i < LOG_NUM; i++)
+    {
+        const struct test_line *line;
+        int len;
+
+        if (log_levels[i] <= capture_lvl)
+        {
+            const struct test_rec *r;
+
+            if (cap_rec_index >= cap_rec_num)
+            {
+                printf("seed %u: log %d is not captured\n", seed, i);
+                return 1;
+            }
+
+            r = &cap_recs[cap_rec_index++];
+            len = ulog_capture_format(buf, (const struct ulog_deferred_rec *)r->buf, r->size);
+            line = &ref_lines[i];
+        }
+        else
+        {
+            if (cap_line_index >= cap_num)
+            {
+                printf("seed %u: log %d is not output to the capture backend\n", seed, i);
+                return 1;
+            }
+
+            line = &cap_lines[cap_line_index++];
+            len = line->len;
+            memcpy(buf, line->buf, len);
+            line = &ref_lines[i];
+        }
+
+        if ((len != line->len) || memcmp(buf, line->buf, len))
+        {
+            printf("seed %u: log %d differs\n  capture: %.*s\n  ref:     %.*s", seed, i, len > 0 ? len : 0, buf,
+                   line->len, line->buf);
+            return 1;
+        }
+    }
+
+    if (cap_rec_index != cap_rec_num || cap_line_index != cap_num)
+    {
+        printf("seed %u: %d records, %d lines are extra\n", seed, cap_rec_num - cap_rec_index, cap_num - cap_line_index);
+        return 1;
+    }
+
+    if (cap_rec_num && check_invalid())
+    {
+        printf("seed %u: invalid record is formatted\n", seed);
+        return 1;
+    }
+
+    printf("seed %u: capture level %u, %d captured, %d output\n", seed, capture_lvl, cap_rec_num, cap_num);
+
+    return 0;
+}
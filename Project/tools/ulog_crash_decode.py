@@ -0,0 +1,153 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+解析 ulog 崩溃日志
+
+输入为 msh 命令 "ulog_crash dump" 的串口输出 (每行 "地址:十六进制数据"),
+按块序号拼接 flash 中的记录, 再接上 RAM 中还没写入 flash 的记录, 按时间顺序输出.
+RAM 中还没格式化的原始记录只能输出格式串地址, 可在 map 文件中查找.
+
+用法: python3 ulog_crash_decode.py dump.txt [--flash-addr 0x0803E000] [--page-size 2048]
+                                  [--page-num 4] [--ram-addr 0x2000BC00] [--ram-size 1024]
+"""
+import argparse
+import re
+import struct
+import sys
+
+CHUNK_MAGIC = 0x4C47
+CHUNK_HDR_SIZE = 8
+RAM_MAGIC = 0x554C4F47
+RAM_HDR_SIZE = 16
+REC_SYNC = 0xA5
+REC_SYNC_RAW = 0xA6
+REC_HDR_SIZE = 8
+REC_LVL_BOOT = 0xFF
+
+LEVEL_NAME = {0: 'A', 3: 'E', 4: 'W', 6: 'I', 7: 'D'}
+
+RESET_FLAGS = [
+    (26, 'PIN'),
+    (27, 'POR'),
+    (28, 'SFT'),
+    (29, 'IWDG'),
+    (30, 'WWDG'),
+    (31, 'LPWR'),
+]
+
+
+def load_dump(path):
+    """把十六进制输出还原成 {地址: 字节}"""
+    mem = {}
+    line_re = re.compile(r'([0-9A-Fa-f]{8}):([0-9A-Fa-f]+)')
+    with open(path, 'r', errors='ignore') as f:
+        for line in f:
+            m = line_re.search(line)
+            if not m:
+                continue
+            addr = int(m.group(1), 16)
+            data = bytes.fromhex(m.group(2)[:len(m.group(2)) // 2 * 2])
+            for i, b in enumerate(data):
+                mem[addr + i] = b
+    return mem
+
+
+def read(mem, addr, size):
+    if any((addr + i) not in mem for i in range(size)):
+        return None
+    return bytes(mem[addr + i] for i in range(size))
+
+
+def flash_chunks(mem, flash_addr, page_size, page_num):
+    chunks = []
+    for page in range(page_num):
+        base = flash_addr + page * page_size
+        offset = 0
+        while offset + CHUNK_HDR_SIZE <= page_size:
+            hdr = read(mem, base + offset, CHUNK_HDR_SIZE)
+            if hdr is None:
+                break
+            magic, length, seq = struct.unpack('<HHI', hdr)
+            if magic != CHUNK_MAGIC or offset + CHUNK_HDR_SIZE + length > page_size:
+                break
+            data = read(mem, base + offset + CHUNK_HDR_SIZE, length)
+            if data is None:
+                break
+            chunks.append((seq, data))
+            offset += CHUNK_HDR_SIZE + (length + 1) // 2 * 2
+    # 序号是 32 位回绕的, 以最大间隔处为起点排序
+    chunks.sort(key=lambda c: c[0])
+    if len(chunks) > 1:
+        gaps = [(chunks[i + 1][0] - chunks[i][0], i + 1) for i in range(len(chunks) - 1)]
+        gap, start = max(gaps)
+        if gap > 0x80000000:
+            chunks = chunks[start:] + chunks[:start]
+    return b''.join(c[1] for c in chunks)
+
+
+def ram_pending(mem, ram_addr, ram_size):
+    hdr = read(mem, ram_addr, RAM_HDR_SIZE)
+    if hdr is None:
+        return b''
+    magic, write, flush, boot_cnt = struct.unpack('<IIII', hdr)
+    buf_size = ram_size - RAM_HDR_SIZE
+    if magic != RAM_MAGIC or (write - flush) & 0xFFFFFFFF > buf_size:
+        return b''
+    buf = read(mem, ram_addr + RAM_HDR_SIZE, buf_size)
+    if buf is None:
+        return b''
+    return bytes(buf[(flush + i) % buf_size] for i in range((write - flush) & 0xFFFFFFFF))
+
+
+def reset_reason(csr):
+    names = [name for bit, name in RESET_FLAGS if csr & (1 << bit)]
+    return '|'.join(names) if names else 'NONE'
+
+
+def decode_records(data):
+    pos = 0
+    while pos + REC_HDR_SIZE <= len(data):
+        if data[pos] not in (REC_SYNC, REC_SYNC_RAW):
+            # 覆盖或写入中断留下的残缺数据, 找下一个记录头
+            pos += 1
+            continue
+        sync = data[pos]
+        level, length, tick = struct.unpack('<BHI', data[pos + 1:pos + REC_HDR_SIZE])
+        text = data[pos + REC_HDR_SIZE:pos + REC_HDR_SIZE + length]
+        if len(text) < length:
+            break
+        pos += REC_HDR_SIZE + length
+        if sync == REC_SYNC_RAW:
+            if level in LEVEL_NAME and length >= 4:
+                fmt = struct.unpack('<I', text[:4])[0]
+                yield '[%u] %s/<unformatted, format 0x%08X>' % (tick, LEVEL_NAME[level], fmt)
+        elif level == REC_LVL_BOOT and length == 4:
+            csr = struct.unpack('<I', text)[0]
+            yield '[%u] ---- boot, reset: %s (csr 0x%08X) ----' % (tick, reset_reason(csr), csr)
+        elif level in LEVEL_NAME:
+            yield text.decode('utf-8', errors='replace')
+
+
+def main():
+    parser = argparse.ArgumentParser(description='decode ulog crash log dump')
+    parser.add_argument('dump')
+    parser.add_argument('--flash-addr', type=lambda x: int(x, 0), default=0x0803E000)
+    parser.add_argument('--page-size', type=lambda x: int(x, 0), default=2048)
+    parser.add_argument('--page-num', type=lambda x: int(x, 0), default=4)
+    parser.add_argument('--ram-addr', type=lambda x: int(x, 0), default=0x2000BC00)
+    parser.add_argument('--ram-size', type=lambda x: int(x, 0), default=1024)
+    args = parser.parse_args()
+
+    mem = load_dump(args.dump)
+    if not mem:
+        sys.exit('no dump data found')
+
+    data = flash_chunks(mem, args.flash_addr, args.page_size, args.page_num)
+    data += ram_pending(mem, args.ram_addr, args.ram_size)
+
+    for line in decode_records(data):
+        print(line)
+
+
+if __name__ == '__main__':
+    main()
@@ -1,4 +1,5 @@
 #include "drv_gpio.h"
+#include <rthw.h>
 
 #define RCC_GPIOA       0
 #define RCC_GPIOB       1
@@ -27,6 +28,17 @@ static const struct pin_index pins[] =
 
 #define ITEM_NUM(items) sizeof(items) / sizeof(items[0])
 
+/* 每条 EXTI 线同时只能对应一个端口的引脚 */
+struct pin_irq_hdr
+{
+    rt_base_t pin;
+    rt_uint32_t mode;
+    void (*hdr)(void *args);
+    void *args;
+};
+
+static struct pin_irq_hdr pin_irq_hdr_tab[16] = {0};
+
 static const struct pin_index *get_pin(uint8_t pin)
 {
     int num = ITEM_NUM(pins);
@@ -128,6 +140,243 @@ int drv_pin_read(rt_base_t pin)
     return value;
 }
 
+static int pin_irq_line(uint32_t pin)
+{
+    for (int i = 0; i < 16; i++)
+    {
+        if(pin == (1UL << i))
+            return i;
+    }
+
+    return -1;
+}
+
+static IRQn_Type pin_irq_num(int line)
+{
+    if(line <= 4)
+        return (IRQn_Type)(EXTI0_IRQn + line);
+    if(line <= 9)
+        return EXTI9_5_IRQn;
+
+    return EXTI15_10_IRQn;
+}
+
+/* 保持 drv_pin_mode 设置的上下拉, F1 上拉下拉输入为 CNF=10 MODE=00, 由 ODR 选择上拉或下拉 */
+static uint32_t pin_irq_pull(const struct pin_index *index, int line)
+{
+    volatile uint32_t *cr = (line < 8) ? &(index->GPIOx->CRL) : &(index->GPIOx->CRH);
+    uint32_t cnf_mode = (*cr >> ((line & 0x07) * 4)) & 0x0F;
+
+    if(cnf_mode != 0x08)
+        return GPIO_NOPULL;
+
+    return (index->GPIOx->ODR & index->pin) ? GPIO_PULLUP : GPIO_PULLDOWN;
+}
+
+rt_err_t drv_pin_attach_irq(rt_base_t pin, rt_uint32_t mode, void (*hdr)(void *args), void *args)
+{
+    const struct pin_index *index = get_pin(pin);
+    if(index == RT_NULL)
+        return -RT_ERROR;
+    if(hdr == RT_NULL)
+        return -RT_ERROR;
+    if(mode > PIN_IRQ_MODE_RISING_FALLING)
+        return -RT_ERROR;
+
+    int line = pin_irq_line(index->pin);
+    if(line < 0)
+        return -RT_ERROR;
+
+    rt_base_t level = rt_hw_interrupt_disable();
+    if(pin_irq_hdr_tab[line].hdr && (pin_irq_hdr_tab[line].pin != pin))
+    {
+        rt_hw_interrupt_enable(level);
+        return -RT_EBUSY;
+    }
+    pin_irq_hdr_tab[line].pin = pin;
+    pin_irq_hdr_tab[line].mode = mode;
+    pin_irq_hdr_tab[line].hdr = hdr;
+    pin_irq_hdr_tab[line].args = args;
+    rt_hw_interrupt_enable(level);
+
+    return RT_EOK;
+}
+
+rt_err_t drv_pin_detach_irq(rt_base_t pin)
+{
+    const struct pin_index *index = get_pin(pin);
+    if(index == RT_NULL)
+        return -RT_ERROR;
+
+    int line = pin_irq_line(index->pin);
+    if(line < 0)
+        return -RT_ERROR;
+
+    rt_base_t level = rt_hw_interrupt_disable();
+    if(pin_irq_hdr_tab[line].hdr && (pin_irq_hdr_tab[line].pin == pin))
+    {
+        EXTI->IMR &= ~index->pin;
+        pin_irq_hdr_tab[line].hdr = RT_NULL;
+        pin_irq_hdr_tab[line].args = RT_NULL;
+    }
+    rt_hw_interrupt_enable(level);
+
+    return RT_EOK;
+}
+
+rt_err_t drv_pin_irq_enable(rt_base_t pin, rt_uint32_t enabled)
+{
+    const struct pin_index *index = get_pin(pin);
+    if(index == RT_NULL)
+        return -RT_ERROR;
+
+    int line = pin_irq_line(index->pin);
+    if(line < 0)
+        return -RT_ERROR;
+
+    IRQn_Type irqn = pin_irq_num(line);
+    rt_base_t level = rt_hw_interrupt_disable();
+
+    if(enabled == PIN_IRQ_ENABLE)
+    {
+        if((pin_irq_hdr_tab[line].hdr == RT_NULL) || (pin_irq_hdr_tab[line].pin != pin))
+        {
+            rt_hw_interrupt_enable(level);
+            return -RT_ERROR;
+        }
+
+        GPIO_InitTypeDef GPIO_InitStruct = {0};
+        GPIO_InitStruct.Pin = index->pin;
+        GPIO_InitStruct.Pull = pin_irq_pull(index, line);
+        GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_HIGH;
+        switch(pin_irq_hdr_tab[line].mode)
+        {
+            case PIN_IRQ_MODE_RISING:
+                GPIO_InitStruct.Mode = GPIO_MODE_IT_RISING;
+            break;
+
+            case PIN_IRQ_MODE_FALLING:
+                GPIO_InitStruct.Mode = GPIO_MODE_IT_FALLING;
+            break;
+
+            default:
+                GPIO_InitStruct.Mode = GPIO_MODE_IT_RISING_FALLING;
+            break;
+        }
+        HAL_GPIO_Init(index->GPIOx, &GPIO_InitStruct);
+        __HAL_GPIO_EXTI_CLEAR_IT(index->pin);
+
+        HAL_NVIC_SetPriority(irqn, 2, 0);
+        HAL_NVIC_EnableIRQ(irqn);
+    }
+    else
+    {
+        EXTI->IMR &= ~index->pin;
+
+        /* 共用中断号的其它线都已关闭时关闭中断 */
+        uint32_t mask = (line <= 4) ? index->pin : ((line <= 9) ? 0x03E0 : 0xFC00);
+        if((EXTI->IMR & mask) == 0)
+            HAL_NVIC_DisableIRQ(irqn);
+    }
+
+    rt_hw_interrupt_enable(level);
+
+    return RT_EOK;
+}
+
+void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin)
+{
+    int line = pin_irq_line(GPIO_Pin);
+    if(line < 0)
+        return;
+
+    /* 共用中断号时已关闭的线也可能有挂起标志 */
+    if((EXTI->IMR & GPIO_Pin) == 0)
+        return;
+
+    if(pin_irq_hdr_tab[line].hdr)
+        pin_irq_hdr_tab[line].hdr(pin_irq_hdr_tab[line].args);
+}
+
+void EXTI0_IRQHandler(void)
+{
+    /* enter interrupt */
+    rt_interrupt_enter();
+
+    HAL_GPIO_EXTI_IRQHandler(GPIO_PIN_0);
+
+    /* leave interrupt */
+    rt_interrupt_leave();
+}
+
+void EXTI1_IRQHandler(void)
+{
+    /* enter interrupt */
+    rt_interrupt_enter();
+
+    HAL_GPIO_EXTI_IRQHandler(GPIO_PIN_1);
+
+    /* leave interrupt */
+    rt_interrupt_leave();
+}
+
+void EXTI2_IRQHandler(void)
+{
+    /* enter interrupt */
+    rt_interrupt_enter();
+
+    HAL_GPIO_EXTI_IRQHandler(GPIO_PIN_2);
+
+    /* leave interrupt */
+    rt_interrupt_leave();
+}
+
+void EXTI3_IRQHandler(void)
+{
+    /* enter interrupt */
+    rt_interrupt_enter();
+
+    HAL_GPIO_EXTI_IRQHandler(GPIO_PIN_3);
+
+    /* leave interrupt */
+    rt_interrupt_leave();
+}
+
+void EXTI4_IRQHandler(void)
+{
+    /* enter interrupt */
+    rt_interrupt_enter();
+
+    HAL_GPIO_EXTI_IRQHandler(GPIO_PIN_4);
+
+    /* leave interrupt */
+    rt_interrupt_leave();
+}
+
+void EXTI9_5_IRQHandler(void)
+{
+    /* enter interrupt */
+    rt_interrupt_enter();
+
+    for (int i = 5; i <= 9; i++)
+        HAL_GPIO_EXTI_IRQHandler(1UL << i);
+
+    /* leave interrupt */
+    rt_interrupt_leave();
+}
+
+void EXTI15_10_IRQHandler(void)
+{
+    /* enter interrupt */
+    rt_interrupt_enter();
+
+    for (int i = 10; i <= 15; i++)
+        HAL_GPIO_EXTI_IRQHandler(1UL << i);
+
+    /* leave interrupt */
+    rt_interrupt_leave();
+}
+
 static rt_size_t _pin_read(usr_device_t dev, rt_off_t pos, void *buffer, rt_size_t size)
 {
     if(pos < 0)
@@ -13,6 +13,13 @@
 #define PIN_MODE_INPUT_PULLDOWN         0x03
 #define PIN_MODE_OUTPUT_OD              0x04
 
+#define PIN_IRQ_MODE_RISING             0x00
+#define PIN_IRQ_MODE_FALLING            0x01
+#define PIN_IRQ_MODE_RISING_FALLING     0x02
+
+#define PIN_IRQ_DISABLE                 0x00
+#define PIN_IRQ_ENABLE                  0x01
+
 struct usr_device_pin
 {
     struct usr_device parent;
@@ -27,5 +34,8 @@ struct usr_device_pin_mode
 void drv_pin_mode(rt_base_t pin, rt_base_t mode);
 void drv_pin_write(rt_base_t pin, rt_base_t value);
 int drv_pin_read(rt_base_t pin);
+rt_err_t drv_pin_attach_irq(rt_base_t pin, rt_uint32_t mode, void (*hdr)(void *args), void *args);
+rt_err_t drv_pin_detach_irq(rt_base_t pin);
+rt_err_t drv_pin_irq_enable(rt_base_t pin, rt_uint32_t enabled);
 
 #endif
@@ -0,0 +1,287 @@
+#include "drv_led_tim.h"
+#include "drv_gpio.h"
+#include <rthw.h>
+
+/**
+ * D0 (PA8) 为 TIM1_CH1, 闪烁数组按 (亮, 灭) 编译成 PWM 周期:
+ * ARR = 周期, CCR1 = 亮的时间, 由硬件输出, 不占用 CPU.
+ *
+ * TIM1 的 DMA 请求通道都已被串口占用, 多个周期之间靠 ARR/CCR 预装载在更新中断中写入下一个周期,
+ * 中断比周期提前一整个周期, 时间不受中断延时影响.
+ * 只有一个周期时用重复计数器, 无限循环不开中断, 有限循环每 256 个周期一次中断.
+ */
+#define LED_TIM_PIN                     0
+#define LED_TIM_RCR_MAX                 256
+
+struct led_tim_step
+{
+    uint16_t arr;
+    uint16_t ccr;
+};
+
+struct led_tim
+{
+    TIM_HandleTypeDef htim;
+    struct led_tim_step steps[DRV_LED_TIM_PAIR_MAX];
+    uint8_t step_num;
+    /* 已写入预装载寄存器的步骤 */
+    uint8_t index;
+    /* 单周期: 还没写入的周期数; 多周期: 剩余循环次数. < 0: 无限循环 */
+    int32_t remain;
+    /* 预装载寄存器中为结束步骤 */
+    uint8_t ending;
+    void (*complete)(void *args);
+    void *args;
+};
+
+static struct led_tim led_tim = {0};
+
+static int led_tim_compile(const uint32_t *light_arr, int arr_num)
+{
+    int num = 0;
+
+    for (int i = 0; i < arr_num; i += 2)
+    {
+        uint32_t on = light_arr[i];
+        uint32_t off = (i + 1 < arr_num) ? light_arr[i + 1] : 0;
+        uint32_t period = on + off;
+
+        if(period == 0)
+            continue;
+
+        if((period > 32767) || (num >= DRV_LED_TIM_PAIR_MAX))
+            return -RT_ERROR;
+
+        led_tim.steps[num].arr = period * (DRV_LED_TIM_CNT_FREQ / 1000) - 1;
+        led_tim.steps[num].ccr = on * (DRV_LED_TIM_CNT_FREQ / 1000);
+        num++;
+    }
+
+    if(num == 0)
+        return -RT_ERROR;
+
+    led_tim.step_num = num;
+
+    return RT_EOK;
+}
+
+/* 单周期时返回本次的重复次数 */
+static uint32_t led_tim_step_rep(void)
+{
+    uint32_t rep;
+
+    if(led_tim.remain < 0)
+        return 1;
+
+    rep = (led_tim.remain > LED_TIM_RCR_MAX) ? LED_TIM_RCR_MAX : led_tim.remain;
+    led_tim.remain -= rep;
+
+    return rep;
+}
+
+static void led_tim_load(uint8_t index, uint32_t rep)
+{
+    TIM_TypeDef *tim = led_tim.htim.Instance;
+
+    tim->ARR = led_tim.steps[index].arr;
+    tim->CCR1 = led_tim.steps[index].ccr;
+    tim->RCR = rep - 1;
+}
+
+/* 写入下一步骤, 没有时写入结束步骤: 整个周期输出无效电平 */
+static void led_tim_load_next(void)
+{
+    TIM_TypeDef *tim = led_tim.htim.Instance;
+
+    if(led_tim.step_num == 1)
+    {
+        if(led_tim.remain != 0)
+        {
+            led_tim_load(0, led_tim_step_rep());
+            return;
+        }
+    }
+    else
+    {
+        if(++led_tim.index >= led_tim.step_num)
+        {
+            led_tim.index = 0;
+            if(led_tim.remain > 0)
+                led_tim.remain--;
+        }
+
+        if(led_tim.remain != 0)
+        {
+            led_tim_load(led_tim.index, 1);
+            return;
+        }
+    }
+
+    tim->CCR1 = 0;
+    tim->RCR = 0;
+    led_tim.ending = 1;
+}
+
+static void led_tim_halt(void)
+{
+    TIM_TypeDef *tim = led_tim.htim.Instance;
+
+    __HAL_TIM_DISABLE_IT(&led_tim.htim, TIM_IT_UPDATE);
+    tim->CR1 &= ~TIM_CR1_CEN;
+    /* 强制输出无效电平, 立即生效, 引脚切回普通输出前不会闪一下 */
+    tim->CCMR1 = (tim->CCMR1 & ~TIM_CCMR1_OC1M) | TIM_OCMODE_FORCED_INACTIVE;
+    __HAL_TIM_CLEAR_FLAG(&led_tim.htim, TIM_FLAG_UPDATE);
+    led_tim.complete = RT_NULL;
+}
+
+static rt_err_t led_tim_hw_init(rt_base_t active_logic)
+{
+    TIM_OC_InitTypeDef sConfigOC = {0};
+    uint32_t clk = HAL_RCC_GetPCLK2Freq();
+
+    /* APB2 分频不为 1 时定时器时钟为 PCLK2 的 2 倍 */
+    if((RCC->CFGR & RCC_CFGR_PPRE2) != RCC_HCLK_DIV1)
+        clk *= 2;
+
+    __HAL_RCC_TIM1_CLK_ENABLE();
+
+    led_tim.htim.Instance = TIM1;
+    led_tim.htim.Init.Prescaler = clk / DRV_LED_TIM_CNT_FREQ - 1;
+    led_tim.htim.Init.CounterMode = TIM_COUNTERMODE_UP;
+    led_tim.htim.Init.Period = 0xFFFF;
+    led_tim.htim.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
+    led_tim.htim.Init.RepetitionCounter = 0;
+    led_tim.htim.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_ENABLE;
+    if (HAL_TIM_PWM_Init(&led_tim.htim) != HAL_OK)
+        return -RT_ERROR;
+
+    sConfigOC.OCMode = TIM_OCMODE_PWM1;
+    sConfigOC.Pulse = 0;
+    sConfigOC.OCPolarity = (active_logic == PIN_HIGH) ? TIM_OCPOLARITY_HIGH : TIM_OCPOLARITY_LOW;
+    sConfigOC.OCFastMode = TIM_OCFAST_DISABLE;
+    sConfigOC.OCIdleState = TIM_OCIDLESTATE_RESET;
+    if (HAL_TIM_PWM_ConfigChannel(&led_tim.htim, &sConfigOC, TIM_CHANNEL_1) != HAL_OK)
+        return -RT_ERROR;
+
+    __HAL_TIM_MOE_ENABLE(&led_tim.htim);
+
+    HAL_NVIC_SetPriority(TIM1_UP_IRQn, 1, 0);
+    HAL_NVIC_EnableIRQ(TIM1_UP_IRQn);
+
+    return RT_EOK;
+}
+
+/**
+ * 用定时器输出闪烁数组
+ *
+ * @param loop_cnt 循环次数, < 0 无限循环, 不能为 0
+ * @param complete 有限循环执行完成后在中断中调用
+ *
+ * @return RT_EOK: 已由硬件输出
+ *        -RT_ERROR: 引脚没有定时器通道或数组无法编译, 由调用者用软件实现
+ */
+rt_err_t drv_led_tim_start(rt_base_t pin, rt_base_t active_logic, const uint32_t *light_arr, int arr_num,
+                           int32_t loop_cnt, void (*complete)(void *args), void *args)
+{
+    GPIO_InitTypeDef GPIO_InitStruct = {0};
+    TIM_TypeDef *tim;
+    rt_base_t level;
+
+    if((pin != LED_TIM_PIN) || (light_arr == RT_NULL) || (loop_cnt == 0))
+        return -RT_ERROR;
+
+    level = rt_hw_interrupt_disable();
+
+    if(led_tim.htim.Instance)
+        led_tim_halt();
+
+    if(led_tim_compile(light_arr, arr_num) != RT_EOK)
+    {
+        rt_hw_interrupt_enable(level);
+        return -RT_ERROR;
+    }
+
+    rt_hw_interrupt_enable(level);
+
+    if(led_tim_hw_init(active_logic) != RT_EOK)
+        return -RT_ERROR;
+
+    tim = led_tim.htim.Instance;
+
+    level = rt_hw_interrupt_disable();
+
+    led_tim.index = 0;
+    led_tim.remain = loop_cnt;
+    led_tim.ending = 0;
+    led_tim.complete = complete;
+    led_tim.args = args;
+
+    /* 第一步通过更新事件直接装入, 预装载寄存器中放下一步 */
+    tim->CNT = 0;
+    led_tim_load(0, (led_tim.step_num == 1) ? led_tim_step_rep() : 1);
+    tim->EGR = TIM_EGR_UG;
+    __HAL_TIM_CLEAR_FLAG(&led_tim.htim, TIM_FLAG_UPDATE);
+
+    /* 单周期无限循环时寄存器不变, 不需要中断 */
+    if((led_tim.step_num > 1) || (led_tim.remain >= 0))
+    {
+        led_tim_load_next();
+        __HAL_TIM_ENABLE_IT(&led_tim.htim, TIM_IT_UPDATE);
+    }
+
+    tim->CCER |= TIM_CCER_CC1E;
+    __HAL_TIM_ENABLE(&led_tim.htim);
+
+    GPIO_InitStruct.Pin = GPIO_PIN_8;
+    GPIO_InitStruct.Mode = GPIO_MODE_AF_PP;
+    GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_LOW;
+    HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
+
+    rt_hw_interrupt_enable(level);
+
+    return RT_EOK;
+}
+
+/* 停止定时器输出, 引脚由调用者重新配置为普通输出 */
+void drv_led_tim_stop(rt_base_t pin)
+{
+    rt_base_t level;
+
+    if((pin != LED_TIM_PIN) || (led_tim.htim.Instance == RT_NULL))
+        return;
+
+    level = rt_hw_interrupt_disable();
+    led_tim_halt();
+    rt_hw_interrupt_enable(level);
+}
+
+void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim)
+{
+    void (*complete)(void *args);
+
+    if(htim != &led_tim.htim)
+        return;
+
+    /* 结束步骤已开始, 最后一个周期完整输出 */
+    if(led_tim.ending)
+    {
+        complete = led_tim.complete;
+        led_tim_halt();
+        if(complete)
+            complete(led_tim.args);
+        return;
+    }
+
+    led_tim_load_next();
+}
+
+void TIM1_UP_IRQHandler(void)
+{
+    /* enter interrupt */
+    rt_interrupt_enter();
+
+    HAL_TIM_IRQHandler(&led_tim.htim);
+
+    /* leave interrupt */
+    rt_interrupt_leave();
+}
@@ -0,0 +1,16 @@
+#ifndef __DRV_LED_TIM_H
+#define __DRV_LED_TIM_H
+#include <rtthread.h>
+#include "stm32f1xx_hal.h"
+
+/* 一个闪烁数组最多编译成的 (亮, 灭) 周期数 */
+#define DRV_LED_TIM_PAIR_MAX            8
+
+/* 定时器计数频率 2kHz, 单个 (亮 + 灭) 周期最长 32767ms */
+#define DRV_LED_TIM_CNT_FREQ            2000
+
+rt_err_t drv_led_tim_start(rt_base_t pin, rt_base_t active_logic, const uint32_t *light_arr, int arr_num,
+                           int32_t loop_cnt, void (*complete)(void *args), void *args);
+void drv_led_tim_stop(rt_base_t pin);
+
+#endif
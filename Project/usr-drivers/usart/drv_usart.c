@@ -55,6 +55,9 @@ static rt_err_t _usart_init(usr_device_t dev)
     dev->error = 0;
     rt_ringbuffer_init(&(usart->tx_rb), usart->buffer.send_buf, usart->buffer.send_bufsz);
     usart->need_send = 0;
+    usart->direct_buf = RT_NULL;
+    usart->direct_remain = 0;
+    usart->direct_before = 0;
     rt_ringbuffer_init(&(usart->rx_rb), usart->buffer.read_buf, usart->buffer.read_bufsz);
     usart->rx_index = usart->rx_rb.buffer_size;
     usart->tx_activated = RT_FALSE;
@@ -81,6 +84,19 @@ static rt_err_t _usart_init(usr_device_t dev)
     return RT_EOK;
 }
 
+/* DMA 一次最多发送 65535 字节, 直接发送的缓冲区分段发送 */
+static void _usart_direct_send(struct usr_device_usart *usart)
+{
+    rt_size_t send_len = usart->direct_remain;
+    if(send_len > 0xFFFF)
+        send_len = 0xFFFF;
+
+    HAL_UART_AbortTransmit(usart->config->handle);
+    HAL_UART_Transmit_DMA(usart->config->handle, (uint8_t *)usart->direct_ptr, send_len);
+    usart->direct_ptr += send_len;
+    usart->direct_remain -= send_len;
+}
+
 static rt_size_t _usart_read(usr_device_t dev, rt_off_t pos, void *buffer, rt_size_t size)
 {
     RT_ASSERT(dev != RT_NULL);
@@ -235,6 +251,9 @@ static rt_err_t _usart_control(usr_device_t dev, int cmd, void *args)
             rt_ringbuffer_reset(&(usart->tx_rb));
             rt_ringbuffer_reset(&(usart->rx_rb));
             usart->need_send = 0;
+            usart->direct_buf = RT_NULL;
+            usart->direct_remain = 0;
+            usart->direct_before = 0;
             usart->rx_index = usart->rx_rb.buffer_size;
             usart->tx_activated = RT_FALSE;
             usart->tx_activated_timeout = rt_tick_get();
@@ -246,6 +265,46 @@ static rt_err_t _usart_control(usr_device_t dev, int cmd, void *args)
         }
         break;
 
+        case USR_DEVICE_USART_CMD_TX_DIRECT:
+        {
+            struct usr_device_usart_tx_direct *direct = args;
+            if(direct == RT_NULL)
+                break;
+            if((direct->buf == RT_NULL) || (direct->len == 0))
+                break;
+            if(!usart->init_ok)
+                break;
+
+            rt_base_t level = rt_hw_interrupt_disable();
+            if(dev->error || usart->direct_buf)
+            {
+                rt_hw_interrupt_enable(level);
+                result = -RT_EBUSY;
+                break;
+            }
+
+            usart->direct_buf = direct->buf;
+            usart->direct_ptr = direct->buf;
+            usart->direct_remain = direct->len;
+            if(usart->tx_activated == RT_TRUE)
+            {
+                /* 排在已写入 tx_rb 的数据之后, 由发送完成中断接着发送 */
+                usart->direct_before = usart->need_send;
+            }
+            else
+            {
+                usart->direct_before = 0;
+                usart->tx_activated = RT_TRUE;
+                usart->tx_activated_timeout = rt_tick_get() + rt_tick_from_millisecond(USR_DEVICE_USART_TX_ACTIVATED_TIMEOUT * 1000);
+                DRV_USART_RS485_SEND();
+                _usart_direct_send(usart);
+            }
+            rt_hw_interrupt_enable(level);
+
+            result = RT_EOK;
+        }
+        break;
+
         default:
         break;
     }
@@ -274,23 +333,41 @@ void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
 
     usr_device_t dev = &(usart->parent);
     int result = -RT_ERROR;
+    const rt_uint8_t *direct_done = RT_NULL;
     do
     {
         if(usart->tx_activated != RT_TRUE)
             break;
-        if(usart->need_send == 0)
-            break;
         if(dev->error)
             break;
+
+        if(usart->direct_buf && (usart->direct_before == 0))
+        {
+            if(usart->direct_remain > 0)
+            {
+                _usart_direct_send(usart);
+                result = RT_EOK;
+                break;
+            }
+
+            direct_done = usart->direct_buf;
+            usart->direct_buf = RT_NULL;
+        }
+
+        if(usart->need_send == 0)
+            break;
         
         rt_uint8_t *send_ptr = RT_NULL;
-        rt_size_t send_len = rt_ringbuffer_peak(&(usart->tx_rb), &send_ptr, usart->need_send);
+        rt_size_t send_len = rt_ringbuffer_peak(&(usart->tx_rb), &send_ptr,
+                                                usart->direct_buf ? usart->direct_before : usart->need_send);
         if(send_len == 0)
         {
             dev->error |= USR_DEVICE_USART_ERROR_TX_RB_SAVE;
             break;
         }
         usart->need_send -= send_len;
+        if(usart->direct_buf)
+            usart->direct_before -= send_len;
         HAL_UART_AbortTransmit(usart->config->handle);
         HAL_UART_Transmit_DMA(usart->config->handle, send_ptr, send_len);
 
@@ -298,7 +375,7 @@ void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
     }while(0);
     
     if((usart->tx_activated == RT_TRUE) && usart->parent.tx_complete)
-        usart->parent.tx_complete(&(usart->parent), RT_NULL);
+        usart->parent.tx_complete(&(usart->parent), (void *)direct_done);
 
     if(result == RT_EOK)
     {
@@ -18,6 +18,7 @@
 #define USR_DEVICE_USART_CMD_SET_PARAMETER      0x01
 #define USR_DEVICE_USART_CMD_SET_BUFFER         0x02
 #define USR_DEVICE_USART_CMD_FLUSH              0X03
+#define USR_DEVICE_USART_CMD_TX_DIRECT          0x04
 
 #define USR_DEVICE_USART_ERROR_TX_TIMEOUT       0x01
 #define USR_DEVICE_USART_ERROR_TX_RB_SAVE       0x02
@@ -51,6 +52,13 @@ struct usr_device_usart_buffer
     int read_bufsz;
 };
 
+/* 直接用 DMA 发送外部缓冲区, 发送完前缓冲区不能修改, 完成时 tx_complete 传回 buf */
+struct usr_device_usart_tx_direct
+{
+    const rt_uint8_t *buf;
+    rt_size_t len;
+};
+
 struct usr_device_usart
 {
     struct usr_device parent;
@@ -58,6 +66,11 @@ struct usr_device_usart
     struct usr_device_usart_buffer buffer;
     struct rt_ringbuffer tx_rb;
     rt_uint16_t need_send;
+    /* 正在直接发送的缓冲区, 先发完 tx_rb 中 direct_before 个字节再发送 */
+    const rt_uint8_t *direct_buf;
+    const rt_uint8_t *direct_ptr;
+    rt_size_t direct_remain;
+    rt_uint16_t direct_before;
     struct rt_ringbuffer rx_rb;
     rt_uint16_t rx_index;
     rt_uint8_t tx_activated;